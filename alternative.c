@@ -0,0 +1,86 @@
+#include "alternative.h"
+#include "cpu.h"
+#include "printk.h"
+
+// 本文件负责：
+// - 遍历 .altinstructions，把 CPU 支持的特性对应的替换指令写进代码
+// - 修正替换指令开头的相对 call/jmp，剩余字节填 NOP
+//
+// 写代码用逐字节循环而不是 memcpy：被修补的可能正是 memcpy 自己。
+// 修补期间关中断，只有 BSP 在运行 (AP 还没启动)，不存在别的 CPU 正在执行被改的指令；
+// 全部写完后执行一条串行化指令，丢弃 CPU 可能已经预取/解码的旧指令。
+
+extern struct alt_instr __alt_instructions[];
+extern struct alt_instr __alt_instructions_end[];
+
+/*
+ * 386 起所有 CPU 都能执行的 NOP (不用 P6 才有的 0F 1F)，
+ * 长度 1..7 各一条，只是不改变任何状态的 mov/lea
+ */
+static const uint8_t alt_nops[8][7] = {
+    { 0 },
+    { 0x90 },                                       /* nop */
+    { 0x89, 0xf6 },                                 /* mov %esi, %esi */
+    { 0x8d, 0x76, 0x00 },                           /* lea 0(%esi), %esi */
+    { 0x8d, 0x74, 0x26, 0x00 },                     /* lea 0(%esi,1), %esi */
+    { 0x3e, 0x8d, 0x74, 0x26, 0x00 },               /* ds lea 0(%esi,1), %esi */
+    { 0x8d, 0xb6, 0x00, 0x00, 0x00, 0x00 },         /* lea 0L(%esi), %esi */
+    { 0x8d, 0xb4, 0x26, 0x00, 0x00, 0x00, 0x00 },   /* lea 0L(%esi,1), %esi */
+};
+
+#define ALT_NOP_MAX 7
+
+static void text_poke_early(uint8_t* addr, const uint8_t* src, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) addr[i] = src[i];
+}
+
+// 用尽量少的 NOP 填满 len 字节 (少一条指令就少一次解码)
+static void alt_fill_nops(uint8_t* addr, uint32_t len) {
+    while (len) {
+        uint32_t n = len < ALT_NOP_MAX ? len : ALT_NOP_MAX;
+        text_poke_early(addr, alt_nops[n], n);
+        addr += n;
+        len -= n;
+    }
+}
+
+// 串行化：CPUID 是任何特权级都可用的串行化指令；没有 CPUID 的 386/486 跳转一次即可清空预取队列
+static void sync_core(void) {
+    if (cpu_has(X86_FEATURE_CPUID)) {
+        uint32_t a, b, c, d;
+        cpuid(0, &a, &b, &c, &d);
+    } else {
+        asm volatile("jmp 1f\n1:" : : : "memory");
+    }
+}
+
+void alternatives_apply(void) {
+    uint32_t total = 0, patched = 0;
+    uint32_t flags = local_irq_save();
+
+    for (struct alt_instr* a = __alt_instructions; a < __alt_instructions_end; a++) {
+        total++;
+        if (!cpu_has(a->feature)) continue;
+        if (a->replen > a->instrlen) {
+            printk(KERN_WARNING, "alternatives: replacement at %p longer than site, skipped\n",
+                   (void*)a->instr);
+            continue;
+        }
+
+        uint8_t* instr = (uint8_t*)a->instr;
+        const uint8_t* repl = (const uint8_t*)a->repl;
+        text_poke_early(instr, repl, a->replen);
+
+        /* rel32 相对于下一条指令：指令搬了 (repl - instr) 字节，偏移量要加回来 */
+        if (a->replen >= 5 && (repl[0] == 0xE8 || repl[0] == 0xE9)) {
+            int32_t rel = *(const int32_t*)(repl + 1) + (int32_t)(a->repl - a->instr);
+            text_poke_early(instr + 1, (const uint8_t*)&rel, 4);
+        }
+        alt_fill_nops(instr + a->replen, a->instrlen - a->replen);
+        patched++;
+    }
+
+    sync_core();
+    local_irq_restore(flags);
+    printk(KERN_INFO, "alternatives: patched %u of %u sites\n", patched, total);
+}
@@ -0,0 +1,86 @@
+/**
+ * alternative.h - 启动时按 CPU 特性修补指令 (alternatives)
+ *
+ * 热路径上“有某特性就走 A，否则走 B”的判断，每次都要读一次标志变量再比较、跳转。
+ * 特性在启动后不会再变，做法与 Linux 相同：编译时两种指令序列都生成，
+ * 启动时 (alternatives_apply) 按 cpu_caps[] 把需要的那种直接写进代码，之后再也不用判断。
+ *
+ * 每个修补点在 .altinstructions 段中登记一项 struct alt_instr：
+ * - 原位置放默认指令 (不支持该特性时用的)，长度不足时用 NOP 补齐到替换指令的长度；
+ * - 替换指令放在 .altinstr_replacement 段，平时不执行；
+ * - CPU 有该特性时，把替换指令拷到原位置，剩余字节填 NOP。
+ * 替换指令以相对 call/jmp (E8/E9 rel32) 开头时，拷贝后会修正偏移量。
+ *
+ * 两种用法：
+ * - ALTERNATIVE(old, new, feature)：写在 asm 语句里，整段替换指令；
+ * - if (static_cpu_has(feature))：默认是一条 5 字节 NOP (顺序执行到“没有”的分支)，
+ *   CPU 有该特性时改成一条 jmp 跳到“有”的分支。
+ *
+ * 修补之前 (alternatives_apply 之前) 所有修补点都走默认的“没有该特性”路径，
+ * 所以默认指令必须在任何 CPU 上都正确。修补在启动其他 CPU 之前、单 CPU 关中断时进行。
+ *
+ * @see [alternatives.md](doc/alternatives.md)
+ */
+#ifndef ALTERNATIVE_H
+#define ALTERNATIVE_H
+
+#include <stdint.h>
+#include "cpufeature.h"
+
+struct alt_instr {
+    uint32_t instr;             /* 原指令地址 */
+    uint32_t repl;              /* 替换指令地址 */
+    uint16_t feature;           /* X86_FEATURE_xxx */
+    uint8_t instrlen;           /* 原指令长度 (含补齐的 NOP) */
+    uint8_t replen;             /* 替换指令长度，不超过 instrlen */
+} __attribute__((packed));
+
+#define __stringify_1(x)    #x
+#define __stringify(x)      __stringify_1(x)
+
+/*
+ * 默认指令 oldinstr，CPU 有 feature 时换成 newinstr。
+ * 替换指令更长时用 0x90 补齐原位置 (gas 的比较运算“真”为 -1，故取负)。
+ */
+#define ALTERNATIVE(oldinstr, newinstr, feature)                                        \
+    "661:\n\t" oldinstr "\n662:\n\t"                                                    \
+    ".skip -(((664f - 663f) - (662b - 661b)) > 0) * "                                   \
+    "((664f - 663f) - (662b - 661b)), 0x90\n"                                           \
+    "665:\n\t"                                                                          \
+    ".pushsection .altinstructions, \"a\"\n\t"                                          \
+    ".long 661b, 663f\n\t"                                                              \
+    ".word " __stringify(feature) "\n\t"                                                \
+    ".byte 665b - 661b, 664f - 663f\n\t"                                                \
+    ".popsection\n\t"                                                                   \
+    ".pushsection .altinstr_replacement, \"ax\"\n"                                      \
+    "663:\n\t" newinstr "\n664:\n\t"                                                    \
+    ".popsection\n\t"
+
+/*
+ * 按特性分支，不读内存、不比较。feature 必须是常量。
+ * 默认的 5 字节 NOP (ds lea 0(%esi,1), %esi) 在 386 上也能执行；替换为 jmp rel32。
+ */
+#define static_cpu_has(feature) __extension__ ({                                        \
+    __label__ t_yes;                                                                    \
+    int __has = 0;                                                                      \
+    asm goto("661: .byte 0x3e, 0x8d, 0x74, 0x26, 0x00\n662:\n\t"                        \
+             ".pushsection .altinstructions, \"a\"\n\t"                                 \
+             ".long 661b, 663f\n\t"                                                     \
+             ".word %c0\n\t"                                                            \
+             ".byte 662b - 661b, 664f - 663f\n\t"                                       \
+             ".popsection\n\t"                                                          \
+             ".pushsection .altinstr_replacement, \"ax\"\n"                             \
+             "663: jmp %l[t_yes]\n664:\n\t"                                             \
+             ".popsection"                                                              \
+             : : "i"(feature) : : t_yes);                                               \
+    if (0) {                                                                            \
+t_yes:                                                                                  \
+        __has = 1;                                                                      \
+    }                                                                                   \
+    __has;                                                                              \
+})
+
+/* 按 cpu_caps[] 修补所有登记的位置 (BSP 调用一次：cpufeature_init、fpu_init 之后，smp_init 之前) */
+void alternatives_apply(void);
+
+#endif
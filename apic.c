@@ -0,0 +1,314 @@
+#include "apic.h"
+#include "cpu.h"
+#include "cpufeature.h"
+#include "vmm.h"
+#include "interrupts.h"
+#include "printk.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 检测：CPUID.1:EDX[9] 表示 CPU 内置 Local APIC
+// - 解析 ACPI：RSDP -> RSDT -> MADT，得到 LAPIC/IOAPIC 地址、处理器列表、中断源覆盖
+// - 初始化 LAPIC (SVR 使能) 与 IOAPIC (重定向表)，并把 IRQ 路由从 8259 切换过来
+// - LAPIC 定时器：以 PIT 通道 2 为基准校准，然后以周期模式产生时钟中断
+
+/* === ACPI 表结构 === */
+struct acpi_rsdp {
+    char signature[8];      /* "RSD PTR " */
+    uint8_t checksum;
+    char oem_id[6];
+    uint8_t revision;
+    uint32_t rsdt_address;
+} __attribute__((packed));
+
+struct acpi_sdt_header {
+    char signature[4];
+    uint32_t length;        /* 整张表的长度 (含表头) */
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed));
+
+struct acpi_madt {
+    struct acpi_sdt_header header;
+    uint32_t lapic_address;
+    uint32_t flags;
+    /* 之后是变长的中断控制器结构体 (type, length, ...) */
+} __attribute__((packed));
+
+#define MADT_TYPE_LAPIC     0
+#define MADT_TYPE_IOAPIC    1
+#define MADT_TYPE_OVERRIDE  2
+
+/* IOAPIC 重定向表项标志 */
+#define IOAPIC_REG_VER      0x01
+#define IOAPIC_REG_REDTBL   0x10
+#define IOAPIC_POLARITY_LOW (1u << 13)
+#define IOAPIC_TRIGGER_LEVEL (1u << 15)
+#define IOAPIC_MASKED       (1u << 16)
+
+/* LAPIC 寄存器位 */
+#define LAPIC_SVR_ENABLE    (1u << 8)
+#define LAPIC_LVT_MASKED    (1u << 16)
+#define LAPIC_TIMER_PERIODIC (1u << 17)
+#define LAPIC_ICR_PENDING   (1u << 12)
+#define MSR_APIC_BASE_ENABLE (1u << 11)
+
+static volatile uint8_t* lapic_base = NULL;
+static uint32_t ioapic_base = 0;
+static uint32_t ioapic_gsi_base = 0;
+static uint32_t ioapic_max_redir = 0;
+static uint32_t bsp_apic_id = 0;
+static int apic_on = 0;
+
+/* ISA IRQ -> GSI 映射与极性/触发方式 (来自 MADT 中断源覆盖，默认恒等、边沿、高电平) */
+static uint32_t irq_gsi[16];
+static uint16_t irq_flags[16];
+
+static uint32_t cpu_apic_ids[APIC_MAX_CPUS];
+static uint32_t cpu_count = 0;
+
+static uint32_t timer_count = 0;  /* LAPIC 定时器每个 tick 的计数值 */
+
+uint32_t lapic_read(uint32_t reg) {
+    return *(volatile uint32_t*)(lapic_base + reg);
+}
+
+void lapic_write(uint32_t reg, uint32_t value) {
+    *(volatile uint32_t*)(lapic_base + reg) = value;
+}
+
+static uint32_t ioapic_read(uint32_t reg) {
+    *(volatile uint32_t*)(ioapic_base) = reg;              /* IOREGSEL */
+    return *(volatile uint32_t*)(ioapic_base + 0x10);      /* IOWIN */
+}
+
+static void ioapic_write(uint32_t reg, uint32_t value) {
+    *(volatile uint32_t*)(ioapic_base) = reg;
+    *(volatile uint32_t*)(ioapic_base + 0x10) = value;
+}
+
+static int acpi_checksum_ok(const void* ptr, uint32_t len) {
+    const uint8_t* p = (const uint8_t*)ptr;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; i++) sum += p[i];
+    return sum == 0;
+}
+
+static int sig_equal(const char* a, const char* b, int n) {
+    for (int i = 0; i < n; i++) if (a[i] != b[i]) return 0;
+    return 1;
+}
+
+// 在 [start, end) 中按 16 字节对齐搜索 RSDP
+static struct acpi_rsdp* rsdp_scan(uint32_t start, uint32_t end) {
+    for (uint32_t addr = start; addr < end; addr += 16) {
+        struct acpi_rsdp* rsdp = (struct acpi_rsdp*)addr;
+        if (sig_equal(rsdp->signature, "RSD PTR ", 8) && acpi_checksum_ok(rsdp, 20)) {
+            return rsdp;
+        }
+    }
+    return NULL;
+}
+
+// RSDP 位于 EBDA 的第一个 1KB 中，或 BIOS 只读区 0xE0000-0xFFFFF (都在恒等映射区内)
+static struct acpi_rsdp* rsdp_find(void) {
+    uint32_t ebda = (uint32_t)(*(volatile uint16_t*)0x40E) << 4;
+    struct acpi_rsdp* rsdp = NULL;
+    if (ebda >= 0x80000 && ebda < 0xA0000) rsdp = rsdp_scan(ebda, ebda + 1024);
+    if (!rsdp) rsdp = rsdp_scan(0xE0000, 0x100000);
+    return rsdp;
+}
+
+// ACPI 表通常放在内存顶端，不在初始的 4MB 映射内：先映射表头，再按长度映射整张表
+static struct acpi_sdt_header* acpi_map_table(uint32_t phys) {
+    if (vmm_identity_map(phys, sizeof(struct acpi_sdt_header), PAGE_PRESENT) != 0) return NULL;
+    struct acpi_sdt_header* h = (struct acpi_sdt_header*)phys;
+    if (vmm_identity_map(phys, h->length, PAGE_PRESENT) != 0) return NULL;
+    return h;
+}
+
+static struct acpi_madt* madt_find(void) {
+    struct acpi_rsdp* rsdp = rsdp_find();
+    if (!rsdp) return NULL;
+
+    struct acpi_sdt_header* rsdt = acpi_map_table(rsdp->rsdt_address);
+    if (!rsdt || !sig_equal(rsdt->signature, "RSDT", 4) || !acpi_checksum_ok(rsdt, rsdt->length)) {
+        return NULL;
+    }
+
+    uint32_t entries = (rsdt->length - sizeof(struct acpi_sdt_header)) / 4;
+    uint32_t* table = (uint32_t*)((uint32_t)rsdt + sizeof(struct acpi_sdt_header));
+    for (uint32_t i = 0; i < entries; i++) {
+        struct acpi_sdt_header* h = acpi_map_table(table[i]);
+        if (h && sig_equal(h->signature, "APIC", 4) && acpi_checksum_ok(h, h->length)) {
+            return (struct acpi_madt*)h;
+        }
+    }
+    return NULL;
+}
+
+// 遍历 MADT 的变长条目
+static void madt_parse(struct acpi_madt* madt) {
+    for (int i = 0; i < 16; i++) { irq_gsi[i] = i; irq_flags[i] = 0; }
+
+    uint8_t* p = (uint8_t*)madt + sizeof(struct acpi_madt);
+    uint8_t* end = (uint8_t*)madt + madt->header.length;
+    while (p + 2 <= end && p[1] >= 2) {
+        uint8_t type = p[0];
+        if (type == MADT_TYPE_LAPIC) {
+            /* [2]=ACPI 处理器 ID, [3]=APIC ID, [4..7]=flags (bit0: 已启用) */
+            uint32_t flags = *(uint32_t*)(p + 4);
+            if ((flags & 1) && cpu_count < APIC_MAX_CPUS) cpu_apic_ids[cpu_count++] = p[3];
+        } else if (type == MADT_TYPE_IOAPIC) {
+            /* 只使用第一个 IOAPIC：[2]=ID, [4..7]=地址, [8..11]=GSI 基址 */
+            if (!ioapic_base) {
+                ioapic_base = *(uint32_t*)(p + 4);
+                ioapic_gsi_base = *(uint32_t*)(p + 8);
+            }
+        } else if (type == MADT_TYPE_OVERRIDE) {
+            /* [3]=ISA IRQ, [4..7]=GSI, [8..9]=flags (例如 QEMU 把 IRQ0 接到 GSI2) */
+            uint8_t src = p[3];
+            if (src < 16) {
+                irq_gsi[src] = *(uint32_t*)(p + 4);
+                irq_flags[src] = *(uint16_t*)(p + 8);
+            }
+        }
+        p += p[1];
+    }
+}
+
+void lapic_enable(void) {
+    wrmsr(MSR_APIC_BASE, rdmsr(MSR_APIC_BASE) | MSR_APIC_BASE_ENABLE);
+    lapic_write(LAPIC_TPR, 0);   /* 接收所有优先级的中断 */
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+}
+
+static void ioapic_set_entry(uint32_t irq, uint32_t masked) {
+    uint32_t pin = irq_gsi[irq] - ioapic_gsi_base;
+    if (pin > ioapic_max_redir) return;
+
+    uint32_t low = 32 + irq;            /* 与 8259 模式使用相同的向量号 */
+    uint16_t f = irq_flags[irq];
+    if ((f & 0x3) == 0x3) low |= IOAPIC_POLARITY_LOW;      /* 低电平有效 */
+    if (((f >> 2) & 0x3) == 0x3) low |= IOAPIC_TRIGGER_LEVEL; /* 电平触发 */
+    if (masked) low |= IOAPIC_MASKED;
+
+    ioapic_write(IOAPIC_REG_REDTBL + pin * 2 + 1, bsp_apic_id << 24);  /* 目标 CPU */
+    ioapic_write(IOAPIC_REG_REDTBL + pin * 2, low);
+}
+
+void ioapic_unmask_irq(uint32_t irq) {
+    if (apic_on && irq < 16) ioapic_set_entry(irq, 0);
+}
+
+void ioapic_mask_irq(uint32_t irq) {
+    if (apic_on && irq < 16) ioapic_set_entry(irq, 1);
+}
+
+void apic_eoi(void) {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+int apic_enabled(void) {
+    return apic_on;
+}
+
+uint32_t apic_id(void) {
+    return lapic_base ? (lapic_read(LAPIC_ID) >> 24) : 0;
+}
+
+uint32_t apic_cpu_count(void) {
+    return cpu_count;
+}
+
+uint32_t apic_cpu_apic_id(uint32_t index) {
+    return index < cpu_count ? cpu_apic_ids[index] : 0;
+}
+
+int apic_init(void) {
+    if (!cpu_has(X86_FEATURE_APIC) || !cpu_has(X86_FEATURE_MSR)) {
+        printk(KERN_INFO, "APIC: not supported, using 8259 PIC\n");
+        return 0;
+    }
+
+    struct acpi_madt* madt = madt_find();
+    if (!madt) {
+        printk(KERN_INFO, "APIC: MADT not found, using 8259 PIC\n");
+        return 0;
+    }
+    madt_parse(madt);
+    if (!ioapic_base) {
+        printk(KERN_INFO, "APIC: no IOAPIC in MADT, using 8259 PIC\n");
+        return 0;
+    }
+
+    /* 映射 LAPIC / IOAPIC 寄存器页：MMIO 必须禁用缓存 */
+    uint32_t lapic_phys = madt->lapic_address;
+    vmm_identity_map(lapic_phys, PAGE_SIZE, PAGE_RW | PAGE_PCD | PAGE_PWT);
+    vmm_identity_map(ioapic_base, PAGE_SIZE, PAGE_RW | PAGE_PCD | PAGE_PWT);
+    lapic_base = (volatile uint8_t*)lapic_phys;
+
+    lapic_enable();
+    bsp_apic_id = apic_id();
+
+    /* 先屏蔽所有重定向表项，再由 irq_switch_to_apic 为已注册的 IRQ 逐个打开 */
+    ioapic_max_redir = (ioapic_read(IOAPIC_REG_VER) >> 16) & 0xFF;
+    for (uint32_t pin = 0; pin <= ioapic_max_redir; pin++) {
+        ioapic_write(IOAPIC_REG_REDTBL + pin * 2, IOAPIC_MASKED);
+    }
+
+    apic_on = 1;
+    irq_switch_to_apic();
+
+    printk(KERN_INFO, "APIC: LAPIC %p, IOAPIC %p, CPUs: %u\n",
+           (void*)lapic_phys, (void*)ioapic_base, cpu_count);
+    return 1;
+}
+
+// ICR 是两次写：关中断，防止中断处理函数 (定时器唤醒) 在两次写之间发送另一个 IPI
+void apic_send_ipi(uint32_t dest_apic_id, uint32_t icr_low) {
+    uint32_t flags = local_irq_save();
+    lapic_write(LAPIC_ICR_HIGH, dest_apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, icr_low);          /* 写低 32 位时真正发出 */
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) {
+        asm volatile("pause");
+    }
+    local_irq_restore(flags);
+}
+
+// AP 复用 BSP 的校准结果：同一平台上各核 LAPIC 定时器的输入频率相同
+void apic_timer_start_ap(void) {
+    if (!timer_count) return;
+    lapic_write(LAPIC_TIMER_DIV, 0x3);
+    lapic_write(LAPIC_LVT_TIMER, APIC_TIMER_VECTOR | LAPIC_TIMER_PERIODIC);
+    lapic_write(LAPIC_TIMER_INIT, timer_count);
+}
+
+// 以 PIT 通道 2 的 10ms 单次计时为基准，测量 LAPIC 定时器 (16 分频) 的计数速度
+int apic_timer_init(uint32_t hz) {
+    if (!apic_on || hz == 0) return 0;
+
+    lapic_write(LAPIC_TIMER_DIV, 0x3);                  /* 16 分频 */
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+
+    pit_oneshot_start(10000);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    while (!pit_oneshot_expired()) { }
+    uint32_t per_10ms = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CUR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+
+    if (per_10ms == 0) return 0;
+    timer_count = per_10ms / 10 * (1000 / hz);   /* 每个 tick 的计数值 */
+
+    timer_switch_to_apic();
+    lapic_write(LAPIC_LVT_TIMER, APIC_TIMER_VECTOR | LAPIC_TIMER_PERIODIC);
+    lapic_write(LAPIC_TIMER_INIT, timer_count);
+
+    printk(KERN_INFO, "APIC timer: %u ticks/ms (div 16)\n", per_10ms / 10);
+    return 1;
+}
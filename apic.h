@@ -0,0 +1,84 @@
+/**
+ * apic.h - Local APIC 与 IOAPIC 驱动
+ *
+ * 8259 PIC 的问题：
+ * - 每次中断都要用 outb 向 0x20/0xA0 端口发 EOI，I/O 端口访问很慢 (数百~上千周期)；
+ * - 只能把中断送给一个 CPU，无法支撑多处理器。
+ *
+ * APIC 体系：
+ * - Local APIC (LAPIC)：每个 CPU 一个，负责接收中断、EOI (一次内存写)、本地定时器、核间中断 (IPI)；
+ * - IOAPIC：接收设备 IRQ，按“重定向表”把它们路由到指定 CPU 的指定向量。
+ * 路由信息来自 ACPI 的 MADT 表 (Multiple APIC Description Table)。
+ *
+ * CPU 不支持 APIC 或找不到 MADT 时，内核继续使用 8259 PIC。
+ *
+ * @see [apic.md](doc/apic.md)
+ */
+#ifndef APIC_H
+#define APIC_H
+
+#include <stdint.h>
+
+#define APIC_MAX_CPUS        8
+#define APIC_SPURIOUS_VECTOR 0xFF
+#define APIC_TIMER_VECTOR    48      /* LAPIC 定时器，对应 IRQ_APIC_TIMER */
+#define APIC_RESCHED_VECTOR  50      /* 重新调度 IPI，对应 IRQ_RESCHED */
+
+/* 检测并初始化 LAPIC/IOAPIC (需在 vmm_init 之后调用)，成功返回 1，回退到 PIC 返回 0 */
+int apic_init(void);
+
+/* 当前是否工作在 APIC 模式 */
+int apic_enabled(void);
+
+/* 向本 CPU 的 LAPIC 发送 EOI (一次 MMIO 写) */
+void apic_eoi(void);
+
+/* 本 CPU 的 LAPIC ID */
+uint32_t apic_id(void);
+
+/* 设置/屏蔽 ISA IRQ 在 IOAPIC 中的重定向表项 (自动应用 MADT 中的中断源覆盖) */
+void ioapic_unmask_irq(uint32_t irq);
+void ioapic_mask_irq(uint32_t irq);
+
+/*
+ * 以 PIT 为基准校准 LAPIC 定时器，并以 hz 频率周期触发 APIC_TIMER_VECTOR。
+ * 成功返回 1。
+ */
+int apic_timer_init(uint32_t hz);
+
+/* 启用当前 CPU 的 LAPIC (SVR 使能 + 伪中断向量)，供 AP 启动时复用 */
+void lapic_enable(void);
+
+/* 在 AP 上以 BSP 校准出的计数值启动周期定时器 */
+void apic_timer_start_ap(void);
+
+/* 发送核间中断 (IPI)：icr_low 为 ICR 低 32 位 (投递模式 | 向量)，等待投递完成。任何上下文均可调用 */
+void apic_send_ipi(uint32_t dest_apic_id, uint32_t icr_low);
+#define APIC_ICR_FIXED    0x00004000   /* 固定投递模式，低 8 位为向量 */
+#define APIC_ICR_INIT     0x00004500   /* INIT，电平有效 (assert) */
+#define APIC_ICR_STARTUP  0x00004600   /* Startup IPI，低 8 位为入口页号 */
+
+/* MADT 中枚举到的处理器 */
+uint32_t apic_cpu_count(void);
+uint32_t apic_cpu_apic_id(uint32_t index);
+
+/* LAPIC 寄存器读写 (供 SMP 启动发送 IPI 使用) */
+uint32_t lapic_read(uint32_t reg);
+void lapic_write(uint32_t reg, uint32_t value);
+
+/* LAPIC 寄存器偏移 */
+#define LAPIC_ID        0x020
+#define LAPIC_TPR       0x080
+#define LAPIC_EOI       0x0B0
+#define LAPIC_SVR       0x0F0
+#define LAPIC_ESR       0x280
+#define LAPIC_ICR_LOW   0x300
+#define LAPIC_ICR_HIGH  0x310
+#define LAPIC_LVT_TIMER 0x320
+#define LAPIC_LVT_LINT0 0x350
+#define LAPIC_LVT_LINT1 0x360
+#define LAPIC_TIMER_INIT 0x380
+#define LAPIC_TIMER_CUR  0x390
+#define LAPIC_TIMER_DIV  0x3E0
+
+#endif
@@ -0,0 +1,168 @@
+#include "async.h"
+#include "process.h"
+#include "printk.h"
+#include "spinlock.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 就绪队列 (FIFO)：async_wake 入队，kasyncd 出队执行
+// - 定时器链表：按 wake_tick 升序排列，时钟中断只需检查表头
+// - kasyncd：唯一的工作线程，轮流调用各任务函数；队列为空时阻塞，入队时被唤醒
+//
+// 并发说明：就绪队列与定时器链表会被中断上下文 (async_timer_tick / async_wake)
+// 与 kasyncd 同时访问，SMP 下还可能来自不同 CPU，所以所有链表操作都在
+// async_lock (关中断自旋锁) 的临界区内完成。
+
+static async_task_t* ready_head = NULL;
+static async_task_t* ready_tail = NULL;
+static async_task_t* timer_head = NULL;   /* 按 wake_tick 升序 */
+static volatile uint32_t async_now = 0;   /* 最近一次 async_timer_tick 的时间 */
+static process_t* async_worker_proc = NULL;
+static spinlock_t async_lock = SPINLOCK_INIT("async");
+
+/* 以下 *_locked 函数要求调用者持有 async_lock */
+static void ready_push_locked(async_task_t* task) {
+    task->state = ASYNC_READY;
+    task->next = NULL;
+    if (ready_tail) ready_tail->next = task;
+    else ready_head = task;
+    ready_tail = task;
+    process_wake(async_worker_proc);
+}
+
+static async_task_t* ready_pop_locked(void) {
+    async_task_t* task = ready_head;
+    if (task) {
+        ready_head = task->next;
+        if (!ready_head) ready_tail = NULL;
+        task->next = NULL;
+    }
+    return task;
+}
+
+static void timer_remove_locked(async_task_t* task) {
+    async_task_t** pp = &timer_head;
+    while (*pp) {
+        if (*pp == task) {
+            *pp = task->next;
+            task->next = NULL;
+            return;
+        }
+        pp = &(*pp)->next;
+    }
+}
+
+void async_spawn(async_task_t* task, async_fn_t fn, void* ctx) {
+    task->line = 0;
+    task->fn = fn;
+    task->ctx = ctx;
+    task->wake_tick = 0;
+
+    uint32_t flags = spin_lock_irqsave(&async_lock);
+    ready_push_locked(task);
+    spin_unlock_irqrestore(&async_lock, flags);
+}
+
+// 唤醒任务：
+// - WAITING  : 放回就绪队列
+// - SLEEPING : 提前结束休眠（从定时器链表摘下）并放回就绪队列
+// - RUNNING  : 任务正在执行（例如 ASYNC_YIELD 或执行期间被中断唤醒），
+//              标记为 WOKEN，由 kasyncd 在任务返回后重新入队，避免丢失唤醒
+// - READY/IDLE: 无需处理
+void async_wake(async_task_t* task) {
+    uint32_t flags = spin_lock_irqsave(&async_lock);
+    switch (task->state) {
+        case ASYNC_SLEEPING:
+            timer_remove_locked(task);
+            ready_push_locked(task);
+            break;
+        case ASYNC_WAITING:
+            ready_push_locked(task);
+            break;
+        case ASYNC_RUNNING:
+            task->state = ASYNC_WOKEN;
+            break;
+        default:
+            break;
+    }
+    spin_unlock_irqrestore(&async_lock, flags);
+}
+
+void async_sleep(async_task_t* task, uint32_t ticks) {
+    if (ticks == 0) ticks = 1;
+
+    uint32_t flags = spin_lock_irqsave(&async_lock);
+    task->state = ASYNC_SLEEPING;
+    task->wake_tick = async_now + ticks;
+
+    /* 有序插入：用差值比较，保证 tick 计数回绕后顺序依然正确 */
+    async_task_t** pp = &timer_head;
+    while (*pp && (int32_t)((*pp)->wake_tick - task->wake_tick) <= 0) {
+        pp = &(*pp)->next;
+    }
+    task->next = *pp;
+    *pp = task;
+    spin_unlock_irqrestore(&async_lock, flags);
+}
+
+// 时钟下半部调用：链表有序，只需从表头摘下所有到期任务
+void async_timer_tick(uint32_t now) {
+    uint32_t flags = spin_lock_irqsave(&async_lock);
+    async_now = now;
+    while (timer_head && (int32_t)(now - timer_head->wake_tick) >= 0) {
+        async_task_t* task = timer_head;
+        timer_head = task->next;
+        ready_push_locked(task);
+    }
+    spin_unlock_irqrestore(&async_lock, flags);
+}
+
+uint32_t async_run_pending(void) {
+    uint32_t ran = 0;
+    while (1) {
+        uint32_t flags = spin_lock_irqsave(&async_lock);
+        async_task_t* task = ready_pop_locked();
+        if (task) task->state = ASYNC_RUNNING;
+        spin_unlock_irqrestore(&async_lock, flags);
+        if (!task) break;
+
+        /* “上下文切换”就是一次函数调用 */
+        int ret = task->fn(task);
+        ran++;
+
+        flags = spin_lock_irqsave(&async_lock);
+        if (ret == ASYNC_DONE) {
+            task->state = ASYNC_IDLE;
+        } else if (task->state == ASYNC_WOKEN) {
+            ready_push_locked(task);
+        } else if (task->state == ASYNC_RUNNING) {
+            /* 任务返回 PENDING 且没有进入定时器链表：等待 async_wake */
+            task->state = ASYNC_WAITING;
+        }
+        spin_unlock_irqrestore(&async_lock, flags);
+    }
+    return ran;
+}
+
+// kasyncd：所有异步任务共享的唯一执行者
+static void async_worker(void) {
+    while (1) {
+        async_run_pending();
+
+        /* 队列为空时阻塞。持锁后再检查一次，检查与标记阻塞之间别人无法入队，
+           因此不会漏掉 async_wake / async_timer_tick 送来的唤醒。 */
+        uint32_t flags = spin_lock_irqsave(&async_lock);
+        if (!ready_head) {
+            process_block_current();
+            spin_unlock(&async_lock);
+            process_yield();
+            spin_lock(&async_lock);
+        }
+        spin_unlock_irqrestore(&async_lock, flags);
+    }
+}
+
+void async_init(void) {
+    async_worker_proc = process_create(async_worker, "kasyncd");
+    printk(KERN_INFO, "Async task runtime started (kasyncd).\n");
+}
@@ -0,0 +1,106 @@
+/**
+ * async.h - 内核轻量级异步任务 (Stackless Coroutine / 无栈协程)
+ *
+ * 每个内核线程 (process_create) 都需要一个 PCB + 4KB 内核栈，切换还要走一遍
+ * irq_common_stub 的完整现场保存/恢复。对于“刷新状态栏”“延后处理按键”这类小活，
+ * 这太重了。
+ *
+ * 这里提供一个协作式 (Cooperative) 运行时：
+ * - 每个任务只是一个 async_task_t（约 20 字节），没有独立的栈；
+ * - 任务函数通过 ASYNC_* 宏在“挂起点”返回，下次调用时用 switch 跳回原处继续执行，
+ *   这个“原处”就是续体 (Continuation)，保存在 task->line 中；
+ * - 所有任务由一个内核工作线程 (kasyncd) 从就绪队列 (Ready Queue) 中取出依次执行，
+ *   任务之间的“切换”只是一次普通的函数调用与返回。
+ *
+ * 限制（无栈协程的代价）：
+ * - 局部变量不会跨越挂起点保存，需要持久化的状态请放到 ctx 指向的结构体中；
+ * - ASYNC_* 宏只能出现在任务函数本身，不能出现在它调用的子函数里；
+ * - 任务函数内不要再使用 switch 包住挂起点。
+ *
+ * @see [async_tasks.md](doc/async_tasks.md)
+ */
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <stdint.h>
+
+/* 任务函数返回值 */
+#define ASYNC_DONE     0   /* 任务执行完毕 */
+#define ASYNC_PENDING  1   /* 任务在挂起点让出，稍后继续 */
+
+/* 任务状态 */
+#define ASYNC_IDLE     0   /* 未提交或已完成 */
+#define ASYNC_READY    1   /* 在就绪队列中等待执行 */
+#define ASYNC_RUNNING  2   /* 正在被 kasyncd 执行 */
+#define ASYNC_WOKEN    3   /* 执行期间被唤醒，返回后需要立即重新入队 */
+#define ASYNC_WAITING  4   /* 挂起，等待 async_wake() */
+#define ASYNC_SLEEPING 5   /* 挂起，等待定时器到期 */
+
+typedef struct async_task async_task_t;
+typedef int (*async_fn_t)(async_task_t* task);
+
+/*
+ * 任务控制块：调用者自行提供存储（静态变量或嵌入到驱动自己的结构体中），
+ * 运行时本身不做任何内存分配。
+ */
+struct async_task {
+    uint16_t line;          /* 续体：下次恢复执行的位置 (__LINE__)，0 表示从头开始 */
+    uint8_t state;          /* ASYNC_IDLE / ASYNC_READY ... */
+    uint8_t reserved;
+    uint32_t wake_tick;     /* ASYNC_SLEEPING 时的到期时刻 (PIT tick) */
+    async_fn_t fn;          /* 任务函数 */
+    void* ctx;              /* 任务私有数据 */
+    struct async_task* next;/* 就绪队列 / 定时器链表指针 */
+};
+
+/*
+ * 协程宏 (基于 switch/case 的 Duff's Device 技巧)
+ *
+ * ASYNC_BEGIN / ASYNC_END  : 包住整个任务函数体
+ * ASYNC_YIELD              : 让出一次，重新排到就绪队列末尾
+ * ASYNC_SLEEP(ticks)       : 挂起 ticks 个时钟滴答 (10ms/tick)
+ * ASYNC_AWAIT(cond)        : cond 不成立时挂起，等待生产者调用 async_wake() 后重新检查
+ */
+#define ASYNC_BEGIN(t)  switch ((t)->line) { case 0:
+
+#define ASYNC_END(t)    } (t)->line = 0; return ASYNC_DONE
+
+#define ASYNC_YIELD(t) do {                         \
+        (t)->line = __LINE__;                       \
+        async_wake(t);                              \
+        return ASYNC_PENDING;                       \
+        case __LINE__:;                             \
+    } while (0)
+
+#define ASYNC_SLEEP(t, ticks) do {                  \
+        (t)->line = __LINE__;                       \
+        async_sleep((t), (ticks));                  \
+        return ASYNC_PENDING;                       \
+        case __LINE__:;                             \
+    } while (0)
+
+#define ASYNC_AWAIT(t, cond) do {                   \
+        (t)->line = __LINE__;                       \
+        case __LINE__:                              \
+        if (!(cond)) return ASYNC_PENDING;          \
+    } while (0)
+
+/* 初始化运行时并创建 kasyncd 工作线程 (需在 process_init 之后调用) */
+void async_init(void);
+
+/* 提交一个新任务：从头开始执行 fn(task) */
+void async_spawn(async_task_t* task, async_fn_t fn, void* ctx);
+
+/* 唤醒一个挂起的任务（可在中断上下文调用） */
+void async_wake(async_task_t* task);
+
+/* 仅供 ASYNC_SLEEP 使用：把当前任务挂到定时器链表上 */
+void async_sleep(async_task_t* task, uint32_t ticks);
+
+/* 时钟中断调用：把到期的任务移回就绪队列 */
+void async_timer_tick(uint32_t now);
+
+/* 执行就绪队列中的所有任务，返回本轮执行的任务数 */
+uint32_t async_run_pending(void);
+
+#endif
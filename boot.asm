@@ -13,6 +13,15 @@ mov ax, 0
 mov ss, ax
 mov sp, 0x7C00
 
+; 启动计时：记下进入引导扇区时的 TSC (复位以来的周期数)，内核 boottime.c 读取。
+; 没有 TSC 的 CPU (486) 上 rdtsc 是非法指令：先把 #UD (中断 6) 指向 tsc_ud 跳过它，
+; 写入的值为 0，内核据此知道没有 TSC。rdtsc 会改写 EDX，所以放在保存驱动器号之后
+BOOT_TSC equ 0x500          ; 与 boottime.h 的 BOOT_TSC_ADDR 一致：+0 入口，+8 读完内核
+mov word [6 * 4], tsc_ud
+mov word [6 * 4 + 2], 0
+mov di, BOOT_TSC
+call tsc_stamp
+
 ; 显示开始信息
 mov si, START_MSG
 call print_string
@@ -31,36 +40,31 @@ call print_string
 
 ; 调用函数从磁盘加载内核
 call load_kernel_lba
-
-; 如果成功，显示成功信息
-mov si, SUCCESS_MSG
-call print_string
-
-; 切换到32位保护模式
-cli
-lgdt [gdt_descriptor]
-mov eax, cr0
-or eax, 0x1
-mov cr0, eax
-
-; 长跳转到32位代码段
-jmp CODE_SEG:init_pm
+jmp after_load
 
 no_lba_support:
     mov si, NO_LBA_MSG
     call print_string
     call load_kernel_chs
-    jmp after_load
 
+; LBA / CHS 两条路径在这里汇合
 after_load:
+    ; 启动计时：内核已读入 (进入保护模式只需几条指令，不再单独计时)
+    mov di, BOOT_TSC + 8
+    call tsc_stamp
+
+    ; 如果成功，显示成功信息
     mov si, SUCCESS_MSG
     call print_string
-    
+
+    ; 切换到32位保护模式
     cli
     lgdt [gdt_descriptor]
     mov eax, cr0
     or eax, 0x1
     mov cr0, eax
+
+    ; 长跳转到32位代码段
     jmp CODE_SEG:init_pm
 
 [bits 32]
@@ -92,17 +96,31 @@ init_pm:
 [bits 16]
 
 ; --- load_kernel_lba: 使用LBA方式加载内核 ---
+; 内核 (含内嵌符号表) 已超过单次读取上限 127 个扇区，分块读取：
+; 每块 KERNEL_CHUNK 个扇区 (32KB)，读完把 DAP 的目标段和起始扇区往后挪一块
+KERNEL_SECTORS equ 256      ; 共 128KB：0x10000 - 0x2FFFF (build.sh 检查 kernel.bin 不超过此大小)
+KERNEL_CHUNK   equ 64
+
 load_kernel_lba:
     mov si, LOADING_MSG
     call print_string
-    
+    mov cx, KERNEL_SECTORS / KERNEL_CHUNK
+
+.next_chunk:
     ; 设置磁盘地址包 (DAP)
     mov si, disk_address_packet
+    mov word [dap_count], KERNEL_CHUNK  ; 部分 BIOS 会把实际读取数写回这里，每次重新填写
     
+    push cx
     mov ah, 0x42    ; LBA扩展读取功能
     mov dl, [BOOT_DRIVE]
     int 0x13
+    pop cx
     jc disk_error
+
+    add word [dap_segment], KERNEL_CHUNK * 512 / 16
+    add dword [dap_lba], KERNEL_CHUNK
+    loop .next_chunk
     ret
 
 ; --- load_kernel_chs: 使用CHS方式加载内核（备用）---
@@ -157,6 +175,23 @@ print_hex:
     popa
     ret
 
+; --- tsc_stamp: 把 TSC 写到 [DI] (8 字节)，没有 TSC 时写 0 ---
+tsc_stamp:
+    xor eax, eax
+    cdq             ; EDX = 0
+    rdtsc           ; 没有 TSC 时 #UD，由 tsc_ud 跳过
+    mov [di], eax
+    mov [di + 4], edx
+    ret
+
+; --- tsc_ud: 实模式 #UD 处理，跳过引发异常的 2 字节 rdtsc ---
+tsc_ud:
+    push bp
+    mov bp, sp
+    add word [bp + 2], 2    ; 栈上的返回地址指向 rdtsc 本身
+    pop bp
+    iret
+
 ; --- print_string: 打印字符串函数 ---
 print_string:
     mov bh, 0       ; 页号
@@ -221,9 +256,12 @@ ERROR_MSG db 'Disk error! Code: 0x', 0
 disk_address_packet:
     db 0x10        ; 数据包大小 (16字节)
     db 0           ; 保留字节
-    dw 64          ; 要读取的扇区数（与上方 AL 对齐）
+dap_count:
+    dw KERNEL_CHUNK ; 本次读取的扇区数 (127 是多数 BIOS 单次读取的上限)
     dw 0x0000      ; 缓冲区偏移地址 (ES:BX)
-    dw 0x1000      ; 缓冲区段地址
+dap_segment:
+    dw 0x1000      ; 缓冲区段地址 (每读一块加 0x800)
+dap_lba:
     dd 1           ; 起始LBA扇区号 (从扇区1开始，即第二个扇区)
     dd 0           ; 高32位LBA (对于小磁盘为0)
 
@@ -0,0 +1,113 @@
+#include "boottime.h"
+#include "clocksource.h"
+#include "terminal.h"
+#include "printk.h"
+#include "cpu.h"
+
+// 本文件负责：
+// - 读取引导扇区留下的 TSC，作为 firmware / bootloader 两个阶段的终点
+// - 记录 kmain 中各阶段结束时的 TSC
+// - 把时间线换算成微秒，启动时 printk 输出、boottime 命令在终端输出
+//
+// 第 i 个阶段的起点是第 i-1 个阶段的终点，第一个阶段 (firmware) 从复位 (TSC = 0) 开始；
+// 没有引导扇区时间戳时 (例如由其他引导程序加载)，第一个阶段从 kmain 入口开始。
+// 前几个阶段在 alternatives_apply 之前 (那时 rdtsc() 恒为 0)，所以用不经修补的 rdtsc_early。
+// kmain 入口时还没有执行 CPUID：CPU 有没有 TSC 看引导扇区的入口时间戳，
+// 没有 TSC 时引导扇区跳过 rdtsc 写入 0，此时不计时 (否则 rdtsc_early 会 #UD)。
+
+struct boottime_mark {
+    const char* name;
+    uint64_t tsc;               /* 阶段结束时的 TSC */
+};
+
+static struct boottime_mark boot_marks[BOOTTIME_MAX_MARKS];
+static uint32_t boot_nr_marks = 0;
+static uint32_t boot_loader_marks = 0;  /* 其中来自引导扇区的个数 (0 或 2) */
+static uint64_t boot_kmain_tsc = 0;     /* 没有引导扇区时间戳时，从 kmain 入口算起 */
+static int boot_tsc_ok = 0;             /* 引导扇区读到了 TSC */
+
+static void boottime_add(const char* name, uint64_t tsc) {
+    if (boot_nr_marks >= BOOTTIME_MAX_MARKS) return;
+    boot_marks[boot_nr_marks].name = name;
+    boot_marks[boot_nr_marks].tsc = tsc;
+    boot_nr_marks++;
+}
+
+void boottime_init(void) {
+    const volatile uint64_t* loader = (const volatile uint64_t*)BOOT_TSC_ADDR;
+    uint64_t entry = loader[0], jump = loader[1];
+    if (!entry) return;
+    boot_tsc_ok = 1;
+
+    /* 值不可信 (内存被改过) 时只计 kmain 之后的阶段：要求 入口 <= 读完内核 <= 现在 */
+    uint64_t now = rdtsc_early();
+    if (entry <= jump && jump <= now) {
+        boottime_add("firmware", entry);
+        boottime_add("bootloader", jump);
+        boot_loader_marks = 2;
+    }
+    boot_kmain_tsc = now;
+}
+
+void boottime_mark(const char* name) {
+    if (!boot_tsc_ok) return;
+    boottime_add(name, rdtsc_early());
+}
+
+static uint32_t boottime_us(uint64_t cycles, uint32_t khz) {
+    return (uint32_t)div_u64(cycles * 1000, khz);
+}
+
+// 逐行格式化时间线，交给 out 输出 (printk 或终端)
+static void boottime_show(void (*out)(const char* line)) {
+    char line[128];
+    uint32_t khz = clocksource_tsc_khz();
+    if (!boot_tsc_ok) {
+        out("boottime: no TSC\n");
+        return;
+    }
+    if (khz == 0) {
+        out("boottime: no calibrated TSC\n");
+        return;
+    }
+    if (boot_nr_marks == 0) {
+        out("boottime: no marks recorded\n");
+        return;
+    }
+
+    out("phase             start(us)    time(us)\n");
+    uint64_t base = boot_loader_marks ? 0 : boot_kmain_tsc;
+    uint64_t prev = base;
+    for (uint32_t i = 0; i < boot_nr_marks; i++) {
+        uint64_t tsc = boot_marks[i].tsc;
+        snprintk(line, sizeof(line), "  %-14s %10u  %10u\n", boot_marks[i].name,
+                 boottime_us(prev - base, khz), boottime_us(tsc - prev, khz));
+        out(line);
+        prev = tsc;
+    }
+
+    uint64_t end = boot_marks[boot_nr_marks - 1].tsc;
+    if (boot_loader_marks) {
+        uint64_t kernel_start = boot_marks[boot_loader_marks - 1].tsc;
+        snprintk(line, sizeof(line), "boottime: total %u us, firmware %u us, loader %u us, kernel %u us\n",
+                 boottime_us(end, khz), boottime_us(boot_marks[0].tsc, khz),
+                 boottime_us(kernel_start - boot_marks[0].tsc, khz),
+                 boottime_us(end - kernel_start, khz));
+    } else {
+        snprintk(line, sizeof(line), "boottime: kernel %u us (no bootloader timestamps)\n",
+                 boottime_us(end - base, khz));
+    }
+    out(line);
+}
+
+static void boottime_out_printk(const char* line) {
+    printk(KERN_INFO, "%s", line);
+}
+
+void boottime_report(void) {
+    boottime_show(boottime_out_printk);
+}
+
+void boottime_dump(void) {
+    boottime_show(terminal_writestring);
+}
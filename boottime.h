@@ -0,0 +1,39 @@
+/**
+ * boottime.h - 启动各阶段耗时 (shell 命令 boottime)
+ *
+ * 在每个初始化阶段结束时用 boottime_mark() 记一次 TSC，启动结束时打印时间线，
+ * 之后随时可以用 boottime 命令再看。各阶段的时间都是相对 CPU 复位 (TSC = 0) 的：
+ * - firmware：复位到 BIOS 跳进引导扇区 (boot.asm 入口的 TSC)；
+ * - bootloader：引导扇区检测 LBA、读入内核 (128KB) (读完内核时的 TSC)；
+ * - 之后是 kmain 中的各个阶段。
+ *
+ * 引导扇区把两个 TSC 写在物理地址 BOOT_TSC_ADDR，boottime_init 在 kmain 一开始读出。
+ * CPU 没有 TSC 时引导扇区写入 0，不计时 (boottime 命令显示 no TSC)。
+ * 记录时只存原始 TSC (TSC 频率要到 clocksource_init 之后才知道)，显示时再换算成微秒。
+ * 最后一行 "boottime: total ... us" 格式固定，便于从串口日志中提取、对比各次构建。
+ *
+ * 只由 BSP 在 kmain 中调用，不加锁。
+ *
+ * @see [boottime.md](doc/boottime.md)
+ */
+#ifndef BOOTTIME_H
+#define BOOTTIME_H
+
+#include <stdint.h>
+
+#define BOOT_TSC_ADDR       0x500   /* boot.asm 写入：[0] 入口 TSC，[1] 读完内核时的 TSC (各 8 字节，没有 TSC 时为 0) */
+#define BOOTTIME_MAX_MARKS  32
+
+/* 读取引导扇区留下的时间戳 (kmain 的第一条语句) */
+void boottime_init(void);
+
+/* 名为 name 的阶段到此结束 (name 须是常量字符串) */
+void boottime_mark(const char* name);
+
+/* 启动结束：打印时间线与总耗时 (printk) */
+void boottime_report(void);
+
+/* shell 命令 boottime：在终端上重新显示时间线 */
+void boottime_dump(void);
+
+#endif
@@ -4,40 +4,118 @@ set -e
 # 编译引导扇区
 nasm -f bin boot.asm -o boot.bin
 
+# LOCK_STAT=1 ./build.sh 开启锁统计 (shell 的 lockstat 命令)
+# IRQSOFF_TRACE=1 ./build.sh 开启关中断区间追踪 (shell 的 irqsoff 命令)
+# FTRACE=1 ./build.sh 用 -finstrument-functions 编译，记录函数进入/退出 (shell 的 trace 命令)
+# FBCON=1 ./build.sh 启动后切换到 640x400 线性帧缓冲，终端由 fbcon 绘制 (需要 QEMU 标准显卡)
+CFLAGS="-m32 -ffreestanding -nostdlib"
+NASMFLAGS="-f elf32"
+if [ "$LOCK_STAT" = "1" ]; then
+    CFLAGS="$CFLAGS -DCONFIG_LOCK_STAT"
+fi
+if [ "$IRQSOFF_TRACE" = "1" ]; then
+    CFLAGS="$CFLAGS -DCONFIG_IRQSOFF_TRACE"
+    NASMFLAGS="$NASMFLAGS -DCONFIG_IRQSOFF_TRACE"
+fi
+if [ "$FTRACE" = "1" ]; then
+    # 头文件里的小函数 (this_cpu、rdtsc、spin_lock...) 调用极频繁，不插桩
+    CFLAGS="$CFLAGS -DCONFIG_FTRACE -finstrument-functions -finstrument-functions-exclude-file-list=cpu.h,smp.h,spinlock.h"
+fi
+if [ "$FBCON" = "1" ]; then
+    CFLAGS="$CFLAGS -DCONFIG_FBCON"
+fi
+
 # 编译汇编文件
-nasm -f elf32 gdt.asm -o gdt.o
-nasm -f elf32 isr.asm -o isr.o
+nasm $NASMFLAGS gdt.asm -o gdt.o
+nasm $NASMFLAGS isr.asm -o isr.o
+nasm $NASMFLAGS trampoline.asm -o trampoline.o
+nasm $NASMFLAGS sysenter.asm -o sysenter.o
 
 # 编译C文件
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c kernel.c -o kernel.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c terminal.c -o terminal.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c gdt.c -o gdt_c.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c idt.c -o idt.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c interrupts.c -o interrupts.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c pmm.c -o pmm.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c vmm.c -o vmm.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c heap.c -o heap.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c process.c -o process.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c initrd.c -o initrd.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c syscall.c -o syscall.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c string.c -o string.o
-x86_64-elf-gcc -m32 -ffreestanding -nostdlib -c shell.c -o shell.o
+x86_64-elf-gcc $CFLAGS -c kernel.c -o kernel.o
+x86_64-elf-gcc $CFLAGS -c terminal.c -o terminal.o
+x86_64-elf-gcc $CFLAGS -c gdt.c -o gdt_c.o
+x86_64-elf-gcc $CFLAGS -c idt.c -o idt.o
+x86_64-elf-gcc $CFLAGS -c interrupts.c -o interrupts.o
+x86_64-elf-gcc $CFLAGS -c pmm.c -o pmm.o
+x86_64-elf-gcc $CFLAGS -c vmm.c -o vmm.o
+x86_64-elf-gcc $CFLAGS -c heap.c -o heap.o
+x86_64-elf-gcc $CFLAGS -c process.c -o process.o
+x86_64-elf-gcc $CFLAGS -c initrd.c -o initrd.o
+x86_64-elf-gcc $CFLAGS -c syscall.c -o syscall.o
+x86_64-elf-gcc $CFLAGS -c string.c -o string.o
+x86_64-elf-gcc $CFLAGS -c shell.c -o shell.o
+x86_64-elf-gcc $CFLAGS -c async.c -o async.o
+x86_64-elf-gcc $CFLAGS -c workqueue.c -o workqueue.o
+x86_64-elf-gcc $CFLAGS -c softirq.c -o softirq.o
+x86_64-elf-gcc $CFLAGS -c apic.c -o apic.o
+x86_64-elf-gcc $CFLAGS -c smp.c -o smp.o
+x86_64-elf-gcc $CFLAGS -c spinlock.c -o spinlock.o
+x86_64-elf-gcc $CFLAGS -c uaccess.c -o uaccess.o
+x86_64-elf-gcc $CFLAGS -c uring.c -o uring.o
+x86_64-elf-gcc $CFLAGS -c vdso.c -o vdso.o
+x86_64-elf-gcc $CFLAGS -c clocksource.c -o clocksource.o
+x86_64-elf-gcc $CFLAGS -c hrtimer.c -o hrtimer.o
+x86_64-elf-gcc $CFLAGS -c fpu.c -o fpu.o
+x86_64-elf-gcc $CFLAGS -c irqbench.c -o irqbench.o
+x86_64-elf-gcc $CFLAGS -c irqstat.c -o irqstat.o
+x86_64-elf-gcc $CFLAGS -c irqsoff.c -o irqsoff.o
+x86_64-elf-gcc $CFLAGS -c ksyms.c -o ksyms_c.o
+x86_64-elf-gcc $CFLAGS -c prof.c -o prof.o
+x86_64-elf-gcc $CFLAGS -fno-instrument-functions -c trace.c -o trace.o   # 钩子本身不能插桩
+x86_64-elf-gcc $CFLAGS -c printk.c -o printk.o
+x86_64-elf-gcc $CFLAGS -c serial.c -o serial.o
+x86_64-elf-gcc $CFLAGS -c fbcon.c -o fbcon.o
+x86_64-elf-gcc $CFLAGS -c font.c -o font.o
+x86_64-elf-gcc $CFLAGS -c kbd.c -o kbd.o
+x86_64-elf-gcc $CFLAGS -c membench.c -o membench.o
+x86_64-elf-gcc $CFLAGS -c cpufeature.c -o cpufeature.o
+x86_64-elf-gcc $CFLAGS -c alternative.c -o alternative.o
+x86_64-elf-gcc $CFLAGS -c boottime.c -o boottime.o
 
 # 链接所有目标文件
 # 预链接解决新增模块符号解析顺序问题
-x86_64-elf-ld -r -m elf_i386 -o core.o kernel.o interrupts.o pmm.o vmm.o heap.o process.o initrd.o syscall.o string.o shell.o
+x86_64-elf-ld -r -m elf_i386 -o core.o kernel.o interrupts.o pmm.o vmm.o heap.o process.o initrd.o syscall.o string.o shell.o async.o workqueue.o softirq.o apic.o smp.o spinlock.o uaccess.o uring.o vdso.o clocksource.o hrtimer.o fpu.o irqbench.o irqstat.o irqsoff.o ksyms_c.o prof.o trace.o printk.o serial.o fbcon.o font.o kbd.o membench.o cpufeature.o alternative.o boottime.o
+
+# 最终链接 (两遍)：
+# 第一遍不带符号表 (.ksyms 为空)，用 nm 取出所有代码符号生成 ksyms.asm；
+# 第二遍把符号表链接进去。.ksyms 位于代码和数据之后，两遍链接中代码的地址完全相同。
+KERNEL_OBJS="core.o terminal.o gdt.o gdt_c.o isr.o idt.o trampoline.o sysenter.o"
+x86_64-elf-ld -m elf_i386 -T linker.ld -o kernel.elf $KERNEL_OBJS
 
-# 最终链接
-x86_64-elf-ld -m elf_i386 -T linker.ld -o kernel.elf \
-    core.o terminal.o gdt.o gdt_c.o isr.o idt.o
+x86_64-elf-nm -n kernel.elf | awk '
+    $2 == "t" || $2 == "T" { addr[n] = $1; name[n] = $3; n++ }
+    END {
+        print "section .ksyms progbits alloc noexec nowrite align=4"
+        print "ksyms_table:"
+        print "    dd " n
+        for (i = 0; i < n; i++) printf "    dd 0x%s, .n%d\n", addr[i], i
+        for (i = 0; i < n; i++) printf ".n%d: db \"%s\", 0\n", i, name[i]
+    }' > ksyms.asm
+nasm -f elf32 ksyms.asm -o ksyms.o
+x86_64-elf-ld -m elf_i386 -T linker.ld -o kernel.elf $KERNEL_OBJS ksyms.o
 
 # 提取纯二进制代码
 x86_64-elf-objcopy -O binary kernel.elf kernel.bin
 
+# 引导扇区固定读取 KERNEL_SECTORS 个扇区，超出的部分不会被加载 (启动后才以奇怪的方式出错)
+KERNEL_SECTORS=$(awk '$1 == "KERNEL_SECTORS" && $2 == "equ" { print $3 }' boot.asm)
+KERNEL_SIZE=$(stat -c %s kernel.bin)
+if [ "$KERNEL_SIZE" -gt $((KERNEL_SECTORS * 512)) ]; then
+    echo "Error: kernel.bin is $KERNEL_SIZE bytes, boot.asm loads only $KERNEL_SECTORS sectors ($((KERNEL_SECTORS * 512)) bytes)" >&2
+    exit 1
+fi
+
 # 创建镜像（需要更多扇区）
 dd if=/dev/zero of=os.img bs=512 count=400 conv=notrunc 2>/dev/null
 dd if=boot.bin of=os.img bs=512 count=1 conv=notrunc 2>/dev/null
 dd if=kernel.bin of=os.img bs=512 seek=1 conv=notrunc 2>/dev/null
 
+# COM1 串口控制台接到终端的标准输入输出；NOGRAPHIC=1 ./build.sh 不开窗口，只用串口
+QEMU_DISPLAY="-vga std -serial stdio"
+if [ "$NOGRAPHIC" = "1" ]; then
+    QEMU_DISPLAY="-nographic"
+fi
+
 echo "Build successful! Running QEMU..."
-qemu-system-i386 -drive file=os.img,format=raw,if=ide
+qemu-system-i386 -drive file=os.img,format=raw,if=ide $QEMU_DISPLAY
@@ -0,0 +1,50 @@
+/**
+ * clocksource.h - TSC 时钟源与单调时间
+ *
+ * 原来内核里唯一的时间就是 10ms 一次的 pit_ticks，任何比一个 tick 短的时间都量不出来。
+ * TSC (时间戳计数器) 每个 CPU 周期加一，读一次只要几十个周期，但它的频率因机器而异，
+ * 必须先用频率已知的时钟校准：
+ * - 启动时用 PIT 通道 2 (1.193182 MHz，频率固定) 计时 50ms，同时记录 TSC 的增量；
+ * - 重复几次取最小值 (SMI、虚拟机调度只会让测量值偏大)；
+ * - 由 TSC 频率算出换算系数：ns = (cycles * mult) >> CLOCK_SHIFT，之后只做乘法和移位。
+ *
+ * 没有 TSC 的 CPU 退回 tick 精度：ns = ticks * (10^9 / hz)。
+ *
+ * @see [hrtimer.md](doc/hrtimer.md)
+ */
+#ifndef CLOCKSOURCE_H
+#define CLOCKSOURCE_H
+
+#include <stdint.h>
+
+#define NSEC_PER_SEC   1000000000u
+#define NSEC_PER_MSEC  1000000u
+#define NSEC_PER_USEC  1000u
+
+#define PIT_HZ         1193182u     /* PIT 输入时钟频率 */
+#define CLOCK_SHIFT    22           /* ns = (cycles * mult) >> CLOCK_SHIFT */
+
+#define CLOCK_REALTIME  0           /* 没有 RTC，不支持 */
+#define CLOCK_MONOTONIC 1           /* 开机以来的单调时间 */
+
+struct timespec {
+    uint32_t tv_sec;
+    uint32_t tv_nsec;
+};
+
+/* 校准 TSC (启动阶段、关中断时调用，需在 pit_init 之后)。hz 为时钟节拍频率，用于回退 */
+void clocksource_init(uint32_t hz);
+
+/* 开机 (校准) 以来的单调时间，单位纳秒。任何上下文、任何 CPU 都可以调用 */
+uint64_t clock_monotonic_ns(void);
+
+/* TSC 频率 (kHz)，没有 TSC 时为 0 */
+uint32_t clocksource_tsc_khz(void);
+
+/*
+ * 取出 TSC 换算参数，供 vDSO 在用户态做同样的计算。
+ * 返回 1 表示 TSC 可用：ns = ((rdtsc() - *base) * *mult) >> *shift。
+ */
+int clocksource_tsc_params(uint32_t* mult, uint32_t* shift, uint64_t* base);
+
+#endif
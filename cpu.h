@@ -0,0 +1,159 @@
+/**
+ * cpu.h - 处理器相关的特权指令封装 (CPUID / MSR / TSC / 控制寄存器)
+ *
+ * 这些指令在多个子系统中都会用到 (APIC、时钟、性能统计……)，
+ * 统一以 static inline 的形式放在这里，避免每个文件各写一份内联汇编。
+ */
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+#include "alternative.h"
+#ifdef CONFIG_IRQSOFF_TRACE
+#include "irqsoff.h"
+#endif
+
+/* CPUID leaf 1 EDX 中的特性位 */
+#define CPUID_EDX_TSC   (1u << 4)    /* 时间戳计数器 (RDTSC) */
+#define CPUID_EDX_MSR   (1u << 5)    /* RDMSR/WRMSR */
+#define CPUID_EDX_APIC  (1u << 9)    /* 片上 Local APIC */
+#define CPUID_EDX_SEP   (1u << 11)   /* SYSENTER/SYSEXIT */
+#define CPUID_EDX_FXSR  (1u << 24)   /* FXSAVE/FXRSTOR */
+#define CPUID_EDX_SSE   (1u << 25)
+
+#define EFLAGS_IF       (1u << 9)    /* 中断允许标志 */
+
+/* 控制寄存器位 */
+#define CR0_MP          (1u << 1)    /* 与 TS 配合：WAIT/FWAIT 也触发 #NM */
+#define CR0_EM          (1u << 2)    /* 置位时所有 x87/SSE 指令触发 #NM (无 FPU 仿真) */
+#define CR0_TS          (1u << 3)    /* 任务切换标志：下一条 x87/SSE 指令触发 #NM */
+#define CR0_NE          (1u << 5)    /* x87 错误走 #MF 异常，而不是外部 IRQ13 */
+#define CR4_OSFXSR      (1u << 9)    /* 操作系统支持 FXSAVE/FXRSTOR，允许 SSE 指令 */
+#define CR4_OSXMMEXCPT  (1u << 10)   /* 未屏蔽的 SSE 浮点异常走 #XM (向量 19) */
+
+/* 常用 MSR (Model Specific Register) 编号 */
+#define MSR_APIC_BASE   0x1B
+#define MSR_SYSENTER_CS  0x174      /* SYSENTER 的内核 CS (SS = CS + 8) */
+#define MSR_SYSENTER_ESP 0x175      /* SYSENTER 的内核栈 */
+#define MSR_SYSENTER_EIP 0x176      /* SYSENTER 的入口地址 */
+
+/* CPUID：leaf 放在 EAX，结果在 EAX/EBX/ECX/EDX */
+static inline void cpuid(uint32_t leaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d) {
+    asm volatile("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(0));
+}
+
+/* 读 MSR：ECX 为编号，结果为 EDX:EAX */
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    asm volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+static inline uint32_t read_cr0(void) {
+    uint32_t v;
+    asm volatile("mov %%cr0, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr0(uint32_t v) {
+    asm volatile("mov %0, %%cr0" : : "r"(v) : "memory");
+}
+
+static inline uint32_t read_cr4(void) {
+    uint32_t v;
+    asm volatile("mov %%cr4, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr4(uint32_t v) {
+    asm volatile("mov %0, %%cr4" : : "r"(v) : "memory");
+}
+
+/* 清除 CR0.TS (专用指令，比读改写 CR0 快) */
+static inline void clts(void) {
+    asm volatile("clts" : : : "memory");
+}
+
+/*
+ * 本地 CPU 的开/关中断。内核中所有 cli/sti/popf 都应通过这几个函数，
+ * 开启 CONFIG_IRQSOFF_TRACE 时它们会通知关中断区间追踪器 (irqsoff.c)：
+ * 只有中断标志真正从 1 变 0 / 从 0 变 1 的地方才是区间的起点/终点。
+ */
+static inline uint32_t local_irq_save(void) {
+    uint32_t flags;
+    asm volatile("pushf\n\tpop %0\n\tcli" : "=r"(flags) : : "memory");
+#ifdef CONFIG_IRQSOFF_TRACE
+    if (flags & EFLAGS_IF) trace_irqs_off();
+#endif
+    return flags;
+}
+
+static inline void local_irq_restore(uint32_t flags) {
+#ifdef CONFIG_IRQSOFF_TRACE
+    if (flags & EFLAGS_IF) trace_irqs_on();
+#endif
+    asm volatile("push %0\n\tpopf" : : "r"(flags) : "memory", "cc");
+#ifdef CONFIG_IRQSOFF_TRACE
+    if (!(flags & EFLAGS_IF)) trace_irqs_off();   /* 恢复成关中断 (之前可能被开过) */
+#endif
+}
+
+static inline void local_irq_disable(void) {
+    asm volatile("cli" : : : "memory");
+#ifdef CONFIG_IRQSOFF_TRACE
+    trace_irqs_off();
+#endif
+}
+
+static inline void local_irq_enable(void) {
+#ifdef CONFIG_IRQSOFF_TRACE
+    trace_irqs_on();
+#endif
+    asm volatile("sti" : : : "memory");
+}
+
+/*
+ * 读时间戳计数器 (CPU 上电以来的时钟周期数)。
+ * 默认返回 0，alternatives_apply 之后 CPU 有 TSC 才真正执行 rdtsc：
+ * 没有 TSC 的 CPU (486) 上计时、追踪、基准测试都得到 0，而不是 #UD。
+ */
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile(ALTERNATIVE("xorl %%eax, %%eax\n\txorl %%edx, %%edx", "rdtsc", X86_FEATURE_TSC)
+                 : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* 不经修补的 rdtsc：修补之前使用 (启动计时)，调用者自己确认 CPU 有 TSC */
+static inline uint64_t rdtsc_early(void) {
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/*
+ * 64 位除以 32 位：内核不链接 libgcc，直接对 uint64_t 做除法会引用 __udivdi3。
+ * 这里用两次 32 位 divl 做“长除法”：先除高 32 位，余数作为第二次除法的高位。
+ */
+static inline uint64_t div_u64(uint64_t n, uint32_t d) {
+    uint32_t hi = (uint32_t)(n >> 32), lo = (uint32_t)n;
+    uint32_t q_hi = hi / d, r = hi % d, q_lo;
+    asm("divl %2" : "=a"(q_lo), "+d"(r) : "rm"(d), "a"(lo));
+    return ((uint64_t)q_hi << 32) | q_lo;
+}
+
+/*
+ * (a * mul) >> shift，中间结果按 96 位计算，不会因为 a 很大而溢出。
+ * 时钟源用它把 TSC 周期数换算成纳秒 (ns = cycles * mult >> shift)；
+ * 只有 32x32 乘法和移位，Ring 3 也可以调用。要求 0 < shift < 32。
+ */
+static inline uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, uint32_t shift) {
+    uint32_t hi = (uint32_t)(a >> 32), lo = (uint32_t)a;
+    return (((uint64_t)lo * mul) >> shift) + (((uint64_t)hi * mul) << (32 - shift));
+}
+
+#endif
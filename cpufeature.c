@@ -0,0 +1,137 @@
+#include "cpufeature.h"
+#include "cpu.h"
+#include "printk.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 判断有没有 CPUID 指令，没有时区分 386/486
+// - 读取 CPUID leaf 0/1/7，填写 cpu_caps[] 与 boot_cpu
+// - 按依赖关系清除不可用的特性，打印探测结果
+
+#define EFLAGS_AC   (1u << 18)      /* 486 起可写 (对齐检查) */
+#define EFLAGS_ID   (1u << 21)      /* 可写即支持 CPUID */
+
+uint32_t cpu_caps[NCAPINTS];
+cpuinfo_t boot_cpu;
+
+/* 打印用的特性名，按特性编号排列 */
+static const struct {
+    uint16_t bit;
+    const char* name;
+} cpu_cap_names[] = {
+    { X86_FEATURE_FPU,    "fpu" },
+    { X86_FEATURE_PSE,    "pse" },
+    { X86_FEATURE_TSC,    "tsc" },
+    { X86_FEATURE_MSR,    "msr" },
+    { X86_FEATURE_APIC,   "apic" },
+    { X86_FEATURE_SEP,    "sep" },
+    { X86_FEATURE_PGE,    "pge" },
+    { X86_FEATURE_FXSR,   "fxsr" },
+    { X86_FEATURE_SSE,    "sse" },
+    { X86_FEATURE_SSE2,   "sse2" },
+    { X86_FEATURE_SSE3,   "sse3" },
+    { X86_FEATURE_ERMS,   "erms" },
+    { X86_FEATURE_INVLPG, "invlpg" },
+};
+
+/* 特性 bit 依赖 need：need 不可用时 bit 也不可用 */
+static const struct {
+    uint16_t bit;
+    uint16_t need;
+} cpu_cap_deps[] = {
+    { X86_FEATURE_SSE,  X86_FEATURE_FXSR },     /* SSE 要靠 CR4.OSFXSR 打开 */
+    { X86_FEATURE_SSE2, X86_FEATURE_SSE },
+    { X86_FEATURE_SSE3, X86_FEATURE_SSE2 },
+};
+
+// 试着翻转 EFLAGS 中的某一位，能翻转说明 CPU 认识这一位
+static int eflags_can_toggle(uint32_t mask) {
+    uint32_t before, after;
+    asm volatile("pushf\n\t"
+                 "pop %0\n\t"
+                 "mov %0, %1\n\t"
+                 "xor %2, %1\n\t"
+                 "push %1\n\t"
+                 "popf\n\t"
+                 "pushf\n\t"
+                 "pop %1\n\t"
+                 "push %0\n\t"
+                 "popf"             /* 恢复原来的 EFLAGS */
+                 : "=&r"(before), "=&r"(after) : "ri"(mask) : "cc");
+    return ((before ^ after) & mask) != 0;
+}
+
+static inline void cpu_set_cap(uint32_t bit) {
+    cpu_caps[bit / 32] |= 1u << (bit % 32);
+}
+
+// 依赖表按依赖顺序排列 (SSE 在 SSE2 之前……)，一遍即可把清除传递下去
+static void cpu_apply_deps(void) {
+    for (size_t i = 0; i < sizeof(cpu_cap_deps) / sizeof(cpu_cap_deps[0]); i++) {
+        if (!cpu_has(cpu_cap_deps[i].need)) {
+            cpu_caps[cpu_cap_deps[i].bit / 32] &= ~(1u << (cpu_cap_deps[i].bit % 32));
+        }
+    }
+}
+
+void cpu_clear_cap(uint32_t bit) {
+    cpu_caps[bit / 32] &= ~(1u << (bit % 32));
+    cpu_apply_deps();
+}
+
+static void cpu_probe(void) {
+    if (!eflags_can_toggle(EFLAGS_ID)) {
+        boot_cpu.family = eflags_can_toggle(EFLAGS_AC) ? 4 : 3;
+        if (boot_cpu.family >= 4) cpu_set_cap(X86_FEATURE_INVLPG);
+        return;
+    }
+    cpu_set_cap(X86_FEATURE_CPUID);
+
+    uint32_t a, b, c, d;
+    cpuid(0, &a, &b, &c, &d);
+    boot_cpu.max_leaf = a;
+    uint32_t* v = (uint32_t*)boot_cpu.vendor;
+    v[0] = b; v[1] = d; v[2] = c;
+    boot_cpu.vendor[12] = 0;
+
+    if (boot_cpu.max_leaf >= 1) {
+        cpuid(1, &a, &b, &c, &d);
+        uint32_t family = (a >> 8) & 0xF;
+        uint32_t model = (a >> 4) & 0xF;
+        if (family == 0xF) family += (a >> 20) & 0xFF;
+        if (family >= 6) model |= ((a >> 16) & 0xF) << 4;
+        boot_cpu.family = (uint8_t)family;
+        boot_cpu.model = (uint8_t)model;
+        boot_cpu.stepping = a & 0xF;
+        cpu_caps[0] = d;
+        cpu_caps[1] = c;
+    } else {
+        boot_cpu.family = 4;        /* 有 CPUID 的 CPU 至少是晚期的 486 */
+    }
+    if (boot_cpu.max_leaf >= 7) {
+        cpuid(7, &a, &b, &c, &d);
+        cpu_caps[2] = b;
+    }
+    cpu_set_cap(X86_FEATURE_INVLPG);
+}
+
+void cpufeature_init(void) {
+    cpu_probe();
+    cpu_apply_deps();
+
+    char line[128];
+    int n = 0;
+    line[0] = 0;
+    for (size_t i = 0; i < sizeof(cpu_cap_names) / sizeof(cpu_cap_names[0]); i++) {
+        if (!cpu_has(cpu_cap_names[i].bit)) continue;
+        n += snprintk(line + n, sizeof(line) - n, " %s", cpu_cap_names[i].name);
+    }
+
+    if (cpu_has(X86_FEATURE_CPUID)) {
+        printk(KERN_INFO, "CPU: %s family %u model %u stepping %u\n",
+               boot_cpu.vendor, boot_cpu.family, boot_cpu.model, boot_cpu.stepping);
+    } else {
+        printk(KERN_INFO, "CPU: %u86 (no CPUID)\n", boot_cpu.family);
+    }
+    printk(KERN_INFO, "CPU features:%s\n", line);
+}
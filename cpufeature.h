@@ -0,0 +1,73 @@
+/**
+ * cpufeature.h - CPU 特性探测与特性位图
+ *
+ * 启动时 (cpufeature_init，在任何子系统使用特性之前) 执行一次 CPUID，把结果存进位图
+ * cpu_caps[]，之后各处用 cpu_has(X86_FEATURE_xxx) 查询，不再各自执行 CPUID
+ * (CPUID 在虚拟机里会导致 VM exit，一次上千个周期)。
+ *
+ * 位图按“字”组织，每个字对应一个 CPUID 寄存器，特性编号 = 字 * 32 + 位：
+ * - 字 0：CPUID.1:EDX；
+ * - 字 1：CPUID.1:ECX；
+ * - 字 2：CPUID.7.0:EBX；
+ * - 字 3：内核自己定义的合成特性 (没有对应的 CPUID 位，由探测代码推断)。
+ *
+ * 位图表示“可以使用”，而不只是“CPU 报告支持”：依赖关系不满足的特性会被清除
+ * (例如没有 FXSR 时 fpu_init 无法打开 SSE，SSE/SSE2 随之清除)。
+ * 所有 CPU 共用 BSP 探测的结果 (假定是同构的多处理器)。
+ *
+ * 热路径上不要用 cpu_has 做判断，用 static_cpu_has (alternative.h)：启动时直接修补指令，
+ * 运行时没有任何读内存和比较。
+ *
+ * @see [alternatives.md](doc/alternatives.md)
+ */
+#ifndef CPUFEATURE_H
+#define CPUFEATURE_H
+
+#include <stdint.h>
+
+#define NCAPINTS    4
+
+/* 字 0：CPUID.1:EDX */
+#define X86_FEATURE_FPU     (0 * 32 + 0)    /* 片上 x87 */
+#define X86_FEATURE_PSE     (0 * 32 + 3)    /* 4MB 大页 */
+#define X86_FEATURE_TSC     (0 * 32 + 4)    /* RDTSC */
+#define X86_FEATURE_MSR     (0 * 32 + 5)    /* RDMSR/WRMSR */
+#define X86_FEATURE_APIC    (0 * 32 + 9)    /* 片上 Local APIC */
+#define X86_FEATURE_SEP     (0 * 32 + 11)   /* SYSENTER/SYSEXIT */
+#define X86_FEATURE_PGE     (0 * 32 + 13)   /* 全局页 (CR4.PGE) */
+#define X86_FEATURE_FXSR    (0 * 32 + 24)   /* FXSAVE/FXRSTOR */
+#define X86_FEATURE_SSE     (0 * 32 + 25)
+#define X86_FEATURE_SSE2    (0 * 32 + 26)
+
+/* 字 1：CPUID.1:ECX */
+#define X86_FEATURE_SSE3    (1 * 32 + 0)
+
+/* 字 2：CPUID.7.0:EBX */
+#define X86_FEATURE_ERMS    (2 * 32 + 9)    /* 增强的 rep movsb/stosb */
+
+/* 字 3：合成特性 */
+#define X86_FEATURE_CPUID   (3 * 32 + 0)    /* 有 CPUID 指令 (EFLAGS.ID 可改写) */
+#define X86_FEATURE_INVLPG  (3 * 32 + 1)    /* 486 及以后：INVLPG 指令 */
+
+typedef struct cpuinfo {
+    char vendor[13];            /* "GenuineIntel"、"AuthenticAMD"……，没有 CPUID 时为空 */
+    uint8_t family;             /* 没有 CPUID 时按 EFLAGS.AC 区分 3 (386) 和 4 (486) */
+    uint8_t model;
+    uint8_t stepping;
+    uint32_t max_leaf;          /* CPUID 支持的最大基本 leaf */
+} cpuinfo_t;
+
+extern uint32_t cpu_caps[NCAPINTS];
+extern cpuinfo_t boot_cpu;
+
+static inline int cpu_has(uint32_t bit) {
+    return (cpu_caps[bit / 32] >> (bit % 32)) & 1;
+}
+
+/* 探测 BSP 的特性并打印 (kmain 最早调用；必须在 alternatives_apply 之前) */
+void cpufeature_init(void);
+
+/* 清除一个特性 (某个子系统发现特性虽有但不能用时)，须在 alternatives_apply 之前 */
+void cpu_clear_cap(uint32_t bit);
+
+#endif
@@ -0,0 +1,249 @@
+#include "fbcon.h"
+#include "font.h"
+#include "terminal.h"
+#include "pmm.h"
+#include "vmm.h"
+#include "printk.h"
+#include "string.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 在 PCI 总线 0 上找到 Bochs/QEMU 标准显卡，读出线性帧缓冲的物理地址 (BAR0)
+// - 通过 DISPI 寄存器切换到 640x400x8 图形模式，设置 16 色调色板
+// - 字符单元 → 后备缓冲的字形绘制 (每次写 4 个像素)，按损坏矩形拷进显存
+//
+// 并发说明：fb_cells、后备缓冲与损坏区间只在 terminal_lock 内访问 (terminal_flush 调用
+// fbcon_update)。fbcon_emergency_write 不拿锁，只写显存，下一次 flush 会覆盖它。
+
+#define FB_WIDTH        (FBCON_COLS * FONT_WIDTH)       /* 640 */
+#define FB_HEIGHT       (FBCON_ROWS * FONT_HEIGHT)      /* 400 */
+#define FB_BPP          8
+#define FB_PITCH_WORDS  (FB_WIDTH / 4)                  /* 每条扫描线的 32 位字数 */
+#define FB_SIZE         (FB_WIDTH * FB_HEIGHT)          /* 8 位色：一个像素一个字节 */
+#define FB_ROW_WORDS    (FB_PITCH_WORDS * FONT_HEIGHT)  /* 一个字符行的 32 位字数 */
+
+#define PCI_CONFIG_ADDR 0xCF8
+#define PCI_CONFIG_DATA 0xCFC
+#define BOCHS_VGA_ID    0x11111234      /* 设备号 << 16 | 厂商号 */
+
+#define DISPI_INDEX         0x1CE
+#define DISPI_DATA          0x1CF
+#define DISPI_REG_ID        0
+#define DISPI_REG_XRES      1
+#define DISPI_REG_YRES      2
+#define DISPI_REG_BPP       3
+#define DISPI_REG_ENABLE    4
+#define DISPI_ID2           0xB0C2      /* 支持线性帧缓冲与 8 位色的最低版本 */
+#define DISPI_ENABLED       0x01
+#define DISPI_LFB_ENABLED   0x40
+
+#define VGA_DAC_WRITE   0x3C8
+#define VGA_DAC_DATA    0x3C9
+
+static inline void outb(uint16_t port, uint8_t val) {
+    asm volatile ( "outb %0, %1" : : "a"(val), "Nd"(port) );
+}
+
+static inline void outw(uint16_t port, uint16_t val) {
+    asm volatile ( "outw %0, %1" : : "a"(val), "Nd"(port) );
+}
+
+static inline uint16_t inw(uint16_t port) {
+    uint16_t ret;
+    asm volatile ( "inw %1, %0" : "=a"(ret) : "Nd"(port) );
+    return ret;
+}
+
+static inline void outl(uint16_t port, uint32_t val) {
+    asm volatile ( "outl %0, %1" : : "a"(val), "Nd"(port) );
+}
+
+static inline uint32_t inl(uint16_t port) {
+    uint32_t ret;
+    asm volatile ( "inl %1, %0" : "=a"(ret) : "Nd"(port) );
+    return ret;
+}
+
+static volatile uint32_t* fb_lfb = NULL;    /* 线性帧缓冲 (显存) */
+static uint32_t* fb_back = NULL;            /* 后备缓冲：与屏幕同样大小的内存 */
+
+/* 后备缓冲中每个位置画的是哪个单元。初始全 0 (黑底黑字)，与清零的后备缓冲一致 */
+static uint16_t fb_cells[FBCON_ROWS * FBCON_COLS];
+
+/* 每个字符行的损坏区间 [lo, hi) (列)，lo >= hi 表示这一行不用拷贝 */
+static uint8_t fb_damage_lo[FBCON_ROWS];
+static uint8_t fb_damage_hi[FBCON_ROWS];
+
+// 4 位点阵 → 4 个像素的字节掩码 (小端：最左边的像素在最低字节)。
+// 点阵的 bit 3 是这 4 个像素中最左边的一个
+static const uint32_t fb_nibble_mask[16] = {
+    0x00000000, 0xFF000000, 0x00FF0000, 0xFFFF0000,
+    0x0000FF00, 0xFF00FF00, 0x00FFFF00, 0xFFFFFF00,
+    0x000000FF, 0xFF0000FF, 0x00FF00FF, 0xFFFF00FF,
+    0x0000FFFF, 0xFF00FFFF, 0x00FFFFFF, 0xFFFFFFFF,
+};
+
+// VGA 文本模式的 16 色 (DAC 为 6 位：0..63)
+static const uint8_t fb_palette[16][3] = {
+    {  0,  0,  0 }, {  0,  0, 42 }, {  0, 42,  0 }, {  0, 42, 42 },
+    { 42,  0,  0 }, { 42,  0, 42 }, { 42, 21,  0 }, { 42, 42, 42 },
+    { 21, 21, 21 }, { 21, 21, 63 }, { 21, 63, 21 }, { 21, 63, 63 },
+    { 63, 21, 21 }, { 63, 21, 63 }, { 63, 63, 21 }, { 63, 63, 63 },
+};
+
+static inline void dispi_write(uint16_t reg, uint16_t val) {
+    outw(DISPI_INDEX, reg);
+    outw(DISPI_DATA, val);
+}
+
+static inline uint16_t dispi_read(uint16_t reg) {
+    outw(DISPI_INDEX, reg);
+    return inw(DISPI_DATA);
+}
+
+static inline uint32_t pci_read(uint32_t bus, uint32_t dev, uint32_t reg) {
+    outl(PCI_CONFIG_ADDR, 0x80000000u | (bus << 16) | (dev << 11) | (reg & 0xFC));
+    return inl(PCI_CONFIG_DATA);
+}
+
+// 在总线 0 上查找标准显卡，返回线性帧缓冲的物理地址 (BAR0，可预取的内存 BAR)，找不到返回 0
+static uint32_t fbcon_find_lfb(void) {
+    for (uint32_t dev = 0; dev < 32; dev++) {
+        if (pci_read(0, dev, 0x00) != BOCHS_VGA_ID) continue;
+        uint32_t bar0 = pci_read(0, dev, 0x10);
+        if (bar0 & 0x1) return 0;       /* I/O BAR，不是帧缓冲 */
+        return bar0 & 0xFFFFFFF0;
+    }
+    return 0;
+}
+
+// 把一个单元画到 dst (字符左上角，扫描线间隔 FB_PITCH_WORDS 个字)。
+// 每条扫描线 8 个像素 = 2 个 32 位字：前景色、背景色各扩展到 4 个字节，
+// 按点阵的高/低 4 位查表得到掩码，bg ^ ((fg ^ bg) & mask) 一次得到 4 个像素
+static inline void fbcon_blit(uint32_t* dst, uint16_t cell) {
+    uint8_t c = (uint8_t)cell;
+    const uint8_t* glyph = font_8x16[c < FONT_GLYPHS ? c : FONT_UNKNOWN];
+    uint32_t fg = ((cell >> 8) & 0x0F) * 0x01010101u;
+    uint32_t bg = ((cell >> 12) & 0x0F) * 0x01010101u;
+    uint32_t diff = fg ^ bg;
+    for (int y = 0; y < FONT_HEIGHT; y++) {
+        uint8_t bits = glyph[y];
+        dst[0] = bg ^ (diff & fb_nibble_mask[bits >> 4]);
+        dst[1] = bg ^ (diff & fb_nibble_mask[bits & 0x0F]);
+        dst += FB_PITCH_WORDS;
+    }
+}
+
+static inline void fbcon_damage(size_t row, size_t lo, size_t hi) {
+    if (lo < fb_damage_lo[row]) fb_damage_lo[row] = (uint8_t)lo;
+    if (hi > fb_damage_hi[row]) fb_damage_hi[row] = (uint8_t)hi;
+}
+
+// 显示起始行下移了 lines 行：后备缓冲和 fb_cells 在内存中整体上移，被移动的字形不用重画。
+// 最后 lines 行保持原样 (像素与 fb_cells 仍然一致)，由随后的逐单元比较更新。
+// 显存里的画面整体变了，所有行都要拷贝
+static void fbcon_scroll(size_t lines) {
+    size_t keep = FBCON_ROWS - lines;
+    memmove(fb_back, fb_back + lines * FB_ROW_WORDS, keep * FB_ROW_WORDS * 4);
+    memmove(fb_cells, &fb_cells[lines * FBCON_COLS], keep * FBCON_COLS * sizeof(fb_cells[0]));
+
+    for (size_t row = 0; row < FBCON_ROWS; row++) fbcon_damage(row, 0, FBCON_COLS);
+}
+
+// 把损坏矩形从后备缓冲拷进显存 (按 32 位写，从不读显存)
+static void fbcon_flush(void) {
+    for (size_t row = 0; row < FBCON_ROWS; row++) {
+        size_t lo = fb_damage_lo[row], hi = fb_damage_hi[row];
+        if (lo >= hi) continue;
+        fb_damage_lo[row] = FBCON_COLS;
+        fb_damage_hi[row] = 0;
+
+        size_t first = row * FB_ROW_WORDS + lo * 2;
+        size_t words = (hi - lo) * 2;
+        for (size_t y = 0; y < FONT_HEIGHT; y++) {
+            memcpy((void*)(fb_lfb + first + y * FB_PITCH_WORDS),
+                   fb_back + first + y * FB_PITCH_WORDS, words * 4);
+        }
+    }
+}
+
+void fbcon_update(const uint16_t* cells, int scrolled) {
+    if (scrolled > 0 && scrolled < FBCON_ROWS) fbcon_scroll((size_t)scrolled);
+
+    for (size_t row = 0; row < FBCON_ROWS; row++) {
+        const uint16_t* src = &cells[row * FBCON_COLS];
+        uint16_t* old = &fb_cells[row * FBCON_COLS];
+        uint32_t* dst = fb_back + row * FB_ROW_WORDS;
+        size_t lo = FBCON_COLS, hi = 0;
+        for (size_t col = 0; col < FBCON_COLS; col++) {
+            if (src[col] == old[col]) continue;
+            old[col] = src[col];
+            fbcon_blit(dst + col * 2, src[col]);
+            if (col < lo) lo = col;
+            hi = col + 1;
+        }
+        if (lo < hi) fbcon_damage(row, lo, hi);
+    }
+    fbcon_flush();
+}
+
+void fbcon_emergency_write(const char* data, uint8_t color) {
+    if (!fb_lfb) return;
+    uint32_t* row0 = (uint32_t*)fb_lfb;
+    for (size_t i = 0; data[i] && i < FBCON_COLS; i++) {
+        fbcon_blit(row0 + i * 2, (uint16_t)((uint8_t)data[i] | (uint16_t)color << 8));
+    }
+}
+
+int fbcon_init(void) {
+    uint32_t lfb = fbcon_find_lfb();
+    if (!lfb || dispi_read(DISPI_REG_ID) < DISPI_ID2) {
+        printk(KERN_INFO, "fbcon: no Bochs/QEMU VBE display, staying in text mode\n");
+        return 0;
+    }
+
+    /* 后备缓冲：250KB 物理连续内存 (内核堆只有 1MB)，恒等映射后直接用物理地址访问 */
+    uint32_t pages = (FB_SIZE + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint32_t back = pmm_alloc_contiguous(pages);
+    if (!back) {
+        printk(KERN_WARNING, "fbcon: no memory for back buffer, staying in text mode\n");
+        return 0;
+    }
+    /* 显存只写不读：写直通 (PWT)，写入立即到达设备，不在缓存里滞留 */
+    if (vmm_identity_map(back, FB_SIZE, PAGE_RW) != 0 ||
+        vmm_identity_map(lfb, FB_SIZE, PAGE_RW | PAGE_PWT) != 0) {
+        /* 先拆掉已经建好的映射 (可能只映射了一部分，未映射的页会被跳过)，再归还物理页，
+           否则这些帧被重新分配给别人后，内核仍能通过旧的恒等映射写到它们 */
+        vmm_identity_unmap(back, FB_SIZE);
+        vmm_identity_unmap(lfb, FB_SIZE);
+        for (uint32_t i = 0; i < pages; i++) pmm_free_page(back + i * PAGE_SIZE);
+        printk(KERN_WARNING, "fbcon: cannot map framebuffer, staying in text mode\n");
+        return 0;
+    }
+    fb_back = (uint32_t*)back;
+    memset(fb_back, 0, FB_SIZE);
+    for (size_t row = 0; row < FBCON_ROWS; row++) {
+        fb_damage_lo[row] = FBCON_COLS;
+        fb_damage_hi[row] = 0;
+    }
+
+    /* 切换模式 (打开时显卡会清空显存，与全 0 的后备缓冲一致)，再设置前 16 项调色板 */
+    dispi_write(DISPI_REG_ENABLE, 0);
+    dispi_write(DISPI_REG_XRES, FB_WIDTH);
+    dispi_write(DISPI_REG_YRES, FB_HEIGHT);
+    dispi_write(DISPI_REG_BPP, FB_BPP);
+    dispi_write(DISPI_REG_ENABLE, DISPI_ENABLED | DISPI_LFB_ENABLED);
+    outb(VGA_DAC_WRITE, 0);
+    for (int i = 0; i < 16; i++) {
+        outb(VGA_DAC_DATA, fb_palette[i][0]);
+        outb(VGA_DAC_DATA, fb_palette[i][1]);
+        outb(VGA_DAC_DATA, fb_palette[i][2]);
+    }
+    fb_lfb = (volatile uint32_t*)lfb;
+
+    /* 终端改由 fbcon 显示，当前屏幕的内容整体重画一次 */
+    terminal_attach_fb();
+    printk(KERN_INFO, "fbcon: %ux%ux%u framebuffer at %p, back buffer at %p\n",
+           FB_WIDTH, FB_HEIGHT, FB_BPP, (void*)lfb, (void*)back);
+    return 1;
+}
@@ -0,0 +1,39 @@
+/**
+ * fbcon.h - 线性帧缓冲 (VBE LFB) 图形控制台
+ *
+ * QEMU 的标准显卡 (-vga std，PCI 1234:1111) 实现了 Bochs VBE 扩展 (DISPI)：
+ * 通过 I/O 端口 0x1CE/0x1CF 设置分辨率和色深，显存整体映射在 PCI BAR0 (线性帧缓冲)。
+ * BIOS 的 VBE 调用 (INT 10h AX=4F02h) 最终也是写这组寄存器，
+ * 所以内核在保护模式下直接编程，不需要回到实模式。
+ *
+ * 显示模式：640x400，8 位调色板 (前 16 项设为 VGA 文本模式的 16 色)，正好 80x25 个 8x16 字符。
+ * 终端 (terminal.c) 仍然只维护字符单元 (shadow)，flush 时交给 fbcon：
+ * - 与上次画过的单元逐个比较，只有变化的单元重画到内存中的后备缓冲 (back buffer)；
+ * - 字形按行展开成 2 个 32 位字 (8 个像素)，查表得到掩码后一次写 4 个像素；
+ * - 每个字符行记录一个损坏区间 [lo, hi)，最后只把这些矩形从后备缓冲拷进显存；
+ * - 滚屏时后备缓冲在内存中整体上移，不用重画字形，也从不读显存。
+ *
+ * 只在 FBCON=1 构建时启用；找不到显卡或任一步失败都留在文本模式。
+ * 所有函数 (除 fbcon_init、fbcon_emergency_write) 都在 terminal_lock 内调用。
+ *
+ * @see [fbcon.md](doc/fbcon.md)
+ */
+#ifndef FBCON_H
+#define FBCON_H
+
+#include <stdint.h>
+
+#define FBCON_COLS      80
+#define FBCON_ROWS      25
+
+/* 探测显卡、切换到图形模式并接管终端显示。返回 0 表示继续使用文本模式 (需在 vmm_init 之后调用) */
+int fbcon_init(void);
+
+/* 让屏幕显示 cells (80x25 个 VGA 文本单元：低字节字符，高字节颜色)。
+   scrolled 为显示起始行相对上次调用下移的行数，用于在后备缓冲中直接滚屏 */
+void fbcon_update(const uint16_t* cells, int scrolled);
+
+/* 致命异常路径：不拿锁，直接把字符画进显存的第 0 行 */
+void fbcon_emergency_write(const char* data, uint8_t color);
+
+#endif
@@ -0,0 +1,22 @@
+/**
+ * font.h - 内嵌的 8x16 点阵字体
+ *
+ * 文本模式下字形由显卡自己画；切换到线性帧缓冲 (fbcon) 以后，
+ * 每个字符都要由内核按点阵写成像素，字体随内核一起链接，不依赖 BIOS。
+ *
+ * @see [fbcon.md](doc/fbcon.md)
+ */
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdint.h>
+
+#define FONT_WIDTH      8
+#define FONT_HEIGHT     16
+#define FONT_GLYPHS     128
+#define FONT_UNKNOWN    0x7F    /* 字体中没有的字符显示为方框 */
+
+/* 每个字形 16 字节，每字节一行，bit 7 为最左边的像素 */
+extern const uint8_t font_8x16[FONT_GLYPHS][FONT_HEIGHT];
+
+#endif
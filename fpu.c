@@ -0,0 +1,100 @@
+#include "fpu.h"
+#include "process.h"
+#include "smp.h"
+#include "heap.h"
+#include "printk.h"
+#include "string.h"
+#include "cpu.h"
+#include "alternative.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 每个 CPU 的 FPU/SSE 使能 (CR0.EM/MP/NE、CR4.OSFXSR/OSXMMEXCPT)
+// - #NM 处理：按需分配任务的 FXSAVE 区并装入状态
+// - 任务切换时保存用过 FPU 的任务的状态，并置 CR0.TS
+//
+// 不变式：任务不在运行时，它最新的 FPU 状态一定在自己的 fpu_state 中。
+// (切走时 TS 被清除过就 FXSAVE，没清除说明它这段时间根本没碰 FPU。)
+// 因此 #NM 从不需要替别的任务保存状态，任务也可以随时被迁移到其他 CPU。
+//
+// fpu_owner 只是一个“寄存器里也许还留着谁的状态”的提示：
+// 只有 owner 就是当前任务、且它上一次装入状态就在这个 CPU 上时才跳过 FXRSTOR
+// (任务迁移到别的 CPU 并在那里用过 FPU，fpu_cpu 就会变化)。
+
+static int fpu_ok = 0;
+
+/* FNINIT 之后的干净状态 (FCW=0x37F、MXCSR=0x1F80，所有异常屏蔽)，任务第一次使用 FPU 时复制它 */
+static uint8_t fpu_init_state[FPU_STATE_SIZE] __attribute__((aligned(16)));
+
+static inline void fxsave(uint8_t* area) {
+    asm volatile("fxsave (%0)" : : "r"(area) : "memory");
+}
+
+static inline void fxrstor(const uint8_t* area) {
+    asm volatile("fxrstor (%0)" : : "r"(area) : "memory");
+}
+
+void fpu_init(void) {
+    if (!cpu_has(X86_FEATURE_FXSR)) {
+        write_cr0(read_cr0() | CR0_EM);
+        if (smp_processor_id() == 0) printk(KERN_WARNING, "FPU: no FXSR, x87/SSE disabled\n");
+        return;
+    }
+
+    uint32_t cr0 = read_cr0();
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP | CR0_NE;
+    write_cr0(cr0);
+
+    uint32_t cr4 = read_cr4() | CR4_OSFXSR;
+    if (cpu_has(X86_FEATURE_SSE)) cr4 |= CR4_OSXMMEXCPT;
+    write_cr4(cr4);
+
+    asm volatile("fninit");
+    if (smp_processor_id() == 0) {
+        fxsave(fpu_init_state);
+        fpu_ok = 1;
+        printk(KERN_INFO, "FPU: %s, lazy switching\n", cpu_has(X86_FEATURE_SSE) ? "x87 + SSE" : "x87");
+    }
+
+    /* 寄存器里不属于任何任务：第一次使用时触发 #NM */
+    this_cpu()->fpu_owner = NULL;
+    write_cr0(cr0 | CR0_TS);
+}
+
+int fpu_handle_nm(void) {
+    if (!fpu_ok) return 0;
+    cpu_t* c = this_cpu();
+    process_t* cur = c->current;
+    if (!cur) return 0;
+
+    clts();
+    c->nr_fpu_traps++;
+
+    /* 切走之后这个 CPU 上没有别人用过 FPU：寄存器里就是它的状态 */
+    if (c->fpu_owner == cur && cur->fpu_cpu == c->id) return 1;
+
+    if (!cur->fpu_state) {
+        /* kmalloc 只保证 4 字节对齐，多分配 15 字节自行对齐到 16 (任务不会退出，无需保存原指针) */
+        uint8_t* raw = (uint8_t*)kmalloc(FPU_STATE_SIZE + 15);
+        if (!raw) return 0;
+        uint8_t* state = (uint8_t*)(((uint32_t)raw + 15) & ~15u);
+        memcpy(state, fpu_init_state, FPU_STATE_SIZE);
+        cur->fpu_state = state;
+    }
+
+    fxrstor(cur->fpu_state);
+    c->nr_fpu_restores++;
+    c->fpu_owner = cur;
+    cur->fpu_cpu = c->id;
+    return 1;
+}
+
+// 每次任务切换都会调用：是否支持 FXSR 在启动时修补决定，不读 fpu_ok
+void fpu_switch_out(process_t* prev) {
+    if (!static_cpu_has(X86_FEATURE_FXSR)) return;
+    uint32_t cr0 = read_cr0();
+    if (cr0 & CR0_TS) return;          /* 这个时间片没碰过 FPU：什么都不用做 */
+    if (prev->fpu_state) fxsave(prev->fpu_state);
+    write_cr0(cr0 | CR0_TS);
+}
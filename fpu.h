@@ -0,0 +1,39 @@
+/**
+ * fpu.h - x87/SSE 状态的惰性切换 (Lazy FPU)
+ *
+ * 任务切换 (isr.asm + schedule) 只保存通用寄存器和段寄存器，x87/MMX/SSE 寄存器
+ * (FXSAVE 镜像 512 字节) 不在其中：一个任务用了浮点或 SIMD，另一个任务就会看到被改乱的寄存器。
+ *
+ * 每次切换都 FXSAVE/FXRSTOR 要多花几百个周期，而大多数任务根本不碰 FPU。做法与早期 Linux 相同：
+ * - 切换任务时置 CR0.TS，新任务第一次执行 x87/SSE 指令会触发 #NM (向量 7)；
+ * - #NM 处理函数清除 TS，把这个任务的 FPU 状态 FXRSTOR 进寄存器，任务继续执行；
+ * - 切走时只有“本时间片内用过 FPU”(TS 已被清除) 的任务才需要 FXSAVE。
+ * 从不碰 FPU 的任务既没有 #NM，也没有 FXSAVE/FXRSTOR，状态区也不会被分配。
+ *
+ * 每个 CPU 记录寄存器里现在是谁的状态 (fpu_owner)：任务切走又切回、期间没有别的任务
+ * 用过这个 CPU 的 FPU 时，#NM 只需要 clts，连 FXRSTOR 都省了。
+ *
+ * 限制：中断处理函数与软中断不能使用 FPU，它们会改乱被打断任务的寄存器。
+ * 不支持 FXSR 的 CPU 上保持 CR0.EM，任何 x87/SSE 指令仍是致命异常。
+ *
+ * @see [fpu.md](doc/fpu.md)
+ */
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdint.h>
+
+#define FPU_STATE_SIZE  512     /* FXSAVE 镜像大小，要求 16 字节对齐 */
+#define FPU_NO_CPU      0xFFFFFFFF
+
+/* 本 CPU 的 FPU 初始化：CR0/CR4 设置、FNINIT，并置 TS (BSP 与每个 AP 各调用一次) */
+void fpu_init(void);
+
+/* #NM (向量 7) 处理：为当前任务装入 FPU 状态。返回 0 表示无法处理 (按致命异常处理) */
+int fpu_handle_nm(void);
+
+/* 由 schedule() 在切换到其他任务前调用：prev 本时间片用过 FPU 时保存其状态并置 TS */
+struct process;
+void fpu_switch_out(struct process* prev);
+
+#endif
@@ -8,8 +8,9 @@ gdt_flush:
     mov ds, ax
     mov es, ax
     mov fs, ax
-    mov gs, ax
     mov ss, ax
+    mov ax, 0x30       ; 每 CPU 数据段 (基址指向本 CPU 的 cpu_t)
+    mov gs, ax
     
     jmp 0x08:.flush   ; 长跳转刷新CS
 .flush:
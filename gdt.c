@@ -1,8 +1,15 @@
 #include "gdt.h"
+#include "smp.h"
+#include "string.h"
 
-struct gdt_entry gdt[6];
-struct gdt_ptr gp;
-tss_entry_t tss_entry;
+// 每个 CPU 一套 GDT/TSS：
+// - TSS 里保存的 esp0 是“该 CPU 上当前进程”的内核栈，显然不能共享；
+// - GDT 第 6 项 (0x30) 的段基址指向各自的 cpu_t，用于每 CPU 数据。
+// 所有 CPU 的选择子编号完全相同，同一段代码在不同 CPU 上自动用到各自的表。
+static struct gdt_entry gdt_tables[SMP_MAX_CPUS][GDT_ENTRIES];
+static struct gdt_ptr gdt_ptrs[SMP_MAX_CPUS];
+static tss_entry_t tss_entries[SMP_MAX_CPUS];
+static struct gdt_entry* gdt = gdt_tables[0];   /* gdt_set_gate 正在填写的表 */
 
 extern void gdt_flush(uint32_t);  // 汇编函数声明
 
@@ -19,37 +26,49 @@ void gdt_set_gate(int num, uint32_t base, uint32_t limit, uint8_t access, uint8_
 }
 
 // 初始化 TSS
-static void write_tss(int num, uint16_t ss0, uint32_t esp0) {
-    uint32_t base = (uint32_t)&tss_entry;
-    uint32_t limit = sizeof(tss_entry) - 1; // 修正：这是段限长，不是地址
+static void write_tss(int num, tss_entry_t* tss, uint16_t ss0, uint32_t esp0) {
+    uint32_t base = (uint32_t)tss;
+    uint32_t limit = sizeof(tss_entry_t) - 1; // 修正：这是段限长，不是地址
     
     // 在 GDT 中记录 TSS (0x89: P=1, DPL=0, Type=9: Available 32-bit TSS)
     gdt_set_gate(num, base, limit, 0x89, 0x00);
     
     // 填充 TSS 结构体
-    for(int i = 0; i < sizeof(tss_entry); i++) ((char*)&tss_entry)[i] = 0;
+    memset(tss, 0, sizeof(tss_entry_t));
     
-    tss_entry.ss0 = ss0;   // 内核数据段选择子
-    tss_entry.esp0 = esp0; // 内核栈顶
+    tss->ss0 = ss0;   // 内核数据段选择子
+    tss->esp0 = esp0; // 内核栈顶
     
     // 设置段选择子 (必须要设置，否则切换时崩溃)
-    tss_entry.cs = 0x08 | 0x3;
-    tss_entry.ss = 0x10 | 0x3;
-    tss_entry.ds = 0x10 | 0x3;
-    tss_entry.es = 0x10 | 0x3;
-    tss_entry.fs = 0x10 | 0x3;
-    tss_entry.gs = 0x10 | 0x3;
+    tss->cs = 0x08 | 0x3;
+    tss->ss = 0x10 | 0x3;
+    tss->ds = 0x10 | 0x3;
+    tss->es = 0x10 | 0x3;
+    tss->fs = 0x10 | 0x3;
+    tss->gs = 0x10 | 0x3;
 }
 
 // 供调度器调用，更新当前进程的内核栈，以便中断发生时能正确切换回内核态
+// (只修改本 CPU 的 TSS)
 void tss_set_stack(uint32_t stack) {
-    tss_entry.esp0 = stack;
+    tss_entries[smp_processor_id()].esp0 = stack;
 }
 
-// 初始化 GDT
+tss_entry_t* tss_get(uint32_t cpu) {
+    return &tss_entries[cpu];
+}
+
+// 初始化 BSP 的 GDT
 void gdt_init(void) {
-    gp.limit = (sizeof(struct gdt_entry) * 6) - 1;
-    gp.base = (uint32_t)&gdt;
+    gdt_init_cpu(0, 0x90000);
+}
+
+// 初始化第 cpu 个处理器的 GDT/TSS 并加载 (BSP 与每个 AP 各调用一次)
+void gdt_init_cpu(uint32_t cpu, uint32_t esp0) {
+    gdt = gdt_tables[cpu];
+    struct gdt_ptr* gp = &gdt_ptrs[cpu];
+    gp->limit = (sizeof(struct gdt_entry) * GDT_ENTRIES) - 1;
+    gp->base = (uint32_t)gdt;
     
     // 0: 空描述符
     gdt_set_gate(0, 0, 0, 0, 0);
@@ -71,8 +90,15 @@ void gdt_init(void) {
     // 5: TSS (Task State Segment)
     // 我们暂时把内核栈设为 0x90000 (bootloader初始栈)
     // 实际上多任务启动后，调度器会动态更新它
-    write_tss(5, 0x10, 0x90000);
+    write_tss(5, &tss_entries[cpu], 0x10, esp0);
+
+    // 6: 每 CPU 数据段 (Base=&cpu_t, 字节粒度, Ring0)
+    // 段基址在加载 GS 时被缓存进段寄存器，之后 %gs:X 直接访问本 CPU 的数据
+    cpu_t* c = smp_cpu(cpu);
+    c->self = c;
+    c->id = cpu;
+    gdt_set_gate(6, (uint32_t)c, sizeof(cpu_t) - 1, 0x92, 0x40);
     
-    // 加载 GDT 并在汇编中 ltr
-    gdt_flush((uint32_t)&gp);
+    // 加载 GDT 并在汇编中 ltr (同时把 GS 设为 0x30)
+    gdt_flush((uint32_t)gp);
 }
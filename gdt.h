@@ -52,8 +52,13 @@ struct tss_entry_struct {
 
 typedef struct tss_entry_struct tss_entry_t;
 
+// 每个 CPU 的 GDT 项数：空/内核代码/内核数据/用户代码/用户数据/TSS/每 CPU 数据
+#define GDT_ENTRIES 7
+
 // 函数声明
 void gdt_init(void);
+void gdt_init_cpu(uint32_t cpu, uint32_t esp0);
+tss_entry_t* tss_get(uint32_t cpu);
 void gdt_set_gate(int num, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran);
 void tss_set_stack(uint32_t stack);
 
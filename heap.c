@@ -1,9 +1,14 @@
 #include "heap.h"
-#include "terminal.h"
+#include "printk.h"
+#include "spinlock.h"
+#include "trace.h"
 
 /* 堆的链表头指针，指向第一个内存块的 Header */
 static header_t* heap_head = NULL;
 
+/* SMP：多个 CPU 可能同时分配/释放，链表操作整体加锁 */
+static spinlock_t heap_lock = SPINLOCK_INIT("heap");
+
 /**
  * @brief 初始化内核堆
  * 
@@ -20,7 +25,7 @@ void kheap_init(void) {
     heap_head->next = NULL;
     heap_head->is_free = 1;
     
-    terminal_writestring("Heap initialized at 0xD0000000 (1MB)\n");
+    printk(KERN_INFO, "Heap initialized at 0xD0000000 (1MB)\n");
 }
 
 /**
@@ -36,7 +41,7 @@ void kheap_init(void) {
  * @param size 请求分配的字节数
  * @return void* 指向数据区的指针 (跳过 Header)
  */
-void* kmalloc(size_t size) {
+static void* heap_alloc(size_t size) {
     if (size == 0) return NULL;
     
     /* 内存对齐：将请求大小向上对齐到 4 字节
@@ -80,7 +85,7 @@ void* kmalloc(size_t size) {
         curr = curr->next;
     }
     
-    terminal_writestring("OOM: kmalloc failed!\n");
+    printk(KERN_ERR, "OOM: kmalloc(%u) failed!\n", size);
     return NULL;
 }
 
@@ -93,8 +98,17 @@ void* kmalloc(size_t size) {
  * 
  * @param ptr 要释放的内存指针
  */
+void* kmalloc(size_t size) {
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    void* ptr = heap_alloc(size);
+    spin_unlock_irqrestore(&heap_lock, flags);
+    TRACE_POINT(TRACE_KMALLOC, size, ptr);
+    return ptr;
+}
+
 void kfree(void* ptr) {
     if (ptr == NULL) return;
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
     
     /* 回退到 Header：用户拿到的是数据区指针，Header 在它前面 */
     header_t* header = (header_t*)((uint32_t)ptr - sizeof(header_t));
@@ -114,4 +128,5 @@ void kfree(void* ptr) {
         // 删除下一个节点
         header->next = header->next->next;
     }
+    spin_unlock_irqrestore(&heap_lock, flags);
 }
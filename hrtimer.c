@@ -0,0 +1,116 @@
+#include "hrtimer.h"
+#include "clocksource.h"
+#include "interrupts.h"
+#include "spinlock.h"
+#include "printk.h"
+#include "cpu.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 按到期时刻排序的定时器队列 (单链表，插入 O(n)，取最早的 O(1))
+// - 事件设备：PIT 通道 0 单次模式，总是设定为队首定时器的到期时刻
+// - 到期处理：在 IRQ0 (单次模式) 或 BSP 的时钟节拍 (回退模式) 中执行回调
+//
+// 队列由 hrtimer_lock 保护，任何 CPU 都可以启动/取消定时器。
+// PIT 是全局设备，重新设定它也在锁内完成；IRQ0 由 IOAPIC 固定送往 BSP。
+// 回调执行时不持锁，回调里可以再次启动定时器。
+
+#define PIT_MAX_NS (50 * NSEC_PER_MSEC)   /* 单次最长设定 (PIT 计数 16 位，约 54.9ms) */
+
+static struct hrtimer* hrtimer_head = NULL;
+static spinlock_t hrtimer_lock = SPINLOCK_INIT("hrtimer");
+static int hrtimer_oneshot = 0;     /* 1: PIT 通道 0 作为单次事件设备 */
+
+// 持锁调用：把 PIT 设定为队首定时器的到期时刻。
+// 计数值向上取整，中断不会早于到期时刻到来；太远的到期时刻先设定 PIT_MAX_NS，
+// 中断到来时发现没有到期的定时器，再设定下一段。
+static void hrtimer_program(uint64_t now) {
+    if (!hrtimer_oneshot) return;
+    if (!hrtimer_head) {
+        pit_oneshot_disarm();
+        return;
+    }
+    uint64_t delta = hrtimer_head->expires > now ? hrtimer_head->expires - now : 0;
+    if (delta > PIT_MAX_NS) delta = PIT_MAX_NS;
+    uint32_t count = (uint32_t)div_u64(delta * PIT_HZ + NSEC_PER_SEC - 1, NSEC_PER_SEC);
+    if (count == 0) count = 1;
+    pit_oneshot_arm(count);
+}
+
+// 持锁调用
+static int hrtimer_dequeue(struct hrtimer* timer) {
+    if (!timer->queued) return 0;
+    struct hrtimer** pp = &hrtimer_head;
+    while (*pp && *pp != timer) pp = &(*pp)->next;
+    if (*pp) *pp = timer->next;
+    timer->next = NULL;
+    timer->queued = 0;
+    return 1;
+}
+
+void hrtimer_start(struct hrtimer* timer, uint64_t expires) {
+    uint32_t flags = spin_lock_irqsave(&hrtimer_lock);
+    hrtimer_dequeue(timer);
+    timer->expires = expires;
+
+    /* 到期时刻相同的定时器按启动顺序排列 */
+    struct hrtimer** pp = &hrtimer_head;
+    while (*pp && (*pp)->expires <= expires) pp = &(*pp)->next;
+    timer->next = *pp;
+    *pp = timer;
+    timer->queued = 1;
+
+    /* 只有新的定时器排在队首时，硬件的到期时刻才需要提前 */
+    if (hrtimer_head == timer) hrtimer_program(clock_monotonic_ns());
+    spin_unlock_irqrestore(&hrtimer_lock, flags);
+}
+
+int hrtimer_cancel(struct hrtimer* timer) {
+    uint32_t flags = spin_lock_irqsave(&hrtimer_lock);
+    int was_head = (hrtimer_head == timer);
+    int ret = hrtimer_dequeue(timer);
+    if (was_head) hrtimer_program(clock_monotonic_ns());
+    spin_unlock_irqrestore(&hrtimer_lock, flags);
+    return ret;
+}
+
+// 执行所有已到期的定时器，然后设定下一次中断
+static void hrtimer_run_queues(void) {
+    uint32_t flags = spin_lock_irqsave(&hrtimer_lock);
+    uint64_t now = clock_monotonic_ns();
+    while (hrtimer_head && hrtimer_head->expires <= now) {
+        struct hrtimer* t = hrtimer_head;
+        hrtimer_head = t->next;
+        t->next = NULL;
+        t->queued = 0;
+
+        spin_unlock_irqrestore(&hrtimer_lock, flags);
+        t->fn(t);
+        flags = spin_lock_irqsave(&hrtimer_lock);
+        now = clock_monotonic_ns();
+    }
+    hrtimer_program(now);
+    spin_unlock_irqrestore(&hrtimer_lock, flags);
+}
+
+static int hrtimer_interrupt(struct registers* regs, void* ctx) {
+    (void)regs; (void)ctx;
+    hrtimer_run_queues();
+    return IRQ_HANDLED;
+}
+
+void hrtimer_tick(void) {
+    if (!hrtimer_oneshot) hrtimer_run_queues();
+}
+
+void hrtimers_init(void) {
+    /* PIT 还在产生时钟节拍：只能在 tick 中检查 */
+    if (!timer_pit_free()) {
+        printk(KERN_INFO, "hrtimer: PIT drives the tick, tick resolution only\n");
+        return;
+    }
+    pit_oneshot_disarm();
+    hrtimer_oneshot = 1;
+    irq_register(0, hrtimer_interrupt, NULL);
+    printk(KERN_INFO, "hrtimer: PIT channel 0 in one-shot mode\n");
+}
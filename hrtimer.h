@@ -0,0 +1,51 @@
+/**
+ * hrtimer.h - 高精度定时器 (High-Resolution Timer)
+ *
+ * 周期性的时钟节拍只能在 10ms 的整数倍上检查到期，休眠 1ms 实际要睡一个 tick。
+ * 高精度定时器按到期时刻 (clock_monotonic_ns) 排序，硬件定时器直接设定为
+ * “最早那个定时器的到期时刻”，中断恰好在需要的时候到来：
+ * - LAPIC 定时器接管时钟节拍后，PIT 通道 0 空闲下来，改为单次模式 (模式 0)，
+ *   专门作为高精度定时器的事件设备 (分辨率 838ns，单次最长约 54ms，更远的到期时刻分段设定)；
+ * - 仍由 PIT 产生节拍 (没有 APIC) 时退回到在每个 tick 检查一次，精度与原来相同。
+ *
+ * 到期回调在硬中断上下文中执行 (关中断)，只能做唤醒进程之类的少量工作。
+ *
+ * @see [hrtimer.md](doc/hrtimer.md)
+ */
+#ifndef HRTIMER_H
+#define HRTIMER_H
+
+#include <stdint.h>
+
+struct hrtimer;
+typedef void (*hrtimer_fn_t)(struct hrtimer* timer);
+
+struct hrtimer {
+    uint64_t expires;           /* 到期时刻 (clock_monotonic_ns) */
+    hrtimer_fn_t fn;            /* 到期回调 (硬中断上下文) */
+    void* data;                 /* 回调的私有数据 */
+    struct hrtimer* next;       /* 按到期时刻排序的队列 */
+    uint32_t queued;
+};
+
+static inline void hrtimer_setup(struct hrtimer* timer, hrtimer_fn_t fn, void* data) {
+    timer->expires = 0;
+    timer->fn = fn;
+    timer->data = data;
+    timer->next = 0;
+    timer->queued = 0;
+}
+
+/* 选择事件设备 (在 apic_timer_init 之后调用) */
+void hrtimers_init(void);
+
+/* 在绝对时刻 expires 触发；已经在队列中的定时器会先被移除 */
+void hrtimer_start(struct hrtimer* timer, uint64_t expires);
+
+/* 从队列中移除，返回 1 表示移除前仍在等待 */
+int hrtimer_cancel(struct hrtimer* timer);
+
+/* 由 BSP 的时钟节拍调用：没有单次事件设备时在这里处理到期的定时器 */
+void hrtimer_tick(void);
+
+#endif
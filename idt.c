@@ -34,3 +34,8 @@ void idt_init(void) {
     // 加载IDT
     idt_flush((uint32_t)&idtp);
 }
+
+// AP 启动时加载同一张 IDT (所有 CPU 共享中断向量表)
+void idt_load(void) {
+    idt_flush((uint32_t)&idtp);
+}
@@ -20,6 +20,7 @@ struct idt_ptr {
 
 // 函数声明
 void idt_init(void);
+void idt_load(void);
 void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags);
 
 #endif
@@ -1,6 +1,8 @@
 #include "fs.h"
 #include "heap.h"
-#include "terminal.h"
+#include "string.h"
+#include "printk.h"
+#include "trace.h"
 
 // 全局文件系统根节点
 fs_node_t* fs_root = NULL;
@@ -19,6 +21,7 @@ fs_node_t* fs_root = NULL;
  * @return uint32_t 实际读取的字节数
  */
 uint32_t vfs_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    TRACE_POINT(TRACE_VFS_READ, node->inode, size);
     // 检查节点是否实现了 read 函数指针
     if (node->read != NULL) {
         return node->read(node, offset, size, buffer);
@@ -84,12 +87,6 @@ static fs_node_t* initrd_root;       // InitRD 的根目录节点
 static fs_node_t* initrd_dev_nodes;  // 存储所有文件节点的数组
 static int n_root_nodes;             // 根目录下的文件数量
 
-/* 字符串比较辅助函数 */
-static int strcmp(const char* s1, const char* s2) {
-    while(*s1 && (*s1 == *s2)) { s1++; s2++; }
-    return *(const unsigned char*)s1 - *(const unsigned char*)s2;
-}
-
 /**
  * @brief InitRD 读操作的具体实现
  * 
@@ -116,9 +113,7 @@ uint32_t initrd_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* b
     uint8_t* data_ptr = (uint8_t*)((uint32_t)fake_disk + header->offset);
     
     // 拷贝数据到用户缓冲区
-    for (uint32_t i = 0; i < size; i++) {
-        buffer[i] = data_ptr[offset + i];
-    }
+    memcpy(buffer, data_ptr + offset, size);
     
     return size;
 }
@@ -180,7 +175,7 @@ void initrd_build_fake_disk(void) {
  * @return fs_node_t* 返回根目录节点
  */
 fs_node_t* initrd_init(void) {
-    terminal_writestring("Building fake initrd image...\n");
+    printk(KERN_DEBUG, "Building fake initrd image...\n");
     
     // 1. 构建内存中的磁盘镜像
     initrd_build_fake_disk();
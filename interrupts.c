@@ -1,19 +1,37 @@
 #include "interrupts.h"
 #include "terminal.h"
+#include "printk.h"
 #include "idt.h"
 #include "process.h"
 #include "syscall.h"
-#include "shell.h"
+#include "uaccess.h"
+#include "kbd.h"
 #include "process.h"
+#include "async.h"
+#include "softirq.h"
+#include "apic.h"
+#include "smp.h"
+#include "vdso.h"
+#include "hrtimer.h"
+#include "fpu.h"
+#include "irqsoff.h"
+#include "prof.h"
 // 本文件负责：
 // - 异常处理入口（isr_handler）：
-//     - 系统调用（int 0x80/128）：转发给 syscall_handler 处理
+//     - 向量分派表 interrupt_table：isr.asm 的通用桩按向量号直接调用
+//       (异常 → isr_handler，int 0x80 → syscall_handler，IRQ → irq_handler)
+//     - 内核访问用户内存出错（缺页/#GP）：查异常表，跳到修复代码 (uaccess.c)
+//     - 设备不可用 (#NM)：惰性装入当前任务的 FPU/SSE 状态 (fpu.c)
 //     - 其他异常：在屏幕顶行输出异常号并停机，便于早期诊断
-// - IRQ 分发（irq_handler）：
-//     - PIT(IRQ0)：维护系统节拍，刷新状态栏，并触发进程调度
-//     - 键盘(IRQ1)：解析扫描码并输入到 Shell
-//     - 通用处理：向 PIC 发送 EOI
-// - 状态栏绘制：在第一行右侧显示 Hz/Keys/MemFree
+// - IRQ 注册与分发（irq_register / irq_handler）：
+//     - 每条 IRQ 线维护一条处理函数链（支持共享中断）与触发计数
+//     - 上半部在关中断状态下运行，下半部（softirq/tasklet）在中断退出时开中断运行
+//     - PIT(IRQ0)：上半部推进节拍 (没有 APIC 时顺带处理高精度定时器)，下半部处理异步任务定时器，退出时调度
+//     - 键盘(IRQ1)：解析扫描码放入输入设备 kbd_dev 的缓冲并唤醒读者，Shell 任务在线程上下文中读取
+//     - 通用处理：向 PIC 发送 EOI（APIC 模式下改为写 LAPIC EOI 寄存器）
+// - 中断控制器切换：apic_init 成功后屏蔽 8259，IRQ 线改由 IOAPIC 路由，
+//   时钟节拍改由 LAPIC 定时器 (IRQ_APIC_TIMER) 产生，PIT 通道 0 转为高精度定时器的单次事件设备
+// - 状态栏绘制：在第一行右侧显示 Hz/Keys/MemFree（由异步任务周期刷新）
 // - 键盘扫描码解析（Set1）：支持 Enter/Backspace/Shift/Caps
 
 // 端口输出函数 (outb)
@@ -53,21 +71,22 @@ static inline uint8_t inb(uint16_t port) {
 }
 
 // 中断服务例程（异常路径）：
-// 说明：异常多发生在终端初始化之前，为保证可视化，使用直写 VGA 顶行而非终端 API。
+// 说明：异常可能发生在持有终端锁的代码中，为保证可视化，不拿锁直写正在显示的 VGA 顶行。
 // 行为：显示 "EXC XX"（两位十六进制异常号），随后进入 hlt 死循环，防止屏幕抖动。
 struct registers* isr_handler(struct registers* regs) {
-    if (regs->int_no == 128) {
-        return syscall_handler(regs);
+    /* #NM：任务第一次在本时间片使用 x87/SSE，装入它的 FPU 状态后重新执行该指令 */
+    if (regs->int_no == 7 && fpu_handle_nm()) {
+        return regs;
+    }
+
+    /* 内核在 copy_from_user/copy_to_user 中访问了无效的用户地址：跳到修复代码继续执行 */
+    if ((regs->int_no == 14 || regs->int_no == 13) && (regs->cs & 3) == 0 && fixup_exception(regs)) {
+        return regs;
     }
 
-    volatile uint16_t* vga = (volatile uint16_t*)0xB8000;
     const char hex[] = "0123456789ABCDEF";
-    vga[0] = (uint16_t)'E' | 0x0C00;
-    vga[1] = (uint16_t)'X' | 0x0C00;
-    vga[2] = (uint16_t)'C' | 0x0C00;
-    vga[3] = (uint16_t)' ' | 0x0C00;
-    vga[4] = (uint16_t)hex[(regs->int_no >> 4) & 0xF] | 0x0C00;
-    vga[5] = (uint16_t)hex[regs->int_no & 0xF] | 0x0C00;
+    char msg[7] = { 'E', 'X', 'C', ' ', hex[(regs->int_no >> 4) & 0xF], hex[regs->int_no & 0xF], 0 };
+    terminal_emergency_write(msg, 0x0C);
     while(1) { asm volatile ("hlt"); }
     return regs; // 不会到达这里
 }
@@ -83,41 +102,44 @@ static volatile uint32_t pit_rate = 100;
 static volatile uint32_t key_count = 0;
 static volatile uint8_t shift_on_global = 0;
 static volatile uint8_t caps_on_global = 0;
+static volatile uint32_t irq_use_apic = 0;   /* 1: EOI/屏蔽走 LAPIC/IOAPIC */
+static volatile uint32_t tick_on_apic = 0;   /* 1: 时钟节拍由 LAPIC 定时器产生，PIT 通道 0 空闲 */
 // 在第一行固定区域绘制状态栏（定宽、定域，避免滚屏与大面积刷新）：
 // 格式："Hz:xxx Keys:xxxx MemFree:xxxxx"
 extern uint32_t pmm_free_pages(void);
 static inline void draw_status(void) {
-    volatile uint16_t* vga = (volatile uint16_t*)0xB8000;
-    char buf[32];
-    int p = 0;
-    buf[p++] = 'H'; buf[p++] = 'z'; buf[p++] = ':';
-    uint32_t v = pit_rate;
-    char num3[3]; for (int i = 2; i >= 0; i--) { num3[i] = '0' + (v % 10); v /= 10; }
-    for (int i = 0; i < 3; i++) buf[p++] = num3[i];
-    buf[p++] = ' ';
-    buf[p++] = 'K'; buf[p++] = 'e'; buf[p++] = 'y'; buf[p++] = 's'; buf[p++] = ':';
-    v = key_count; char num4[4]; for (int i = 3; i >= 0; i--) { num4[i] = '0' + (v % 10); v /= 10; }
-    for (int i = 0; i < 4; i++) buf[p++] = num4[i];
-    buf[p++] = ' ';
-    buf[p++] = 'M'; buf[p++] = 'e'; buf[p++] = 'm'; buf[p++] = 'F'; buf[p++] = 'r'; buf[p++] = 'e'; buf[p++] = 'e'; buf[p++] = ':';
-    uint32_t mf = pmm_free_pages();
-    char num5[5]; for (int i = 4; i >= 0; i--) { num5[i] = '0' + (mf % 10); mf /= 10; }
-    for (int i = 0; i < 5; i++) buf[p++] = num5[i];
-    uint16_t attr = 0x0200;
-    for (int i = 50; i < 80; i++) {
-        vga[0 * 80 + i] = (uint16_t)' ' | attr;
-    }
-    int start = 80 - p;
-    if (start < 50) start = 50;
-    for (int i = 0; i < p; i++) {
-        vga[0 * 80 + start + i] = (uint16_t)buf[i] | attr;
-    }
+    char buf[31];   /* 状态栏占第 0 行的 50..79 列，最多 30 个字符 */
+    int p = snprintk(buf, sizeof(buf), "Hz:%03u Keys:%04u MemFree:%05u",
+                     pit_rate, key_count, pmm_free_pages());
+    /* 右对齐，左侧补空格，整个区域一次写入 (硬件滚屏后第 0 行不在显存开头，由终端换算) */
+    char line[30];
+    int start = 30 - p;
+    for (int i = 0; i < 30; i++) line[i] = i < start ? ' ' : buf[i - start];
+    terminal_write_at(50, 0, line, 30, 0x02);
 }
 
 void status_refresh(void) {
     draw_status();
 }
 
+// 状态栏刷新任务：每 10 个 tick (100ms) 重绘一次。
+// 以前直接在 IRQ0 里绘制，现在交给 kasyncd 在可调度上下文中完成，
+// 时钟中断只负责推进 async 定时器。
+static async_task_t status_task;
+
+static int status_task_fn(async_task_t* t) {
+    ASYNC_BEGIN(t);
+    while (1) {
+        ASYNC_SLEEP(t, 10);
+        draw_status();
+    }
+    ASYNC_END(t);
+}
+
+void status_start(void) {
+    async_spawn(&status_task, status_task_fn, NULL);
+}
+
 // 将键盘扫描码（Set1）转换为 ASCII 字符：
 // - 回车 0x1C → '\n'；退格 0x0E → '\b'
 // - 字母大小写由 (shift XOR caps) 决定；数字与符号暂不处理 Shift 变体
@@ -186,58 +208,232 @@ void pit_init(uint32_t hz) {
     outb(0x40, (uint8_t)((divisor >> 8) & 0xFF));
 }
 
-// IRQ 分发：
-// - 先发 EOI（若为从 PIC 中断，需先向 0xA0 再向 0x20）
-// - 处理定时器与键盘分支；其余 IRQ 打印向量号
-struct registers* irq_handler(struct registers* regs) {
-    if (regs->int_no >= 40) {
-        outb(0xA0, 0x20);
-    }
-    outb(0x20, 0x20);
+// PIT 通道 2 单次计时 (模式 0)：
+// - 端口 0x61 bit0 是通道 2 的 GATE，bit1 是扬声器使能 (保持关闭)
+// - 计数减到 0 时 OUT2 变高，可从端口 0x61 bit5 读出
+// 先拉低 GATE 再装入计数值，拉高 GATE 后才开始计数，保证起点确定。
+uint32_t pit_oneshot_start(uint32_t us) {
+    uint32_t count = 1193 * us / 1000;   /* 1.193 MHz */
+    if (count > 0xFFFF) count = 0xFFFF;
+    if (count == 0) count = 1;
+    outb(0x61, inb(0x61) & ~0x03);
+    outb(0x43, 0xB0);                    /* 通道 2，先低后高字节，模式 0 */
+    outb(0x42, (uint8_t)(count & 0xFF));
+    outb(0x42, (uint8_t)((count >> 8) & 0xFF));
+    outb(0x61, (inb(0x61) & ~0x02) | 0x01);
+    return count;
+}
+
+int pit_oneshot_expired(void) {
+    return (inb(0x61) & 0x20) != 0;
+}
+
+// PIT 通道 0 单次计时 (模式 0)：写完计数值后开始递减，减到 0 时 OUT0 变高，
+// 产生一次 IRQ0 上升沿。只写控制字不写计数值时 OUT0 保持低电平、计数停止 (解除)。
+// 只有时钟节拍交给 LAPIC 定时器之后，通道 0 才能这样使用。
+void pit_oneshot_arm(uint32_t count) {
+    if (count > 0xFFFF) count = 0xFFFF;
+    outb(0x43, 0x30);                    /* 通道 0，先低后高字节，模式 0 */
+    outb(0x40, (uint8_t)(count & 0xFF));
+    outb(0x40, (uint8_t)((count >> 8) & 0xFF));
+}
+
+void pit_oneshot_disarm(void) {
+    outb(0x43, 0x30);
+}
 
-    // IRQ0：定时器心跳，周期刷新状态栏（降低刷新频率避免抖动）
-    if (regs->int_no == 32) {
+int timer_pit_free(void) {
+    return tick_on_apic;
+}
+
+uint32_t timer_get_ticks(void) {
+    return pit_ticks;
+}
+
+// 时钟中断上半部：只推进节拍、标记下半部与调度请求
+// APIC 模式下每个 CPU 都有自己的 LAPIC 定时器：全局节拍 (休眠计时、异步定时器)
+// 只由 BSP 推进，其余 CPU 只做本地的时间片轮转。
+static int timer_interrupt(struct registers* regs, void* ctx) {
+    (void)ctx;
+    prof_tick(regs);                /* 采样被打断的现场 (prof.c，未开启时立即返回) */
+    if (smp_processor_id() == 0) {
         pit_ticks++;
-        if ((pit_ticks % 10) == 0) {
-            draw_status();
-        }
-        
-        /* 更新进程休眠状态 */
-        process_update_sleep_ticks();
+        vdso_update(pit_ticks);     /* 用户态可读的时间页 */
+        hrtimer_tick();             /* 没有单次事件设备时在这里处理高精度定时器 */
+        raise_softirq(TIMER_SOFTIRQ);
+        printk_tick();              /* 有新日志时提交控制台输出的 work (printk.c) */
+    }
+    sched_tick();
+    watchdog_tick();                /* softlockup 检查 (irqsoff.c) */
+    return IRQ_HANDLED;
+}
 
-        /* [关键改动] 调用调度器 */
-        return schedule(regs);
+// 时钟中断下半部 (开中断执行)：
+// 按 tick 逐个补齐，即使某次下半部被推迟，也不会少算休眠时间
+static volatile uint32_t timer_ticks_done = 0;
+
+static void timer_softirq(void) {
+    while (timer_ticks_done != pit_ticks) {
+        timer_ticks_done++;
+        async_timer_tick(timer_ticks_done);
     }
+}
 
+// 键盘中断上半部。处理 Shift/Caps 修饰键状态，过滤 break 码，
+// make 码翻译后放入输入设备的环形缓冲区 (kbd.c)，唤醒阻塞读取的 Shell 任务。
+// 命令 (清屏、打印文件、回看历史的重绘) 都在 Shell 任务中执行，中断里只有几次端口访问和数组写。
+static int keyboard_interrupt(struct registers* regs, void* ctx) {
+    (void)regs; (void)ctx;
     static uint8_t shift_on = 0;
     static uint8_t caps_on = 0;
-    // IRQ1：键盘。处理 Shift/Caps 修饰键状态，过滤 break 码，回显 make 码字符。
-    if (regs->int_no == 33) {
-        uint8_t sc = inb(0x60);
-        if (sc == 0x2A || sc == 0x36) { shift_on = 1; return regs; }
-        if (sc == 0xAA || sc == 0xB6) { shift_on = 0; return regs; }
-        if (sc == 0x3A) { caps_on ^= 1; caps_on_global = caps_on; return regs; }
-        if (sc & 0x80) return regs;
-        char c = translate_scancode(sc, shift_on, caps_on);
-        shift_on_global = shift_on;
-        if (c) { shell_input(c); key_count++; }
+    uint8_t sc = inb(0x60);
+    if (sc == 0x2A || sc == 0x36) { shift_on = 1; return IRQ_HANDLED; }
+    if (sc == 0xAA || sc == 0xB6) { shift_on = 0; return IRQ_HANDLED; }
+    if (sc == 0x3A) { caps_on ^= 1; caps_on_global = caps_on; return IRQ_HANDLED; }
+    if (sc & 0x80) return IRQ_HANDLED;
+    /* PgUp/PgDn：回看终端历史，由 Shell 任务调用 terminal_scroll_view (fbcon 下要重画整屏) */
+    char c;
+    if (sc == 0x49) c = KBD_KEY_PGUP;
+    else if (sc == 0x51) c = KBD_KEY_PGDN;
+    else c = translate_scancode(sc, shift_on, caps_on);
+    shift_on_global = shift_on;
+    if (c) {
+        kbd_put(KBD_SRC_PS2, c);
+        key_count++;
+        kbd_wake();
+    }
+    return IRQ_HANDLED;
+}
+
+// IRQ 描述符表：每条 IRQ 线一条处理函数链 (共享中断) 与统计计数
+// action 节点来自静态池，irq_init 时堆尚未初始化，也无需 kmalloc
+struct irq_action {
+    irq_handler_t handler;
+    void* ctx;
+    struct irq_action* next;
+};
+
+struct irq_desc {
+    struct irq_action* actions;
+    volatile uint32_t count;      /* 该 IRQ 触发的总次数 */
+    volatile uint32_t unhandled;  /* 所有处理函数都返回 IRQ_NONE 的次数 */
+};
+
+#define IRQ_MAX_ACTIONS 32
+static struct irq_action irq_action_pool[IRQ_MAX_ACTIONS];
+static uint32_t irq_action_used = 0;
+static struct irq_desc irq_descs[NR_IRQS];
+static spinlock_t irq_desc_lock = SPINLOCK_INIT("irq_desc");
+
+static void irq_unmask(uint32_t irq);
+static void irq_mask(uint32_t irq);
+
+int irq_register(uint32_t irq, irq_handler_t handler, void* ctx) {
+    if (irq >= NR_IRQS || !handler) return -1;
+
+    uint32_t flags = spin_lock_irqsave(&irq_desc_lock);
+    if (irq_action_used >= IRQ_MAX_ACTIONS) {
+        spin_unlock_irqrestore(&irq_desc_lock, flags);
+        return -1;
+    }
+    struct irq_action* action = &irq_action_pool[irq_action_used++];
+    action->handler = handler;
+    action->ctx = ctx;
+    action->next = NULL;
+
+    /* 追加到链尾：先注册的处理函数先被调用 */
+    struct irq_action** pp = &irq_descs[irq].actions;
+    while (*pp) pp = &(*pp)->next;
+    *pp = action;
+
+    irq_unmask(irq);
+    spin_unlock_irqrestore(&irq_desc_lock, flags);
+    return 0;
+}
+
+// 从链表中摘除；action 节点不回收 (静态池只在启动阶段分配，注销极少发生)。
+// 链表空了就屏蔽这条 IRQ 线。
+int irq_unregister(uint32_t irq, irq_handler_t handler, void* ctx) {
+    if (irq >= NR_IRQS) return -1;
+
+    uint32_t flags = spin_lock_irqsave(&irq_desc_lock);
+    struct irq_action** pp = &irq_descs[irq].actions;
+    while (*pp && !((*pp)->handler == handler && (*pp)->ctx == ctx)) pp = &(*pp)->next;
+    if (!*pp) {
+        spin_unlock_irqrestore(&irq_desc_lock, flags);
+        return -1;
+    }
+    *pp = (*pp)->next;
+    if (!irq_descs[irq].actions) irq_mask(irq);
+    spin_unlock_irqrestore(&irq_desc_lock, flags);
+    return 0;
+}
+
+uint32_t irq_get_count(uint32_t irq) {
+    return irq < NR_IRQS ? irq_descs[irq].count : 0;
+}
+
+uint32_t irq_get_unhandled(uint32_t irq) {
+    return irq < NR_IRQS ? irq_descs[irq].unhandled : 0;
+}
+
+// IRQ 分发：
+// - 先发 EOI（PIC：若为从片中断，需先向 0xA0 再向 0x20；APIC：一次 LAPIC MMIO 写）
+// - 依次调用该 IRQ 线上注册的所有处理函数 (上半部，关中断)
+// - 中断退出：开中断执行软中断 (下半部)，最后按需调度
+// 没有任何处理函数的 IRQ 打印向量号，便于发现未接驱动的设备
+struct registers* irq_handler(struct registers* regs) {
+    uint32_t irq = regs->int_no - 32;
+    if (irq_use_apic || irq >= IRQ_APIC_TIMER) {   /* LAPIC 本地向量总是写 LAPIC EOI */
+        apic_eoi();
+    } else {
+        if (regs->int_no >= 40) {
+            outb(0xA0, 0x20);
+        }
+        outb(0x20, 0x20);
+    }
+
+    struct irq_desc* desc = &irq_descs[irq];
+    __sync_fetch_and_add(&desc->count, 1);   /* 多个 CPU 可能同时处理 IRQ_APIC_TIMER */
+
+    if (!desc->actions) {
+        printk(KERN_WARNING, "Received IRQ: %02X\n", regs->int_no);
         return regs;
     }
 
-    terminal_writestring("Received IRQ: ");
-    char hex_chars[] = "0123456789ABCDEF";
-    char int_str[3];
-    int_str[0] = hex_chars[(regs->int_no >> 4) & 0xF];
-    int_str[1] = hex_chars[regs->int_no & 0xF];
-    int_str[2] = '\0';
-    terminal_writestring(int_str);
-    terminal_putchar('\n');
+    int handled = IRQ_NONE;
+    for (struct irq_action* a = desc->actions; a; a = a->next) {
+        handled |= a->handler(regs, a->ctx);
+    }
+    if (handled == IRQ_NONE) desc->unhandled++;
+
+    /* 下半部：开中断执行，返回时已重新关中断。
+       若本次中断打断的正是下半部，do_softirq 会直接返回，由外层继续处理。 */
+    do_softirq();
+
+    /* 下半部执行期间不能切换进程：被打断的下半部还在当前栈上，
+       调度请求保留到外层中断退出时处理。 */
+    cpu_t* cpu = this_cpu();
+    if (cpu->need_resched && !in_softirq()) {
+        cpu->need_resched = 0;
+        return schedule(regs);
+    }
     return regs;
 }
 
 
-// 初始化 ISR：为 0–31 号异常设置 IDT 门（0x8E 中断门，选择子 0x08）
+// 向量分派表 (common_stub 直接查表调用)。系统调用与 IRQ 不再先经过异常处理函数转发。
+interrupt_handler_t interrupt_table[256];
+
+void set_interrupt_handler(uint8_t vector, interrupt_handler_t handler) {
+    interrupt_table[vector] = handler ? handler : isr_handler;
+}
+
+// 初始化 ISR：为 0–31 号异常设置 IDT 门（0x8E 中断门，选择子 0x08），并填写分派表
 void isr_init(void) {
+    for (int i = 0; i < 256; i++) interrupt_table[i] = isr_handler;
+    interrupt_table[128] = syscall_handler;
+
     // 设置所有ISR
     idt_set_gate(0, (uint32_t)isr0, 0x08, 0x8E);
     idt_set_gate(1, (uint32_t)isr1, 0x08, 0x8E);
@@ -272,6 +468,7 @@ void isr_init(void) {
     idt_set_gate(30, (uint32_t)isr30, 0x08, 0x8E);
     idt_set_gate(31, (uint32_t)isr31, 0x08, 0x8E);
     idt_set_gate(128, (uint32_t)isr128, 0x08, 0xEE); // DPL=3 for syscalls!
+    idt_set_gate(0x81, (uint32_t)isr129, 0x08, 0x8E); // irqbench 的软中断：DPL=0，用户态 int 0x81 直接 #GP
 }
 
 
@@ -318,10 +515,62 @@ void pic_remap(int offset1, int offset2) {
     io_wait();
     outb(PIC2_DATA, ICW4_8086);
     io_wait();
-    outb(PIC1_DATA, 0xF8);
+    /* 只保留级联线 IRQ2；其余 IRQ 线在 irq_register 时按需打开 */
+    outb(PIC1_DATA, 0xFB);
     outb(PIC2_DATA, 0xFF);
 }
 
+// 打开 PIC 上某条 IRQ 线的屏蔽位 (从片上的 IRQ 还需打开主片的级联线 IRQ2)
+static void pic_unmask(uint32_t irq) {
+    if (irq < 8) {
+        outb(PIC1_DATA, inb(PIC1_DATA) & ~(1u << irq));
+    } else {
+        outb(PIC2_DATA, inb(PIC2_DATA) & ~(1u << (irq - 8)));
+        outb(PIC1_DATA, inb(PIC1_DATA) & ~(1u << 2));
+    }
+}
+
+// 屏蔽 PIC 上的某条 IRQ 线
+static void pic_mask(uint32_t irq) {
+    if (irq < 8) {
+        outb(PIC1_DATA, inb(PIC1_DATA) | (1u << irq));
+    } else {
+        outb(PIC2_DATA, inb(PIC2_DATA) | (1u << (irq - 8)));
+    }
+}
+
+// 按当前中断控制器打开/屏蔽 IRQ 线。
+// IRQ_APIC_TIMER 由 LAPIC 的 LVT 寄存器控制，这里无需处理。
+static void irq_unmask(uint32_t irq) {
+    if (irq >= 16) return;
+    if (irq_use_apic) ioapic_unmask_irq(irq);
+    else pic_unmask(irq);
+}
+
+static void irq_mask(uint32_t irq) {
+    if (irq >= 16) return;
+    if (irq_use_apic) ioapic_mask_irq(irq);
+    else pic_mask(irq);
+}
+
+void irq_switch_to_apic(void) {
+    uint32_t flags = local_irq_save();
+    /* 8259 全部屏蔽：此后它产生的伪中断 (IRQ7/15) 也不会再出现 */
+    outb(PIC1_DATA, 0xFF);
+    outb(PIC2_DATA, 0xFF);
+    irq_use_apic = 1;
+    for (uint32_t irq = 0; irq < 16; irq++) {
+        if (irq_descs[irq].actions) ioapic_unmask_irq(irq);
+    }
+    local_irq_restore(flags);
+}
+
+void timer_switch_to_apic(void) {
+    irq_register(IRQ_APIC_TIMER, timer_interrupt, NULL);
+    irq_unregister(0, timer_interrupt, NULL);   /* IRQ0 留给高精度定时器 (hrtimer.c) */
+    tick_on_apic = 1;
+}
+
 // 初始化IRQ
 void irq_init(void) {
     // 重新映射PIC，将IRQ0-15映射到IDT 32-47
@@ -344,4 +593,16 @@ void irq_init(void) {
     idt_set_gate(45, (uint32_t)irq13, 0x08, 0x8E);
     idt_set_gate(46, (uint32_t)irq14, 0x08, 0x8E);
     idt_set_gate(47, (uint32_t)irq15, 0x08, 0x8E);
+    // APIC 模式使用的向量：LAPIC 定时器与伪中断
+    idt_set_gate(48, (uint32_t)irq16, 0x08, 0x8E);
+    idt_set_gate(49, (uint32_t)irq17, 0x08, 0x8E);
+    idt_set_gate(50, (uint32_t)irq18, 0x08, 0x8E);
+    for (int v = 32; v <= 50; v++) interrupt_table[v] = irq_handler;
+    idt_set_gate(0xFF, (uint32_t)isr_spurious, 0x08, 0x8E);
+
+    // 注册内置设备：时钟与键盘 (注册时会自动打开 PIC 屏蔽位)
+    softirq_init();
+    open_softirq(TIMER_SOFTIRQ, timer_softirq);
+    irq_register(0, timer_interrupt, NULL);
+    irq_register(1, keyboard_interrupt, NULL);
 }
@@ -91,6 +91,45 @@ extern void irq12(void);
 extern void irq13(void);
 extern void irq14(void);
 extern void irq15(void);
+extern void irq16(void);           /* LAPIC 定时器 (APIC 模式) */
+extern void irq17(void);           /* LAPIC 自发 IPI (中断开销测试) */
+extern void irq18(void);           /* 重新调度 IPI */
+extern void isr129(void);          /* 软中断 0x81 (中断开销测试) */
+extern void isr_spurious(void);    /* LAPIC 伪中断 (向量 0xFF)，直接 iret */
+
+/**
+ * IRQ 处理函数注册 (共享中断)
+ * 同一条 IRQ 线可以注册多个处理函数，中断到来时按注册顺序依次调用。
+ * 处理函数运行在关中断的上半部中，应只做最少的工作，耗时部分请交给
+ * 软中断/tasklet (softirq.h) 或工作队列 (workqueue.h)。
+ */
+#define NR_IRQS      19
+#define IRQ_APIC_TIMER 16  /* 虚拟 IRQ 线：LAPIC 定时器 (向量 48)，不经过 PIC/IOAPIC */
+#define IRQ_APIC_TEST  17  /* 虚拟 IRQ 线：LAPIC 自发 IPI (向量 49)，irqbench 使用 */
+#define IRQ_RESCHED    18  /* 虚拟 IRQ 线：重新调度 IPI (向量 50)，process.c 使用 */
+#define IRQ_NONE     0   /* 不是本设备产生的中断 */
+#define IRQ_HANDLED  1   /* 已处理 */
+
+typedef int (*irq_handler_t)(struct registers* regs, void* ctx);
+
+/**
+ * irq_register - 为 IRQ 线注册处理函数，并打开该线的屏蔽位
+ * @irq: IRQ 号 (0-15，或 IRQ_APIC_TIMER)
+ * @handler: 处理函数，返回 IRQ_HANDLED 或 IRQ_NONE
+ * @ctx: 原样传给处理函数的设备私有数据
+ * 返回值: 0 成功，-1 失败 (参数非法或 action 池耗尽)。
+ */
+int irq_register(uint32_t irq, irq_handler_t handler, void* ctx);
+
+/**
+ * irq_unregister - 注销 irq_register 注册的处理函数 (handler 与 ctx 都要匹配)
+ * 该线上没有处理函数时自动屏蔽。返回值: 0 成功，-1 未找到。
+ */
+int irq_unregister(uint32_t irq, irq_handler_t handler, void* ctx);
+
+/* 每条 IRQ 线的统计：触发次数 / 无人认领次数 */
+uint32_t irq_get_count(uint32_t irq);
+uint32_t irq_get_unhandled(uint32_t irq);
 
 /**
  * isr_init - 初始化中断服务例程 (ISR)
@@ -110,6 +149,58 @@ void irq_init(void);
  */
 void pit_init(uint32_t hz);
 
+/**
+ * pit_oneshot_start / pit_oneshot_expired - 用 PIT 通道 2 做一次忙等计时
+ * 通道 2 不产生中断，只通过端口 0x61 的 OUT2 位反映计数是否到期，
+ * 用于在关中断的启动阶段校准其他时钟源 (LAPIC 定时器、TSC)。
+ * @us: 计时长度 (微秒，最大约 54ms)
+ * 返回值: 实际装入的计数值 (计时长度 = 计数值 / PIT_HZ 秒)。
+ */
+uint32_t pit_oneshot_start(uint32_t us);
+int pit_oneshot_expired(void);
+
+/**
+ * pit_oneshot_arm / pit_oneshot_disarm - PIT 通道 0 单次模式 (高精度定时器的事件设备)
+ * @count: 计数值 (1.193182 MHz，最大 0xFFFF)，减到 0 时产生一次 IRQ0。
+ * 只能在 timer_pit_free() 返回 1 之后使用。
+ */
+void pit_oneshot_arm(uint32_t count);
+void pit_oneshot_disarm(void);
+
+/* 时钟节拍是否已经交给 LAPIC 定时器 (PIT 通道 0 空闲) */
+int timer_pit_free(void);
+
+/* BSP 推进的全局节拍数 (开机以来的 tick 数) */
+uint32_t timer_get_ticks(void);
+
+/**
+ * irq_switch_to_apic - 中断控制器切换到 APIC 模式 (由 apic_init 调用)
+ * 屏蔽 8259，并把已经注册了处理函数的 IRQ 线在 IOAPIC 中打开；之后的 EOI
+ * 改为写 LAPIC 寄存器。
+ */
+void irq_switch_to_apic(void);
+
+/**
+ * timer_switch_to_apic - 时钟节拍改由 LAPIC 定时器 (IRQ_APIC_TIMER) 产生
+ * 由 apic_timer_init 在校准完成后调用。时钟处理函数从 IRQ0 上注销 (IRQ0 随之被屏蔽)，
+ * 之后 IRQ0 由高精度定时器 (hrtimer.c) 使用。
+ */
+void timer_switch_to_apic(void);
+
+/**
+ * 向量分派表：isr.asm 中唯一的通用桩 common_stub 按向量号直接调用表项。
+ * 默认全部指向 isr_handler (异常：修复或停机)；0x80 指向 syscall_handler，
+ * 32-50 指向 irq_handler。处理函数返回要恢复的现场 (可能属于另一个任务)。
+ */
+typedef struct registers* (*interrupt_handler_t)(struct registers* regs);
+extern interrupt_handler_t interrupt_table[256];
+
+/* 设置某个向量的处理函数 (IDT 门需另行用 idt_set_gate 设置) */
+void set_interrupt_handler(uint8_t vector, interrupt_handler_t handler);
+
+/* 1: Ring 0 被打断时跳过段寄存器的装载与恢复 (isr.asm，默认打开) */
+extern volatile uint32_t irq_fast_entry;
+
 /**
  * isr_handler - C 语言异常处理入口
  * @regs: 指向栈中保存的寄存器现场的指针。
@@ -130,4 +221,10 @@ struct registers* irq_handler(struct registers* regs);
  */
 void status_refresh(void);
 
+/**
+ * status_start - 启动状态栏周期刷新任务
+ * 以异步任务的形式每 100ms 重绘一次状态栏 (需在 async_init 之后调用)。
+ */
+void status_start(void);
+
 #endif
@@ -0,0 +1,20 @@
+/**
+ * irqbench.h - 中断入口/出口开销的微基准 (shell 命令 irqbench)
+ *
+ * 用 RDTSC 测量一次中断往返 (进入桩 → C 处理函数 → iret) 的周期数，
+ * 分别在 isr.asm 快速路径打开与关闭时各测一遍，便于对比：
+ * - 软中断：int 0x81 (Ring 0，处理函数什么都不做)，只包含桩本身的开销；
+ * - 硬件中断：LAPIC 给自己发 IPI (向量 49，虚拟 IRQ 17)，
+ *   走与时钟中断完全相同的 irq_handler 路径 (分派、EOI、softirq 检查)。
+ *
+ * 时钟中断本身每次都可能触发调度，无法单独计时，所以用自发 IPI 代替。
+ *
+ * @see [irq_entry.md](doc/irq_entry.md)
+ */
+#ifndef IRQBENCH_H
+#define IRQBENCH_H
+
+/* 运行测试并打印结果 (需要 TSC；没有 APIC 时只测软中断) */
+void irqbench_run(void);
+
+#endif
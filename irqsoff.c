@@ -0,0 +1,221 @@
+#include "irqsoff.h"
+#include "clocksource.h"
+#include "process.h"
+#include "terminal.h"
+#include "printk.h"
+#include "smp.h"
+#include "cpu.h"
+#ifdef CONFIG_IRQSOFF_TRACE
+#include "interrupts.h"
+#endif
+#include <stddef.h>
+
+// 本文件负责：
+// - 关中断区间的起止记录与每 CPU 的 top-N (CONFIG_IRQSOFF_TRACE)
+// - softlockup 看门狗：每个 CPU 的时钟中断互相检查对方是否还有 tick
+//
+// 追踪器的钩子总是在关中断状态下、只访问本 CPU 的数据，不需要锁。
+// 钩子里不能打印 (打印要拿终端的锁，又会进入钩子)：超长区间先存为 pending，
+// 由本 CPU 下一次时钟中断里的 watchdog_tick 打印。
+
+/* 看门狗：各 CPU 最后一次 tick 的时刻 (ms，0 表示还没有 tick 过)。32 位读写是原子的 */
+static volatile uint32_t wd_touch_ms[SMP_MAX_CPUS];
+static volatile uint32_t wd_reported[SMP_MAX_CPUS];
+
+#ifdef CONFIG_IRQSOFF_TRACE
+struct irqsoff_span {
+    uint32_t cycles;
+    uint32_t start_ip;
+    uint32_t end_ip;
+};
+
+struct irqsoff_cpu {
+    uint32_t active;                /* 1: 正处于关中断区间 */
+    uint32_t start;                 /* 区间起点 (TSC 低 32 位) */
+    uint32_t start_ip;
+    uint32_t nr_spans;
+    uint32_t nr_over;               /* 超过报告阈值的区间数 */
+    struct irqsoff_span pending;    /* 待打印的超长区间 (只保留最长的一个) */
+    struct irqsoff_span top[IRQSOFF_TOP_N];   /* 按长度降序 */
+};
+
+static struct irqsoff_cpu irqsoff_cpus[SMP_MAX_CPUS];
+static uint32_t report_cycles = 0xFFFFFFFF;
+static int irqsoff_ready = 0;       /* GS 指向 cpu_t 之前不能用 smp_processor_id */
+
+static void irqsoff_start(uint32_t ip) {
+    if (!irqsoff_ready) return;
+    struct irqsoff_cpu* c = &irqsoff_cpus[smp_processor_id()];
+    if (c->active) return;
+    c->start = (uint32_t)rdtsc();
+    c->start_ip = ip;
+    c->active = 1;
+}
+
+static void irqsoff_stop(uint32_t ip) {
+    if (!irqsoff_ready) return;
+    struct irqsoff_cpu* c = &irqsoff_cpus[smp_processor_id()];
+    if (!c->active) return;
+    c->active = 0;
+
+    struct irqsoff_span s = { (uint32_t)rdtsc() - c->start, c->start_ip, ip };
+    c->nr_spans++;
+    if (s.cycles > report_cycles) {
+        c->nr_over++;
+        if (s.cycles > c->pending.cycles) c->pending = s;
+    }
+
+    /* 插入有序的 top-N：绝大多数区间比第 N 名短，一次比较就返回 */
+    if (s.cycles <= c->top[IRQSOFF_TOP_N - 1].cycles) return;
+    int i = IRQSOFF_TOP_N - 1;
+    while (i > 0 && c->top[i - 1].cycles < s.cycles) {
+        c->top[i] = c->top[i - 1];
+        i--;
+    }
+    c->top[i] = s;
+}
+
+void trace_irqs_off(void) {
+    irqsoff_start((uint32_t)__builtin_return_address(0));
+}
+
+void trace_irqs_on(void) {
+    irqsoff_stop((uint32_t)__builtin_return_address(0));
+}
+
+void irqsoff_irq_enter(uint32_t vector) {
+    /* 从关中断的代码进入 (异常、内核里的 int 0x80) 时区间早已开始，irqsoff_start 直接返回 */
+    irqsoff_start((uint32_t)interrupt_table[vector]);
+}
+
+void irqsoff_irq_exit(struct registers* regs) {
+    /* 返回到关中断的现场 (例如关中断后让出 CPU 的任务)：区间继续 */
+    if (regs->eflags & EFLAGS_IF) irqsoff_stop(regs->eip);
+}
+
+void irqsoff_init(void) {
+    uint32_t khz = clocksource_tsc_khz();
+    if (khz) report_cycles = khz / 1000 * IRQSOFF_REPORT_US;
+    irqsoff_ready = 1;
+}
+
+static uint32_t cycles_to_us(uint32_t cycles) {
+    uint32_t khz = clocksource_tsc_khz();
+    return khz ? (uint32_t)div_u64((uint64_t)cycles * 1000, khz) : 0;
+}
+
+static void irqsoff_print_span(const struct irqsoff_span* s) {
+    terminal_writedec(s->cycles);
+    terminal_writestring(" cycles (");
+    terminal_writedec(cycles_to_us(s->cycles));
+    terminal_writestring("us) ");
+    terminal_writehex(s->start_ip);
+    terminal_writestring(" -> ");
+    terminal_writehex(s->end_ip);
+    terminal_putchar('\n');
+}
+
+// 报告本 CPU 待报告的超长区间。printk 只写日志缓冲区，但格式化本身也在关中断区间内，
+// 报告完把当前区间的起点挪到现在，免得报告自己又被报告。
+static int irqsoff_report_pending(void) {
+    struct irqsoff_cpu* c = &irqsoff_cpus[smp_processor_id()];
+    if (!c->pending.cycles) return 0;
+    struct irqsoff_span s = c->pending;
+    c->pending.cycles = 0;
+    printk(KERN_WARNING, "irqsoff: CPU%u irqs off for %u cycles (%uus) %p -> %p\n",
+           smp_processor_id(), s.cycles, cycles_to_us(s.cycles), (void*)s.start_ip, (void*)s.end_ip);
+    return 1;
+}
+
+void irqsoff_dump(void) {
+    uint32_t ncpu = smp_num_cpus();
+    uint32_t spans = 0, over = 0;
+    for (uint32_t i = 0; i < ncpu; i++) {
+        spans += irqsoff_cpus[i].nr_spans;
+        over += irqsoff_cpus[i].nr_over;
+    }
+    terminal_writestring("irqs-off spans: ");
+    terminal_writedec(spans);
+    terminal_writestring(", over ");
+    terminal_writedec(IRQSOFF_REPORT_US);
+    terminal_writestring("us: ");
+    terminal_writedec(over);
+    terminal_putchar('\n');
+
+    /* 合并各 CPU 的 top-N：每轮选出还没打印的最长者 */
+    uint32_t next[SMP_MAX_CPUS] = { 0 };
+    for (int rank = 0; rank < IRQSOFF_TOP_N; rank++) {
+        int best = -1;
+        for (uint32_t i = 0; i < ncpu; i++) {
+            if (next[i] >= IRQSOFF_TOP_N || !irqsoff_cpus[i].top[next[i]].cycles) continue;
+            if (best < 0 || irqsoff_cpus[i].top[next[i]].cycles >
+                            irqsoff_cpus[best].top[next[best]].cycles) best = (int)i;
+        }
+        if (best < 0) break;
+        terminal_writestring(" #");
+        terminal_writedec(rank + 1);
+        terminal_writestring(" CPU");
+        terminal_writedec(best);
+        terminal_putchar(' ');
+        irqsoff_print_span(&irqsoff_cpus[best].top[next[best]++]);
+    }
+}
+
+void irqsoff_reset(void) {
+    /* 只清统计，不动 active/start：正在进行的区间照常结束 */
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        struct irqsoff_cpu* c = &irqsoff_cpus[i];
+        c->nr_spans = 0;
+        c->nr_over = 0;
+        c->pending.cycles = 0;
+        for (int k = 0; k < IRQSOFF_TOP_N; k++) c->top[k].cycles = 0;
+    }
+    terminal_writestring("irqsoff: cleared\n");
+}
+#endif
+
+static void watchdog_report(uint32_t cpu, uint32_t stale_ms) {
+    cpu_t* c = smp_cpu(cpu);
+    char buf[LOG_LINE_MAX];
+    int n = snprintk(buf, sizeof(buf), "softlockup: CPU%u no timer tick for %ums", cpu, stale_ms);
+    if (c->current) n += snprintk(buf + n, sizeof(buf) - n, ", running %s", c->current->name);
+#ifdef CONFIG_IRQSOFF_TRACE
+    struct irqsoff_cpu* t = &irqsoff_cpus[cpu];
+    if (t->active) snprintk(buf + n, sizeof(buf) - n, ", irqs off since %p", (void*)t->start_ip);
+#else
+    (void)n;
+#endif
+    /* 卡住的 CPU 可能正持有终端的锁：只进日志缓冲区，由其他 CPU 上的 worker 输出 */
+    printk(KERN_WARNING, "%s\n", buf);
+}
+
+void watchdog_tick(void) {
+    uint32_t self = smp_processor_id();
+    uint32_t now = (uint32_t)div_u64(clock_monotonic_ns(), NSEC_PER_MSEC);
+    int printed = 0;
+
+    wd_touch_ms[self] = now ? now : 1;
+    wd_reported[self] = 0;
+
+    for (uint32_t i = 0; i < smp_num_cpus(); i++) {
+        uint32_t touch = wd_touch_ms[i];
+        if (i == self || !touch) continue;
+        /* 各 CPU 的 TSC 可能略有偏差，差值按有符号数比较 */
+        int32_t stale = (int32_t)(now - touch);
+        if (stale <= WATCHDOG_THRESH_MS) continue;
+        /* 每次卡住只报告一次，由第一个发现的 CPU 报告 */
+        if (__sync_lock_test_and_set(&wd_reported[i], 1)) continue;
+        watchdog_report(i, (uint32_t)stale);
+        printed = 1;
+    }
+
+#ifdef CONFIG_IRQSOFF_TRACE
+    printed |= irqsoff_report_pending();
+    if (printed) {
+        struct irqsoff_cpu* c = &irqsoff_cpus[self];
+        if (c->active) c->start = (uint32_t)rdtsc();
+    }
+#else
+    (void)printed;
+#endif
+}
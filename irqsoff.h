@@ -0,0 +1,51 @@
+/**
+ * irqsoff.h - 关中断区间追踪 (irqs-off tracer) 与 softlockup 看门狗
+ *
+ * 所有 IRQ 处理函数、经中断门进入的系统调用、每个 spin_lock_irqsave 临界区都在关中断状态下运行，
+ * 这段时间里本 CPU 不响应任何中断：时钟、键盘、IPI 都要等。
+ *
+ * 追踪器 (编译时开启：IRQSOFF_TRACE=1 ./build.sh，定义 CONFIG_IRQSOFF_TRACE)：
+ * - 区间起点：local_irq_save/local_irq_disable 把 IF 从 1 变 0，或中断桩从开中断的代码进入；
+ * - 区间终点：local_irq_restore/local_irq_enable 把 IF 从 0 变 1，或中断桩 iret 回开中断的现场；
+ * - 记录区间长度 (TSC 周期) 与起止代码地址，每个 CPU 保留最长的 IRQSOFF_TOP_N 个；
+ * - 超过 IRQSOFF_REPORT_US 的区间由看门狗在下一个时钟中断中打印出来。
+ * 起止地址是调用 local_irq_* 的函数内部的地址 (用 nm -n kernel.elf 对照)，
+ * 中断处理路径的起点是分派到的处理函数，终点是 iret 返回到的 EIP。
+ *
+ * softlockup 看门狗 (始终开启)：每个 CPU 在时钟中断中记录“最后一次 tick 的时刻”，
+ * 同时检查其他 CPU：某个 CPU 超过 WATCHDOG_THRESH_MS 没有 tick，说明它关着中断卡住了，
+ * 打印一次报告 (开启追踪器时附带它这次关中断的起点地址)。需要 LAPIC 定时器让每个 CPU 都有 tick。
+ *
+ * @see [irqsoff.md](doc/irqsoff.md)
+ */
+#ifndef IRQSOFF_H
+#define IRQSOFF_H
+
+#include <stdint.h>
+
+#define IRQSOFF_TOP_N       8       /* 每个 CPU 保留的最长区间数 */
+#define IRQSOFF_REPORT_US   1000    /* 超过它的区间会被打印 */
+#define WATCHDOG_THRESH_MS  200     /* 某个 CPU 这么久没有时钟中断就报告 softlockup */
+
+#ifdef CONFIG_IRQSOFF_TRACE
+struct registers;
+
+/* 由 cpu.h 的 local_irq_* 调用：IF 刚被清除 / 即将被置位。重复调用没有副作用 */
+void trace_irqs_off(void);
+void trace_irqs_on(void);
+
+/* 由中断桩 (isr.asm/sysenter.asm) 调用：进入时 / iret 之前 */
+void irqsoff_irq_enter(uint32_t vector);
+void irqsoff_irq_exit(struct registers* regs);
+
+/* 根据 TSC 频率换算报告阈值 (在 clocksource_init 之后调用) */
+void irqsoff_init(void);
+
+void irqsoff_dump(void);
+void irqsoff_reset(void);
+#endif
+
+/* 由每个 CPU 的时钟中断调用：喂狗、检查其他 CPU、打印待报告的长区间 */
+void watchdog_tick(void);
+
+#endif
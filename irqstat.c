@@ -0,0 +1,164 @@
+#include "irqstat.h"
+#include "clocksource.h"
+#include "terminal.h"
+#include "smp.h"
+#include "cpu.h"
+
+// 本文件负责：
+// - 每 CPU、每向量的耗时累计 (由中断桩在关中断状态下调用，无锁)
+// - irqstat 命令：汇总所有 CPU 并打印，标出超出延迟预算的向量
+//
+// 向量 0-50 (异常与 IRQ) 各占一个槽，0x80/0x81 各占一个，其余向量合并到最后一个槽。
+
+#define IRQSTAT_SLOT_SYSCALL  51
+#define IRQSTAT_SLOT_BENCH    52
+#define IRQSTAT_SLOT_OTHER    53
+#define IRQSTAT_SLOTS         54
+
+struct irqstat {
+    uint32_t count;
+    uint32_t min, max;              /* 总耗时 t2 - t0 */
+    uint64_t sum;
+    uint64_t handler_sum;           /* 处理函数耗时 t1 - t0 */
+    uint32_t handler_max;
+    uint32_t over;                  /* 总耗时超出预算的次数 */
+    uint32_t hist[IRQSTAT_BUCKETS];
+};
+
+static struct irqstat irqstats[SMP_MAX_CPUS][IRQSTAT_SLOTS];
+static uint32_t budget_cycles = 0xFFFFFFFF;
+
+static inline uint32_t irqstat_slot(uint32_t vector) {
+    if (vector < IRQSTAT_SLOT_SYSCALL) return vector;
+    if (vector == 0x80) return IRQSTAT_SLOT_SYSCALL;
+    if (vector == 0x81) return IRQSTAT_SLOT_BENCH;
+    return IRQSTAT_SLOT_OTHER;
+}
+
+static inline uint32_t irqstat_bucket(uint32_t cycles) {
+    if (cycles < (1u << IRQSTAT_MIN_SHIFT)) return 0;
+    uint32_t msb;
+    asm("bsr %1, %0" : "=r"(msb) : "rm"(cycles));
+    uint32_t b = msb - IRQSTAT_MIN_SHIFT + 1;
+    return b < IRQSTAT_BUCKETS ? b : IRQSTAT_BUCKETS - 1;
+}
+
+void irqstat_record(uint32_t vector, uint32_t t_entry, uint32_t t_ret, uint32_t t_exit) {
+    struct irqstat* s = &irqstats[smp_processor_id()][irqstat_slot(vector)];
+    uint32_t total = t_exit - t_entry;
+    uint32_t handler = t_ret - t_entry;
+
+    if (s->count == 0 || total < s->min) s->min = total;
+    if (total > s->max) s->max = total;
+    s->count++;
+    s->sum += total;
+    s->handler_sum += handler;
+    if (handler > s->handler_max) s->handler_max = handler;
+    if (total > budget_cycles) s->over++;
+    s->hist[irqstat_bucket(total)]++;
+}
+
+void irqstat_init(void) {
+    uint32_t khz = clocksource_tsc_khz();
+    if (khz) budget_cycles = khz / 1000 * IRQSTAT_BUDGET_US;
+}
+
+void irqstat_reset(void) {
+    /* 其他 CPU 可能正在更新自己的槽：清零与更新交错只会让个别样本丢失 */
+    uint32_t* p = (uint32_t*)irqstats;
+    for (uint32_t i = 0; i < sizeof(irqstats) / 4; i++) p[i] = 0;
+    terminal_writestring("irqstat: counters cleared\n");
+}
+
+static const char* irqstat_name(uint32_t slot) {
+    switch (slot) {
+    case 7:  return "#NM";
+    case 13: return "#GP";
+    case 14: return "#PF";
+    case 32: return "PIT";
+    case 33: return "kbd";
+    case 48: return "lapic-tmr";
+    case 49: return "self-IPI";
+    case 50: return "resched";
+    case IRQSTAT_SLOT_SYSCALL: return "syscall";
+    case IRQSTAT_SLOT_BENCH:   return "int 0x81";
+    case IRQSTAT_SLOT_OTHER:   return "other";
+    default: return "";
+    }
+}
+
+static void irqstat_pad(const char* s, uint32_t width) {
+    uint32_t n = 0;
+    while (s[n]) n++;
+    terminal_writestring(s);
+    while (n++ < width) terminal_putchar(' ');
+}
+
+static void irqstat_col(uint32_t v) {
+    /* 右对齐到 9 列；10 位数 (>= 10^9) 多占一列，不截掉最高位 */
+    char buf[11];               /* uint32_t 最多 10 位 + '\0' */
+    int i = 10;
+    buf[i] = '\0';
+    do { buf[--i] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (i > 1) buf[--i] = ' ';
+    terminal_writestring(buf + i);
+}
+
+void irqstat_dump(void) {
+    uint32_t ncpu = smp_num_cpus();
+    terminal_writestring("budget: ");
+    terminal_writedec(IRQSTAT_BUDGET_US);
+    terminal_writestring("us, cycles (t0=entry t1=handler return t2=iret)\n");
+    terminal_writestring("VEC NAME         COUNT      MIN      AVG      MAX  HDL-AVG  HDL-MAX OVER\n");
+
+    for (uint32_t slot = 0; slot < IRQSTAT_SLOTS; slot++) {
+        struct irqstat t = { 0 };
+        for (uint32_t c = 0; c < ncpu; c++) {
+            struct irqstat* s = &irqstats[c][slot];
+            if (!s->count) continue;
+            if (t.count == 0 || s->min < t.min) t.min = s->min;
+            if (s->max > t.max) t.max = s->max;
+            if (s->handler_max > t.handler_max) t.handler_max = s->handler_max;
+            t.count += s->count;
+            t.sum += s->sum;
+            t.handler_sum += s->handler_sum;
+            t.over += s->over;
+            for (uint32_t b = 0; b < IRQSTAT_BUCKETS; b++) t.hist[b] += s->hist[b];
+        }
+        if (!t.count) continue;
+
+        if (slot < IRQSTAT_SLOT_SYSCALL) {
+            if (slot < 10) terminal_putchar(' ');
+            terminal_writedec(slot);
+            terminal_putchar(' ');
+        } else {
+            terminal_writestring(slot == IRQSTAT_SLOT_OTHER ? " -- " : (slot == IRQSTAT_SLOT_SYSCALL ? "128 " : "129 "));
+        }
+        irqstat_pad(irqstat_name(slot), 9);
+        irqstat_col(t.count);
+        irqstat_col(t.min);
+        irqstat_col((uint32_t)div_u64(t.sum, t.count));
+        irqstat_col(t.max);
+        irqstat_col((uint32_t)div_u64(t.handler_sum, t.count));
+        irqstat_col(t.handler_max);
+        terminal_writestring(t.over ? " !" : "  ");
+        terminal_writedec(t.over);
+        terminal_putchar('\n');
+
+        /* log2 直方图：只列出非空的桶，"2^k:n" 表示 [2^k, 2^(k+1)) 个周期 */
+        terminal_writestring("    ");
+        for (uint32_t b = 0; b < IRQSTAT_BUCKETS; b++) {
+            if (!t.hist[b]) continue;
+            if (b == 0) terminal_writestring("<2^8");
+            else {
+                terminal_writestring("2^");
+                terminal_writedec(b + IRQSTAT_MIN_SHIFT - 1);
+                if (b == IRQSTAT_BUCKETS - 1) terminal_putchar('+');
+            }
+            terminal_putchar(':');
+            terminal_writedec(t.hist[b]);
+            terminal_putchar(' ');
+        }
+        terminal_putchar('\n');
+    }
+}
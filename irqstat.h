@@ -0,0 +1,37 @@
+/**
+ * irqstat.h - 每个中断向量的耗时统计 (shell 命令 irqstat)
+ *
+ * isr.asm 的通用桩在三个位置读 TSC：
+ *   t0 进入桩 (pusha 之后，第一条能用寄存器的指令)
+ *   t1 分派的 C 处理函数返回 (含 do_softirq、schedule)
+ *   t2 即将 iret (已切换到新任务的栈、finish_task_switch 之后)
+ * 然后调用 irqstat_record(vector, t0, t1, t2)。
+ *
+ * 对每个向量记录：次数、总耗时 (t2 - t0) 的最小/平均/最大值与 log2 直方图、
+ * 处理函数耗时 (t1 - t0) 的平均/最大值，以及超出延迟预算的次数。
+ * 总耗时就是这次中断让被打断的代码多等了多久，也是同一 CPU 上其他中断被推迟的上限。
+ *
+ * 统计按 CPU 分开存放 (更新时不需要锁或原子操作)，显示时再汇总。
+ * TSC 只取低 32 位：单次中断不会超过 2^32 个周期。
+ *
+ * @see [irqstat.md](doc/irqstat.md)
+ */
+#ifndef IRQSTAT_H
+#define IRQSTAT_H
+
+#include <stdint.h>
+
+#define IRQSTAT_BUCKETS    20    /* 直方图：<2^8, [2^8,2^9), ... , >=2^26 个周期 */
+#define IRQSTAT_MIN_SHIFT  8
+#define IRQSTAT_BUDGET_US  100   /* 延迟预算：单次中断超过它就计入 over */
+
+/* 由 isr.asm 在 iret 之前调用 (关中断) */
+void irqstat_record(uint32_t vector, uint32_t t_entry, uint32_t t_ret, uint32_t t_exit);
+
+/* 根据 TSC 频率计算延迟预算 (在 clocksource_init 之后调用) */
+void irqstat_init(void);
+
+void irqstat_dump(void);
+void irqstat_reset(void);
+
+#endif
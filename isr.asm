@@ -58,35 +58,66 @@
 [global irq13]
 [global irq14]
 [global irq15]
+[global irq16]  ; LAPIC 定时器 (APIC 模式，向量 48)
+[global irq17]  ; LAPIC 自发 IPI (向量 49)，中断开销测试用
+[global irq18]  ; 重新调度 IPI (向量 50)：唤醒其他 CPU 上的任务后让它立即调度
+[global isr129] ; 软中断开销测试 (0x81，仅 Ring 0)
+[global isr_spurious] ; LAPIC 伪中断 (向量 0xFF)
 
 [global idt_flush]
+[global interrupt_exit]     ; 公共返回路径 (sysenter.asm 切换任务后也从这里返回)
+[global irq_fast_entry]     ; 1: Ring 0 被打断时跳过段寄存器装载 (irqbench 可临时关闭做对比)
+
+; alternatives 修补表与替换指令 (格式见 alternative.h 的 struct alt_instr)
+section .altinstructions progbits alloc noexec nowrite align=1
+section .altinstr_replacement progbits alloc exec nowrite align=1
+section .text
 
 ; -----------------------------------------------------------------------------
 ; 宏 (Macro)：可以理解为汇编版本的“函数模板”
 ; -----------------------------------------------------------------------------
 
+; 时间戳：把 TSC 低 32 位读进 EAX (可能改写 EDX)。
+; 默认是 xor eax, eax (时间戳为 0，486 等没有 TSC 的 CPU 上也能执行)，
+; CPU 有 TSC 时 alternatives_apply 把它改成 rdtsc：两条指令都是 2 字节，不用补 NOP
+X86_FEATURE_TSC equ 4       ; 与 cpufeature.h 一致 (字 0 位 4)
+%macro TSC_STAMP 0
+%%old:
+    xor eax, eax
+%%old_end:
+[section .altinstr_replacement]
+%%repl:
+    rdtsc
+%%repl_end:
+[section .altinstructions]
+    dd %%old, %%repl
+    dw X86_FEATURE_TSC
+    db %%old_end - %%old, %%repl_end - %%repl
+__SECT__
+%endmacro
+
 ; 模板 A：用于不带错误码的中断
 ; 参数 %1 是中断号。我们手动压入一个 0 作为错误码占位，保持栈结构一致。
 %macro ISR_NOERRCODE 1
 isr%1:
     push 0          ; 压入伪错误码 (为了凑整)
     push %1         ; 压入中断号
-    jmp isr_common_stub
+    jmp common_stub
 %endmacro
 
 ; 模板 B：用于带错误码的中断 (CPU 已经压入错误码了)
 %macro ISR_ERRCODE 1
 isr%1:
     push %1         ; 只压入中断号
-    jmp isr_common_stub
+    jmp common_stub
 %endmacro
 
 ; 模板 C：用于硬件中断 (IRQ)
 %macro IRQ 2
 irq%1:
     push 0          ; 硬件不发错误码，补个 0
-    push %2         ; 压入它对应的中断向量号 (32-47)
-    jmp irq_common_stub
+    push %2         ; 压入它对应的中断向量号 (32-50)
+    jmp common_stub
 %endmacro
 
 ; 定义所有ISR
@@ -123,6 +154,7 @@ ISR_NOERRCODE 29
 ISR_NOERRCODE 30
 ISR_NOERRCODE 31
 ISR_NOERRCODE 128
+ISR_NOERRCODE 129
 
 
 ; 定义所有IRQ (IRQ0-7映射到ISR32-39, IRQ8-15映射到ISR40-47)
@@ -142,6 +174,13 @@ IRQ 12, 44
 IRQ 13, 45
 IRQ 14, 46
 IRQ 15, 47
+IRQ 16, 48      ; 虚拟 IRQ 线：LAPIC 定时器
+IRQ 17, 49      ; 虚拟 IRQ 线：LAPIC 自发 IPI (中断开销测试)
+IRQ 18, 50      ; 虚拟 IRQ 线：重新调度 IPI
+
+; LAPIC 伪中断：中断在送达前被撤销时产生，规定不能发 EOI，直接返回即可
+isr_spurious:
+    iret
 
 ; -----------------------------------------------------------------------------
 ; 通用处理桩 (Common Stubs)：这是中断处理的“中转站”
@@ -152,62 +191,102 @@ IRQ 15, 47
 ; 汇编编译器会先留个坑位，最后由【链接器】把这个坑位填上 C 函数的真实内存地址。
 ; 这样，汇编就可以像“跨界”一样调用 C 语言写的逻辑了。
 ; -----------------------------------------------------------------------------
-extern isr_handler
-extern irq_handler
+extern interrupt_table
+extern finish_task_switch
+extern irqstat_record
+%ifdef CONFIG_IRQSOFF_TRACE
+extern irqsoff_irq_enter
+extern irqsoff_irq_exit
+%endif
+
+; 栈帧布局 (struct registers，从 ESP 往上)：
+;   +0  gs fs es ds          (16 字节)
+;   +16 pusha                (32 字节)
+;   +48 int_no, err_code
+;   +56 eip
+;   +60 cs                   <- 低 2 位就是被打断代码的特权级
+FRAME_INT_NO equ 48
+FRAME_CS     equ 60
 
-; ISR 通用桩：负责把 CPU 所有的“状态”都保存起来，然后跳到 C 语言里
-isr_common_stub:
+; 唯一的通用桩：所有异常、IRQ、系统调用都走这里，按向量号查 interrupt_table (C 侧填写)
+; 分派到各自的处理函数，不再分 isr_common_stub / irq_common_stub 两份。
+;
+; 快速路径：被打断的是 Ring 0 时，DS/ES/FS 本来就是 0x10、GS 本来就是本 CPU 的 0x30，
+; 装载段寄存器 (每次都要查 GDT 描述符、做特权检查) 纯属浪费，入口和出口都跳过。
+; 段寄存器仍然压栈，栈帧布局不变：schedule() 切到的新任务可能来自任何入口，
+; 它的现场总是一个完整的 struct registers。
+common_stub:
     pusha           ; 【保存通用寄存器】压入 EAX, ECX, EDX, EBX, ESP, EBP, ESI, EDI
-    push ds         ; 【保存段寄存器】记录当前数据段
+    TSC_STAMP       ; t0：进入时刻。EAX/EDX 已经保存，可以随便用
+    mov esi, eax    ; ESI/EDI/EBX 是 C 调用约定中的被调用者保存寄存器，跨 C 调用保持不变
+    push ds         ; 【保存段寄存器】即使不重新装载也要保存，保持栈帧一致
     push es
     push fs
     push gs
-    
+
+    test byte [esp + FRAME_CS], 3       ; 从 Ring 3 进来？段寄存器还是用户的
+    jnz .load_segs
+    cmp dword [irq_fast_entry], 0       ; (Ring 0 时 DS 已是内核段，可以直接访问变量)
+    jne .dispatch
+.load_segs:
     mov ax, 0x10    ; 加载内核数据段选择子 (进入内核的地盘)
     mov ds, ax
     mov es, ax
     mov fs, ax
+    mov ax, 0x30    ; GS 指向本 CPU 的每 CPU 数据 (cpu_t)
     mov gs, ax
-    
+
+.dispatch:
+    mov ebx, [esp + FRAME_INT_NO]
+%ifdef CONFIG_IRQSOFF_TRACE
+    push ebx        ; 关中断区间追踪：从开中断的代码进入时，区间从这里开始 (irqsoff.h)
+    call irqsoff_irq_enter
+    add esp, 4
+%endif
     push esp        ; 把当前的栈顶地址 (regs 指针) 传给 C 语言函数
-    call isr_handler ; 调用 C 层的处理函数 (比如显示异常号或处理系统调用)
-    mov esp, eax    ; 【灵魂一行】如果 C 语言决定换个任务跑，我们就把 ESP 换成新任务的栈
-    
+    call [interrupt_table + ebx * 4]    ; 返回 (可能是另一个任务的) 现场指针
+    mov ebp, eax
+    TSC_STAMP       ; t1：处理函数返回
+    mov edi, eax
+    mov esp, ebp    ; 【灵魂一行】如果 C 语言决定换个任务跑，我们就把 ESP 换成新任务的栈
+    call finish_task_switch ; 已离开旧栈：允许其他 CPU 接手刚被切走的任务
+
+    TSC_STAMP       ; t2：即将返回。irqstat_record(vector, t0, t1, t2)，见 irqstat.h
+    push eax
+    push edi
+    push esi
+    push ebx
+    call irqstat_record
+    add esp, 16
+%ifdef CONFIG_IRQSOFF_TRACE
+    push esp        ; 要恢复的现场 IF=1 时，关中断区间在 iret 处结束
+    call irqsoff_irq_exit
+    add esp, 4
+%endif
+
+; 公共返回路径：ESP 指向要恢复的 struct registers
+interrupt_exit:
+    test byte [esp + FRAME_CS], 3       ; 回到 Ring 3 必须恢复用户段寄存器
+    jnz .pop_segs
+    cmp dword [irq_fast_entry], 0
+    je .pop_segs
+    add esp, 16     ; 回到 Ring 0：段寄存器已经是内核段，直接丢弃保存的值
+    jmp .pop_regs
+.pop_segs:
     pop gs          ; 恢复段寄存器
     pop fs
     pop es
     pop ds
+.pop_regs:
     popa            ; 恢复通用寄存器
     add esp, 8      ; 跳过栈上的“中断号”和“错误码”
     iret            ; 【中断退出】CPU 从栈里弹出 EIP/CS/EFLAGS，任务“活”过来了
 
-irq_common_stub:
-    pusha           ; 保存所有通用寄存器
-    push ds         ; 保存段寄存器
-    push es
-    push fs
-    push gs
-    
-    mov ax, 0x10    ; 加载内核数据段
-    mov ds, ax
-    mov es, ax
-    mov fs, ax
-    mov gs, ax
-    
-    push esp        ; 传递 struct registers* 参数
-    call irq_handler ; 调用C处理函数 (返回新的 ESP 到 EAX)
-    mov esp, eax    ; <--- 关键点：切换栈指针 (Context Switch)
-    
-    pop gs          ; 恢复段寄存器 (从新栈)
-    pop fs
-    pop es
-    pop ds
-    popa            ; 恢复通用寄存器
-    add esp, 8      ; 清理错误码和中断号
-    iret            ; 中断返回 (弹出新栈的 EIP)
-
 ; 加载 IDT：C 层传入 idtp 指针，通过 lidt 生效
 idt_flush:
     mov eax, [esp+4]
     lidt [eax]
     ret
+
+section .data
+irq_fast_entry: dd 1
@@ -0,0 +1,91 @@
+#include "kbd.h"
+#include "process.h"
+#include "cpu.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 每个输入源一个单生产者/单消费者环形缓冲区 (生产者是中断处理函数)
+// - kbd_read：唯一的读者 (Shell 任务) 在缓冲区为空时阻塞
+// - kbd_wake：生产者入队后唤醒读者
+//
+// 并发说明：head 只由生产者写，tail 只由读者写，都是 volatile，先写数据再推进 head，
+// x86 的写入不会重排，所以不需要锁。
+// 唤醒不能丢：读者“标记阻塞 → 检查缓冲区”，生产者“推进 head → 检查读者是否阻塞”，
+// 两边之间各有一个全屏障 (mfence)，至少有一方能看到另一方的写入：
+// 要么读者看到新字符不睡，要么生产者看到 STATE_BLOCKED 把它唤醒。
+
+#define KBD_MASK (KBD_BUF_SIZE - 1)
+
+struct kbd_ring {
+    volatile char buf[KBD_BUF_SIZE];
+    volatile uint32_t head;     /* 仅生产者写 */
+    volatile uint32_t tail;     /* 仅读者写 */
+};
+
+static struct kbd_ring kbd_rings[KBD_NR_SRC];
+static process_t* volatile kbd_reader = NULL;
+
+void kbd_put(int src, char c) {
+    struct kbd_ring* r = &kbd_rings[src];
+    uint32_t head = r->head;
+    if (head - r->tail >= KBD_BUF_SIZE) return;
+    r->buf[head & KBD_MASK] = c;
+    r->head = head + 1;
+}
+
+void kbd_wake(void) {
+    __sync_synchronize();       /* head 的写入先于读取读者状态 (与 kbd_read 配对) */
+    process_t* p = kbd_reader;
+    if (p) process_wake(p);
+}
+
+static int kbd_pending(void) {
+    for (int s = 0; s < KBD_NR_SRC; s++) {
+        if (kbd_rings[s].tail != kbd_rings[s].head) return 1;
+    }
+    return 0;
+}
+
+// 依次取出各输入源中的字符
+static uint32_t kbd_drain(char* buf, uint32_t size) {
+    uint32_t n = 0;
+    for (int s = 0; s < KBD_NR_SRC && n < size; s++) {
+        struct kbd_ring* r = &kbd_rings[s];
+        uint32_t head = r->head;
+        uint32_t tail = r->tail;
+        while (tail != head && n < size) {
+            buf[n++] = r->buf[tail & KBD_MASK];
+            tail++;
+        }
+        r->tail = tail;
+    }
+    return n;
+}
+
+uint32_t kbd_read(char* buf, uint32_t size) {
+    if (size == 0) return 0;
+    while (1) {
+        uint32_t n = kbd_drain(buf, size);
+        if (n) return n;
+
+        /* 关中断标记阻塞后再检查一次：已经有字符就撤销阻塞，否则让出 CPU 等 kbd_wake */
+        uint32_t flags = local_irq_save();
+        process_t* self = process_current();
+        kbd_reader = self;
+        process_block_current();
+        __sync_synchronize();   /* STATE_BLOCKED 的写入先于读取 head (与 kbd_wake 配对) */
+        if (kbd_pending()) {
+            process_wake(self);
+        } else {
+            process_yield();
+        }
+        local_irq_restore(flags);
+    }
+}
+
+static uint32_t kbd_dev_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    (void)node; (void)offset;
+    return kbd_read((char*)buffer, size);
+}
+
+fs_node_t kbd_dev = { "kbd", FS_CHARDEVICE, 0, 0, kbd_dev_read, NULL, NULL, NULL, NULL, NULL };
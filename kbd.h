@@ -0,0 +1,44 @@
+/**
+ * kbd.h - 控制台输入设备 (键盘 + 串口)
+ *
+ * 按键由中断处理函数翻译成字符后放进环形缓冲区，Shell 作为独立的内核线程
+ * 阻塞读取这个设备 (kbd_read / VFS 字符设备 kbd_dev)，命令在线程上下文中执行。
+ *
+ * - 每个输入源 (PS/2 键盘 IRQ1、串口 IRQ4) 一个单生产者/单消费者环形缓冲区，
+ *   入队只是一次写数组加一次写 head，不加锁；
+ * - 读者只有一个 (Shell 任务)：缓冲区为空时标记阻塞并让出 CPU，
+ *   生产者入队后调用 kbd_wake 唤醒它；
+ * - 缓冲区满时丢弃新字符 (按键不会快到这个程度，除非读者卡住)。
+ *
+ * 中断处理函数只做扫描码翻译、入队和一次唤醒，耗时与 Shell 正在执行什么命令无关。
+ *
+ * @see [kbd.md](doc/kbd.md)
+ */
+#ifndef KBD_H
+#define KBD_H
+
+#include <stdint.h>
+#include "fs.h"
+
+#define KBD_SRC_PS2     0       /* PS/2 键盘 (IRQ1) */
+#define KBD_SRC_SERIAL  1       /* 串口终端 (IRQ4) */
+#define KBD_NR_SRC      2
+#define KBD_BUF_SIZE    128     /* 每个输入源的缓冲区大小 (2 的幂) */
+
+/* 不对应字符的按键，以控制字符的形式放进缓冲区，由 Shell 任务处理 */
+#define KBD_KEY_PGUP    0x01
+#define KBD_KEY_PGDN    0x02
+
+/* 放入一个字符 (每个输入源只能有一个生产者；可在中断上下文调用，不唤醒读者) */
+void kbd_put(int src, char c);
+
+/* 唤醒等待输入的读者 (可在中断上下文调用；不要在持有其他自旋锁时调用) */
+void kbd_wake(void);
+
+/* 读取至少 1 个、至多 size 个字符，没有输入时阻塞。只允许一个读者 */
+uint32_t kbd_read(char* buf, uint32_t size);
+
+/* 字符设备节点：read 即 kbd_read (offset 无意义) */
+extern fs_node_t kbd_dev;
+
+#endif
@@ -8,6 +8,26 @@
 #include "process.h"
 #include "initrd.h"
 #include "shell.h"
+#include "async.h"
+#include "workqueue.h"
+#include "apic.h"
+#include "smp.h"
+#include "syscall.h"
+#include "cpu.h"
+#include "uring.h"
+#include "vdso.h"
+#include "clocksource.h"
+#include "hrtimer.h"
+#include "fpu.h"
+#include "irqstat.h"
+#include "irqsoff.h"
+#include "printk.h"
+#include "serial.h"
+#include "fbcon.h"
+#include "string.h"
+#include "cpufeature.h"
+#include "alternative.h"
+#include "boottime.h"
 
 /* Forward declarations */
 void task_a(void);
@@ -23,117 +43,195 @@ void user_task(void);
  * @see [kernel_entry.md](doc/kernel_entry.md) - 初始化流程图解
  */
 void kmain(void) {
+    /* 0. 启动计时：读取引导扇区记下的 TSC，之后每个阶段结束时 boottime_mark 一次，
+     * 启动结束时打印时间线 (shell 的 boottime 命令可再次查看) */
+    boottime_init();
+
     /* 1. 终端初始化
      * 最先初始化，以便后续步骤可以打印日志信息。
      * 清屏、设置默认颜色、禁用硬件光标。
+     * 串口 (COM1) 注册为第二个控制台，之后的输出同时从串口发出 (开中断前为轮询发送)。
      */
     terminal_initialize();
+    serial_init();
     
     terminal_setcolor(vga_entry_color(VGA_COLOR_GREEN, VGA_COLOR_BLACK));
     terminal_writestring("========================================\n");
     terminal_writestring("    Welcome to MyOS Kernel v2.0!\n");
     terminal_writestring("========================================\n\n");
+    boottime_mark("console");
     
     /* 2. GDT (Global Descriptor Table) 初始化
      * 必须在 IDT 和内存管理之前完成。
      * 它定义了内核态和用户态的代码段/数据段，是保护模式的基础。
      */
     terminal_setcolor(vga_entry_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK));
-    terminal_writestring("Initializing GDT...\n");
+    printk(KERN_INFO, "Initializing GDT...\n");
     gdt_init();
-    terminal_writestring("GDT initialized successfully!\n\n");
+    printk(KERN_INFO, "GDT initialized successfully!\n");
+    boottime_mark("gdt");
     
     /* 3. 中断系统初始化
+     * - cpufeature_init: 执行 CPUID 填写特性位图，之后各子系统用 cpu_has() 判断特性。
      * - idt_init: 加载空的 IDT 表。
      * - isr_init: 注册 CPU 异常处理函数 (如 Page Fault)。
      * - irq_init: 重映射 PIC (可编程中断控制器) 并注册硬件中断 (如键盘、时钟)。
      * - pit_init: 初始化定时器，用于后续的任务调度 (Time Slicing)。
+     * - syscall_init: CPU 支持时设置 SYSENTER 的 MSR (快速系统调用入口)。
+     * - fpu_init: 打开 x87/SSE (CR0/CR4)，之后任务的 FPU 状态在 #NM 中惰性切换。
+     * - string_init: 打印 memcpy/memset 各长度档使用的实现 (ERMS/SSE2)。
+     * - alternatives_apply: 按特性位图修补热路径上的指令 (static_cpu_has / ALTERNATIVE)，
+     *   必须在 fpu_init 之后 (SSE 已打开)、smp_init 之前 (只有 BSP 在运行)。
+     *   rdtsc() 在修补之前恒为 0，所以也必须在 clocksource_init 之前。
+     * - clocksource_init: 以 PIT 为基准校准 TSC，提供纳秒级单调时钟。
+     * - irqstat_init: 按 TSC 频率换算中断延迟预算 (各向量的耗时统计从第一个中断就开始记录)。
+     * - irqsoff_init: 开启关中断区间追踪 (仅 IRQSOFF_TRACE=1 构建)。
      */
-    terminal_writestring("Initializing IDT...\n");
+    cpufeature_init();
+    printk(KERN_INFO, "Initializing IDT...\n");
     idt_init();
     isr_init();
     irq_init();
     pit_init(100); /* 100Hz = 每 10ms 触发一次时钟中断 */
+    syscall_init();
+    boottime_mark("idt/pic/pit");
+    fpu_init();
+    string_init();
+    alternatives_apply();
+    boottime_mark("fpu/alt");
+    clocksource_init(100);
+    irqstat_init();
+#ifdef CONFIG_IRQSOFF_TRACE
+    irqsoff_init();
+#endif
+    boottime_mark("tsc calib");
     
     /* 4. 内存管理初始化
      * - PMM (Physical Memory Manager): 管理物理页框的分配/释放。
      * - VMM (Virtual Memory Manager): 建立页表，开启分页机制。
      * - Heap: 在 VMM 之上建立内核堆，支持 kmalloc/kfree。
      */
-    terminal_writestring("Initializing PMM...\n");
+    printk(KERN_INFO, "Initializing PMM...\n");
     pmm_init();
+    boottime_mark("pmm");
 
-    terminal_writestring("Initializing VMM...\n");
+    printk(KERN_INFO, "Initializing VMM...\n");
     vmm_init();
+    boottime_mark("vmm");
+
+    /* 图形控制台 (仅 FBCON=1 构建)：线性帧缓冲位于 4MB 以上，分页开启后才能映射。
+     * 切换成功后终端改由 fbcon 显示，失败则继续使用文本模式 */
+#ifdef CONFIG_FBCON
+    fbcon_init();
+    boottime_mark("fbcon");
+#endif
+
+    /* 5. 中断控制器升级
+     * - 解析 ACPI MADT，启用 LAPIC/IOAPIC，IRQ 路由与 EOI 从 8259 切换到 APIC；
+     * - LAPIC 定时器以 PIT 为基准校准后接管时钟节拍 (频率与 pit_init 相同)；
+     * - 任一步失败都继续使用 8259 PIC + PIT。
+     * APIC 寄存器位于 4MB 以上的物理地址，需要在分页开启后映射，所以放在 VMM 之后。
+     */
+    if (apic_init()) {
+        apic_timer_init(100);
+    }
+    boottime_mark("apic");
+
+    /* 高精度定时器：节拍交给 LAPIC 后，PIT 通道 0 改为单次模式按到期时刻触发 */
+    hrtimers_init();
 
-    terminal_writestring("Initializing Heap...\n");
+    /* 用户态可直接读取的时间页 (vDSO)，之后由时钟中断每个 tick 更新 */
+    vdso_init(100);
+    boottime_mark("hrtimer/vdso");
+
+    printk(KERN_INFO, "Initializing Heap...\n");
     kheap_init();
 
     /* 堆分配测试 */
-    terminal_writestring("Testing Heap...\n");
+    printk(KERN_INFO, "Testing Heap...\n");
     void* ptrA = kmalloc(10);
     void* ptrB = kmalloc(20);
-    terminal_writestring("Malloc A: "); if(ptrA) terminal_writestring("OK ");
-    terminal_writestring("Malloc B: "); if(ptrB) terminal_writestring("OK\n");
+    printk(KERN_INFO, "Malloc A: %s Malloc B: %s\n", ptrA ? "OK" : "FAIL", ptrB ? "OK" : "FAIL");
     kfree(ptrA);
     kfree(ptrB);
-    terminal_writestring("Free A&B OK\n\n");
+    printk(KERN_INFO, "Free A&B OK\n");
+    boottime_mark("heap");
 
-    /* 5. 文件系统初始化
+    /* 6. 文件系统初始化
      * 初始化 InitRD (Initial Ramdisk)，并挂载 VFS (虚拟文件系统)。
      * 这使得内核可以读取打包在镜像中的文件 (如 hello.txt)。
      */
-    terminal_writestring("Initializing InitRD...\n");
+    printk(KERN_INFO, "Initializing InitRD...\n");
     fs_root = initrd_init();
     
     if (fs_root) {
-        terminal_writestring("Listing files in /:\n");
+        printk(KERN_INFO, "Listing files in /:\n");
         fs_node_t* node = vfs_finddir(fs_root, "hello.txt");
         if (node) {
-            terminal_writestring("Found: hello.txt\n");
+            printk(KERN_INFO, "Found: hello.txt\n");
             uint8_t buf[32];
             uint32_t sz = vfs_read(node, 0, 32, buf);
             buf[sz] = 0; // Null terminate
-            terminal_writestring("Content: ");
-            terminal_writestring((char*)buf);
-            terminal_putchar('\n');
+            printk(KERN_INFO, "Content: %s\n", (char*)buf);
         } else {
-            terminal_writestring("File hello.txt not found!\n");
+            printk(KERN_WARNING, "File hello.txt not found!\n");
         }
     }
 
-    /* 6. 多任务子系统初始化
+    boottime_mark("initrd");
+
+    /* 7. 多任务子系统初始化
      * - process_init: 将当前执行流 (kmain) 包装为 PID 0 的 Idle 进程。
      * - process_create: 创建新的内核线程。
      * - process_create_user: 创建用户态进程 (Ring 3)。
+     * - async_init: 创建 kasyncd 工作线程，承载无栈异步任务 (状态栏刷新等)。
+     * - workqueue_init: 创建系统工作队列及其 worker 线程池。
+     * - smp_init: 通过 INIT/SIPI 唤醒其余 CPU (AP)。它们上线后从 BSP 的运行队列
+     *   偷取任务，之后由周期性负载均衡保持各 CPU 队列长度接近。
      */
-    terminal_writestring("Tasks created. Entering infinite loop...\n");
+    printk(KERN_INFO, "Tasks created. Entering infinite loop...\n");
     process_init(); 
+    async_init();
+    workqueue_init();
 
     process_create(task_a, "Task A");
     process_create(task_b, "Task B");
     process_create_user(user_task, "User Task");
+    boottime_mark("tasks");
+
+    smp_init();
+    boottime_mark("smp");
     
-    terminal_writestring("IDT initialized successfully!\n\n");
+    printk(KERN_INFO, "IDT initialized successfully!\n");
     
-    /* 刷新底部状态栏 (如果有的话) */
+    /* 刷新底部状态栏 (如果有的话)，之后由异步任务周期刷新 */
     status_refresh();
+    status_start();
     
-    /* 7. 初始化 Shell
+    /* 8. 初始化 Shell
      * 这是一个简单的交互式命令行环境。
+     * Shell 作为独立的内核线程运行，阻塞读取键盘/串口输入设备 (kbd.h)，命令在线程上下文中执行。
      */
     shell_init();
+    boottime_mark("shell");
 
-    terminal_writestring("System ready! Interrupts enabled.\n");
-    terminal_writestring("Press any key to test keyboard interrupt...\n");
+    printk(KERN_INFO, "System ready! Interrupts enabled.\n");
+    printk(KERN_INFO, "Press any key to test keyboard interrupt...\n");
     
-    /* 8. 开启中断，启动调度
+    /* 启动完成：之后的普通日志只写缓冲区，由工作队列异步输出到屏幕；
+     * 串口改为中断驱动 (IRQ4)，发送不再轮询，同时接收 Shell 输入 */
+    console_async_start();
+    serial_start_irq();
+    boottime_mark("console async");
+    boottime_report();
+
+    /* 9. 开启中断，启动调度
      * 这里的 sti (Set Interrupt Flag) 指令一旦执行，CPU 就开始响应中断。
      * 当第一次时钟中断到来时，scheduler 就会介入，开始任务切换。
      */
-    asm volatile("sti");
+    local_irq_enable();
 
-    /* 9. Idle Loop (主循环)
+    /* 10. Idle Loop (主循环)
      * 当没有其他任务可运行时，调度器会切换回这里。
      * hlt 指令让 CPU 暂停直到下一个中断，节省能源。
      */
@@ -147,7 +245,7 @@ void kmain(void) {
  * 简单的无限循环任务，用于演示多任务切换。
  */
 void task_a(void) {
-    terminal_writestring("Task A started.\n");
+    printk(KERN_INFO, "Task A started.\n");
     while(1) {
         /* 内核态允许使用 hlt 以节省 CPU，
            因为只有中断能将其唤醒，而中断会自动发生。 */
@@ -159,12 +257,216 @@ void task_a(void) {
  * @brief 内核任务 B
  */
 void task_b(void) {
-    terminal_writestring("Task B started.\n");
+    printk(KERN_INFO, "Task B started.\n");
     while(1) {
         asm volatile("hlt");
     }
 }
 
+/*
+ * 用户态辅助函数：把无符号数格式化成十进制字符串 (用户态不能调用 terminal_writedec，
+ * 它会执行 cli)
+ */
+static char* user_utoa(uint32_t v, char* end) {
+    *end = 0;
+    do { *--end = '0' + (v % 10); v /= 10; } while (v);
+    return end;
+}
+
+/* 用户态辅助函数：write 需要显式长度，字符串长度由用户态自己计算 */
+static void user_puts(const char* s) {
+    uint32_t len = 0;
+    while (s[len]) len++;
+    user_syscall(SYS_WRITE, (uint32_t)s, len, 0, 0);
+}
+
+#define SYSBENCH_ROUNDS 8
+#define SYSBENCH_CALLS  1000
+
+/*
+ * 测量一次空系统调用 (0 号) 往返的周期数。
+ * 共 SYSBENCH_ROUNDS 轮，每轮连续调用 SYSBENCH_CALLS 次；取最快的一轮，
+ * 排除时钟中断、任务切换混入测量区间的影响。
+ */
+static uint32_t user_bench_null_syscall(int use_sysenter) {
+    uint64_t best = ~0ULL;
+    for (int r = 0; r < SYSBENCH_ROUNDS; r++) {
+        uint64_t t0 = rdtsc();
+        for (int i = 0; i < SYSBENCH_CALLS; i++) {
+            if (use_sysenter) {
+                uint32_t nr = SYS_NULL;
+                asm volatile("call user_syscall_sysenter" : "+a"(nr) : : "ecx", "edx", "memory", "cc");
+            } else {
+                uint32_t nr = SYS_NULL;
+                asm volatile("int $0x80" : "+a"(nr) : : "memory", "cc");
+            }
+        }
+        uint64_t t = rdtsc() - t0;
+        if (t < best) best = t;
+    }
+    return (uint32_t)div_u64(best, SYSBENCH_CALLS);
+}
+
+static void user_sysbench(void) {
+    char buf[12];
+    user_puts("[sysbench] null syscall: int 0x80 = ");
+    user_puts(user_utoa(user_bench_null_syscall(0), buf + 11));
+
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    if (d & CPUID_EDX_SEP) {
+        user_puts(" cycles, sysenter = ");
+        user_puts(user_utoa(user_bench_null_syscall(1), buf + 11));
+        user_puts(" cycles\n");
+    } else {
+        user_puts(" cycles, sysenter unsupported\n");
+    }
+}
+
+/* 用户态辅助函数：填写一个 SQE */
+static void user_uring_prep(struct uring_sqe* sqe, uint8_t op, uint32_t addr, uint32_t len,
+                            uint32_t off, uint32_t addr2, uint32_t user_data) {
+    sqe->opcode = op;
+    sqe->flags = 0;
+    sqe->addr = addr;
+    sqe->len = len;
+    sqe->off = off;
+    sqe->addr2 = addr2;
+    sqe->user_data = user_data;
+}
+
+#define URING_BENCH_BATCH 32
+
+/*
+ * uring 演示：
+ * 1. 一次 uring_enter 提交 32 个 NOP，测量平均每个操作的周期数，与上面的空系统调用对比；
+ * 2. 一次陷入完成“读 initrd 文件 + 三次写”。
+ */
+static void user_uring_demo(void) {
+    char num[12];
+    struct uring_shared* r = uring_setup(0);
+    if (!r) {
+        user_puts("[uring] setup failed\n");
+        return;
+    }
+
+    uint64_t best = ~0ULL;
+    for (int round = 0; round < SYSBENCH_ROUNDS; round++) {
+        uint64_t t0 = rdtsc();
+        for (uint32_t i = 0; i < URING_BENCH_BATCH; i++) {
+            user_uring_prep(uring_get_sqe(r, i), URING_OP_NOP, 0, 0, 0, 0, i);
+        }
+        uring_sq_advance(r, URING_BENCH_BATCH);
+        uring_enter(r, URING_BENCH_BATCH, 0, 0);
+        while (uring_peek_cqe(r)) uring_cq_advance(r, 1);
+        uint64_t t = rdtsc() - t0;
+        if (t < best) best = t;
+    }
+    user_puts("[uring] batch of 32 NOPs: ");
+    user_puts(user_utoa((uint32_t)div_u64(best, URING_BENCH_BATCH), num + 11));
+    user_puts(" cycles per op\n");
+
+    char buf[20];
+    user_uring_prep(uring_get_sqe(r, 0), URING_OP_READ, (uint32_t)buf, 16, 0, (uint32_t)"hello.txt", 1);
+    uring_sq_advance(r, 1);
+    uring_enter(r, 1, 1, URING_ENTER_GETEVENTS);
+    struct uring_cqe* cqe = uring_peek_cqe(r);
+    int32_t got = cqe ? cqe->res : -1;
+    uring_cq_advance(r, 1);
+    if (got < 0) got = 0;
+
+    const char* prefix = "[uring] hello.txt: ";
+    user_uring_prep(uring_get_sqe(r, 0), URING_OP_WRITE, (uint32_t)prefix, 19, 0, 0, 2);
+    user_uring_prep(uring_get_sqe(r, 1), URING_OP_WRITE, (uint32_t)buf, (uint32_t)got, 0, 0, 3);
+    user_uring_prep(uring_get_sqe(r, 2), URING_OP_WRITE, (uint32_t)"\n", 1, 0, 0, 4);
+    uring_sq_advance(r, 3);
+    uring_enter(r, 3, 3, URING_ENTER_GETEVENTS);
+    while (uring_peek_cqe(r)) uring_cq_advance(r, 1);
+}
+
+#define VDSO_BENCH_CALLS 1000
+
+/* vDSO 演示：测量一次 vdso_gettime_ns 的周期数，并打印当前的单调时间 */
+static void user_vdso_demo(void) {
+    char num[12];
+    uint64_t best = ~0ULL;
+    for (int round = 0; round < SYSBENCH_ROUNDS; round++) {
+        uint64_t t0 = rdtsc();
+        for (int i = 0; i < VDSO_BENCH_CALLS; i++) {
+            (void)vdso_gettime_ns();
+        }
+        uint64_t t = rdtsc() - t0;
+        if (t < best) best = t;
+    }
+    struct timespec ts;
+    vdso_clock_gettime(&ts);
+
+    user_puts("[vdso] clock_gettime: ");
+    user_puts(user_utoa((uint32_t)div_u64(best, VDSO_BENCH_CALLS), num + 11));
+    user_puts(" cycles per call, uptime ");
+    user_puts(user_utoa(ts.tv_sec, num + 11));
+    user_puts(".");
+    /* 毫秒部分补足 3 位 */
+    uint32_t ms = ts.tv_nsec / 1000000;
+    char* s = user_utoa(ms, num + 11);
+    for (int pad = 3 - (int)(num + 11 - s); pad > 0; pad--) user_puts("0");
+    user_puts(s);
+    user_puts(" s\n");
+}
+
+/* 高精度休眠演示：请求若干个短于一个 tick (10ms) 的休眠，用 vDSO 时钟量出实际睡了多久 */
+static void user_nanosleep_demo(void) {
+    static const uint32_t req_us[] = { 50, 200, 1000, 3000 };
+    char num[12];
+    for (uint32_t i = 0; i < sizeof(req_us) / sizeof(req_us[0]); i++) {
+        struct timespec ts = { 0, req_us[i] * 1000 };
+        uint64_t t0 = vdso_gettime_ns();
+        user_syscall(SYS_NANOSLEEP, (uint32_t)&ts, 0, 0, 0);
+        uint64_t slept = vdso_gettime_ns() - t0;
+
+        user_puts("[hrtimer] nanosleep ");
+        user_puts(user_utoa(req_us[i], num + 11));
+        user_puts(" us -> ");
+        user_puts(user_utoa((uint32_t)div_u64(slept, 1000), num + 11));
+        user_puts(" us\n");
+    }
+}
+
+#define FPU_DEMO_ROUNDS 8
+
+/*
+ * 用户态 SSE 演示：xmm0 作为累加器，每轮加一次 {1, 2, 3, 4} 后主动让出 CPU。
+ * 切换只保存通用寄存器时，xmm0 会被下一个用 SSE 的任务改掉；惰性 FPU 切换保证
+ * 它在 #NM 中被恢复。最后水平求和，期望 8 * (1 + 2 + 3 + 4) = 80。
+ * (内核不带 -msse 编译，xmm 寄存器不能写进 clobber 列表，编译器也不会使用它们)
+ */
+static void user_fpu_demo(void) {
+    static const float step[4] __attribute__((aligned(16))) = { 1.0f, 2.0f, 3.0f, 4.0f };
+    char num[12];
+    int32_t sum;
+
+    asm volatile("xorps %%xmm0, %%xmm0" : : );
+    for (int i = 0; i < FPU_DEMO_ROUNDS; i++) {
+        asm volatile("addps %0, %%xmm0" : : "m"(step));
+        user_syscall(SYS_YIELD, 0, 0, 0, 0);
+    }
+    asm volatile(
+        "movaps %%xmm0, %%xmm1\n"
+        "movhlps %%xmm0, %%xmm1\n"      /* xmm1 = {c, d, ...} */
+        "addps %%xmm1, %%xmm0\n"        /* xmm0 = {a+c, b+d, ...} */
+        "movaps %%xmm0, %%xmm1\n"
+        "shufps $0x55, %%xmm1, %%xmm1\n" /* xmm1 = {b+d, ...} */
+        "addss %%xmm1, %%xmm0\n"
+        "cvttss2si %%xmm0, %0\n"
+        : "=r"(sum));
+
+    user_puts("[fpu] SSE accumulator across ");
+    user_puts(user_utoa(FPU_DEMO_ROUNDS, num + 11));
+    user_puts(" yields: ");
+    user_puts(user_utoa((uint32_t)sum, num + 11));
+    user_puts(sum == 80 ? " (ok)\n" : " (CORRUPTED, expected 80)\n");
+}
+
 /**
  * @brief 用户态任务 (Ring 3)
  * 
@@ -174,17 +476,34 @@ void task_b(void) {
  */
 void user_task(void) {
     char* msg = " [Syscall from Ring 3!] ";
+
+    /* 比较 int 0x80 与 SYSENTER 两条系统调用路径的开销 */
+    user_sysbench();
+
+    /* 批量系统调用：共享内存的提交/完成队列 */
+    user_uring_demo();
+
+    /* 不陷入内核读取时间 */
+    user_vdso_demo();
+
+    /* 亚毫秒休眠：高精度定时器在到期时刻唤醒 */
+    user_nanosleep_demo();
+
+    /* 用户态 SSE：XMM 寄存器在多次任务切换之后保持不变 */
+    user_fpu_demo();
     
     /* 发起系统调用测试：打印字符串
-     * EAX = 1 (系统调用号: sys_print)
+     * EAX = 1 (系统调用号: SYS_WRITE)
      * EBX = 字符串地址
+     * ECX = 字节数 (内核不会在用户内存上找字符串结尾)
      * int 0x80 = 触发软中断，陷入内核
      */
     asm volatile (
         "mov $1, %%eax\n"
         "mov %0, %%ebx\n"
+        "mov %1, %%ecx\n"
         "int $0x80\n"
-        : : "r"(msg) : "eax", "ebx"
+        : : "r"(msg), "r"(24) : "eax", "ebx", "ecx"
     );
 
     while(1) {
@@ -203,10 +522,11 @@ void user_task(void) {
         asm volatile (
             "mov $1, %%eax\n"      // 将立即数 1 写入寄存器 EAX，表示要调用的系统调用号为 1
             "mov %0, %%ebx\n"      // 将下面输入约束 %0 对应的地址写入 EBX，作为系统调用的第一个参数
+            "mov $1, %%ecx\n"      // 第二个参数：要写出的字节数
             "int $0x80\n"          // 触发软中断 0x80，CPU 从用户态陷入内核态，进入系统调用处理例程
             :                      // 输出操作数列表为空：这段内联汇编不直接向 C 代码返回值
             : "r"(".")             // 输入操作数：将字符串常量 "." 的地址放入某个通用寄存器，作为占位符 %0
-            : "eax", "ebx"         // 告诉编译器本段汇编会修改 EAX、EBX 寄存器，避免错误优化
+            : "eax", "ebx", "ecx"  // 告诉编译器本段汇编会修改 EAX、EBX、ECX 寄存器 (EAX 还会带回返回值)，避免错误优化
         );
     }
 }
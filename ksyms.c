@@ -0,0 +1,47 @@
+#include "ksyms.h"
+#include <stddef.h>
+
+// 本文件负责：按地址二分查找内嵌符号表 (格式见 ksyms.h)
+
+struct ksym {
+    uint32_t addr;
+    const char* name;
+};
+
+extern const uint8_t __start_ksyms[];   /* 来自链接脚本 */
+extern const uint8_t __stop_ksyms[];
+
+static const struct ksym* ksyms_table(void) {
+    return (const struct ksym*)(__start_ksyms + 4);
+}
+
+uint32_t ksyms_count(void) {
+    if (__stop_ksyms - __start_ksyms < 4) return 0;   /* 第一遍链接：符号表为空 */
+    return *(const uint32_t*)__start_ksyms;
+}
+
+uint32_t ksyms_addr(uint32_t i) {
+    return ksyms_table()[i].addr;
+}
+
+const char* ksyms_name(uint32_t i) {
+    return ksyms_table()[i].name;
+}
+
+int ksyms_lookup(uint32_t addr, uint32_t* offset) {
+    uint32_t n = ksyms_count();
+    const struct ksym* t = ksyms_table();
+    if (n == 0 || addr < t[0].addr) return -1;
+    /* 符号表本身及其之后 (.bss) 不会是代码地址 */
+    if (addr >= (uint32_t)__start_ksyms) return -1;
+
+    /* 找最后一个 addr <= 目标地址的符号 */
+    uint32_t lo = 0, hi = n;
+    while (hi - lo > 1) {
+        uint32_t mid = (lo + hi) / 2;
+        if (t[mid].addr <= addr) lo = mid;
+        else hi = mid;
+    }
+    if (offset) *offset = addr - t[lo].addr;
+    return (int)lo;
+}
@@ -0,0 +1,30 @@
+/**
+ * ksyms.h - 内嵌的内核符号表 (代码地址 → 函数名)
+ *
+ * 构建时 (build.sh) 先链接一遍 kernel.elf，用 nm -n 取出所有代码符号 (t/T)，
+ * 生成 ksyms.asm 并汇编进 .ksyms 段，再链接第二遍。.ksyms 在链接脚本中位于 .text/.data 之后，
+ * 加入符号表不会改变任何代码的地址，所以第一遍得到的地址在最终镜像中仍然有效。
+ *
+ * 段内布局：
+ *   uint32_t count;
+ *   struct ksym { uint32_t addr; const char* name; } syms[count];   // 按地址升序
+ *   字符串...
+ *
+ * @see [prof.md](doc/prof.md)
+ */
+#ifndef KSYMS_H
+#define KSYMS_H
+
+#include <stdint.h>
+
+/* 符号个数 (没有嵌入符号表时为 0) */
+uint32_t ksyms_count(void);
+
+/* 第 i 个符号的起始地址与名字 */
+uint32_t ksyms_addr(uint32_t i);
+const char* ksyms_name(uint32_t i);
+
+/* addr 所在的函数：返回符号下标，*offset 为函数内偏移；不在任何函数内返回 -1 */
+int ksyms_lookup(uint32_t addr, uint32_t* offset);
+
+#endif
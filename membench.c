@@ -0,0 +1,97 @@
+#include "membench.h"
+#include "string.h"
+#include "terminal.h"
+#include "printk.h"
+#include "clocksource.h"
+#include "pmm.h"
+#include "vmm.h"
+#include "cpu.h"
+#include "cpufeature.h"
+#include <stddef.h>
+
+#define MEMBENCH_BUF        (1024 * 1024)
+#define MEMBENCH_TOTAL      (4 * 1024 * 1024)   /* 每轮拷贝的总字节数 (小块多调用几次) */
+#define MEMBENCH_ROUNDS     5
+#define MEMBENCH_VARIANTS   6
+
+typedef void* (*memcpy_fn_t)(void* dst, const void* src, size_t n);
+
+static const uint32_t membench_sizes[] = { 8, 64, 512, 4096, 65536, MEMBENCH_BUF };
+
+static const char* const membench_names[MEMBENCH_VARIANTS] = {
+    "words", "movsd", "movsb", "sse2", "nt", "memcpy"
+};
+
+// 每次调用的周期数：每轮连续调用 total / size 次，取最快的一轮
+static uint32_t membench_one(memcpy_fn_t fn, uint8_t* dst, const uint8_t* src, uint32_t size) {
+    uint32_t calls = MEMBENCH_TOTAL / size;
+    uint64_t best = ~0ull;
+    for (int r = 0; r < MEMBENCH_ROUNDS; r++) {
+        uint64_t t0 = rdtsc();
+        for (uint32_t i = 0; i < calls; i++) fn(dst, src, size);
+        uint64_t t = rdtsc() - t0;
+        if (t < best) best = t;
+    }
+    return (uint32_t)div_u64(best, calls);
+}
+
+void membench_run(void) {
+    uint32_t khz = clocksource_tsc_khz();
+    if (khz == 0) {
+        terminal_writestring("membench: no usable TSC\n");
+        return;
+    }
+    uint32_t pages = 2 * MEMBENCH_BUF / PAGE_SIZE;
+    uint32_t phys = pmm_alloc_contiguous(pages);
+    if (!phys) {
+        terminal_writestring("membench: cannot allocate 2MB\n");
+        return;
+    }
+    if (vmm_identity_map(phys, 2 * MEMBENCH_BUF, PAGE_RW) != 0) {
+        vmm_identity_unmap(phys, 2 * MEMBENCH_BUF);     /* 可能已经映射了一部分 */
+        for (uint32_t i = 0; i < pages; i++) pmm_free_page(phys + i * PAGE_SIZE);
+        terminal_writestring("membench: cannot map buffers\n");
+        return;
+    }
+    uint8_t* src = (uint8_t*)phys;
+    uint8_t* dst = src + MEMBENCH_BUF;
+    memset(src, 0x5A, MEMBENCH_BUF);
+    memset(dst, 0, MEMBENCH_BUF);
+
+    int sse2 = cpu_has(X86_FEATURE_SSE2);
+    memcpy_fn_t fns[MEMBENCH_VARIANTS] = {
+        memcpy_words, memcpy_movsd, memcpy_movsb,
+        sse2 ? memcpy_sse2 : NULL, sse2 ? memcpy_nt : NULL, memcpy
+    };
+
+    char line[96];
+    int n = snprintk(line, sizeof(line), "%8s", "bytes");
+    for (int v = 0; v < MEMBENCH_VARIANTS; v++) {
+        n += snprintk(line + n, sizeof(line) - n, "%9s", membench_names[v]);
+    }
+    snprintk(line + n, sizeof(line) - n, "%10s\n", "MB/s");
+    terminal_writestring(line);
+
+    for (uint32_t s = 0; s < sizeof(membench_sizes) / sizeof(membench_sizes[0]); s++) {
+        uint32_t size = membench_sizes[s];
+        uint32_t cycles = 0;
+        n = snprintk(line, sizeof(line), "%8u", size);
+        for (int v = 0; v < MEMBENCH_VARIANTS; v++) {
+            if (!fns[v]) {
+                n += snprintk(line + n, sizeof(line) - n, "%9s", "-");
+                continue;
+            }
+            cycles = membench_one(fns[v], dst, src, size);
+            n += snprintk(line + n, sizeof(line) - n, "%9u", cycles);
+        }
+        /* memcpy 的带宽：size 字节 / (cycles / (khz * 1000)) 秒 = size * khz / cycles / 1000 MB/s */
+        uint32_t mbs = cycles ? (uint32_t)div_u64(div_u64((uint64_t)size * khz, cycles), 1000) : 0;
+        snprintk(line + n, sizeof(line) - n, "%10u\n", mbs);
+        terminal_writestring(line);
+    }
+    terminal_writestring("(cycles per call; the memcpy column dispatches by size)\n");
+
+    /* 先撤销映射再还给 PMM，否则这些页在下一个使用者重新映射之前一直可以读写 */
+    vmm_identity_unmap(phys, 2 * MEMBENCH_BUF);
+    for (uint32_t i = 0; i < pages; i++) pmm_free_page(phys + i * PAGE_SIZE);
+}
@@ -0,0 +1,17 @@
+/**
+ * membench.h - memcpy 各实现的微基准 (shell 命令 membench)
+ *
+ * 对 8B、64B、512B、4KB、64KB、1MB 六种长度，分别直接调用 string.c 中的每种实现
+ * (逐字、rep movsd、rep movsb、SSE2、SSE2 非临时写) 和按长度分档的 memcpy，
+ * 用 RDTSC 测量每次调用的周期数 (多轮取最小值)，最后一列是 memcpy 的带宽。
+ * 源和目标各 1MB，从物理页分配器取连续页 (内核堆只有 1MB)，测完释放。
+ *
+ * @see [memcpy.md](doc/memcpy.md)
+ */
+#ifndef MEMBENCH_H
+#define MEMBENCH_H
+
+/* 运行测试并打印结果 (需要 TSC) */
+void membench_run(void);
+
+#endif
@@ -1,5 +1,7 @@
 #include "pmm.h"
-#include "terminal.h"
+#include "printk.h"
+#include "spinlock.h"
+#include "trace.h"
 
 extern uint32_t _kernel_start; /* 来自链接脚本 */
 extern uint32_t _kernel_end;   /* 来自链接脚本 */
@@ -7,6 +9,7 @@ extern uint32_t _kernel_end;   /* 来自链接脚本 */
 static uint32_t total_pages;
 static uint32_t free_pages;
 static uint8_t bitmap[(PMM_TOTAL_MEM_BYTES / PMM_PAGE_SIZE + 7) / 8];
+static spinlock_t pmm_lock = SPINLOCK_INIT("pmm");   /* SMP：保护位图与 free_pages */
 
 static inline void bm_set(uint32_t pfn) { bitmap[pfn >> 3] |= (uint8_t)(1u << (pfn & 7)); }
 static inline void bm_clear(uint32_t pfn) { bitmap[pfn >> 3] &= (uint8_t)~(1u << (pfn & 7)); }
@@ -40,26 +43,24 @@ void pmm_init(void) {
     reserve_range(kstart, kend);
 
     /* 统计输出 */
-    terminal_writestring("PMM initialized\n");
-    terminal_writestring("Total pages: ");
-    /* 简易十进制输出 */
-    uint32_t t = total_pages; char buf[12]; int i = 0; do { buf[i++] = '0' + (t % 10); t /= 10; } while (t); while (i--) terminal_putchar(buf[i]);
-    terminal_writestring("\nFree pages: ");
-    t = free_pages; i = 0; do { buf[i++] = '0' + (t % 10); t /= 10; } while (t); while (i--) terminal_putchar(buf[i]);
-    terminal_putchar('\n');
+    printk(KERN_INFO, "PMM initialized: %u pages total, %u free\n", total_pages, free_pages);
 }
 
 uint32_t pmm_total_pages(void) { return total_pages; }
 uint32_t pmm_free_pages(void) { return free_pages; }
 
 uint32_t pmm_alloc_page(void) {
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
     for (uint32_t p = 0; p < total_pages; ++p) {
         if (bm_test(p)) {
             bm_clear(p);
             if (free_pages) free_pages--;
+            spin_unlock_irqrestore(&pmm_lock, flags);
+            TRACE_POINT(TRACE_PAGE_ALLOC, __builtin_return_address(0), p * PMM_PAGE_SIZE);
             return p * PMM_PAGE_SIZE;
         }
     }
+    spin_unlock_irqrestore(&pmm_lock, flags);
     return 0;
 }
 
@@ -67,11 +68,14 @@ void pmm_free_page(uint32_t phys_addr) {
     if (phys_addr % PMM_PAGE_SIZE) return; /* 非对齐忽略 */
     uint32_t p = phys_addr / PMM_PAGE_SIZE;
     if (p >= total_pages) return;
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
     if (!bm_test(p)) { bm_set(p); free_pages++; }
+    spin_unlock_irqrestore(&pmm_lock, flags);
 }
 
 uint32_t pmm_alloc_contiguous(uint32_t n_pages) {
     if (n_pages == 0) return 0;
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
     uint32_t run = 0, start = 0;
     for (uint32_t p = 0; p < total_pages; ++p) {
         if (bm_test(p)) {
@@ -80,12 +84,14 @@ uint32_t pmm_alloc_contiguous(uint32_t n_pages) {
             if (run == n_pages) {
                 for (uint32_t q = start; q < start + n_pages; ++q) { bm_clear(q); }
                 if (free_pages >= n_pages) free_pages -= n_pages;
+                spin_unlock_irqrestore(&pmm_lock, flags);
                 return start * PMM_PAGE_SIZE;
             }
         } else {
             run = 0;
         }
     }
+    spin_unlock_irqrestore(&pmm_lock, flags);
     return 0;
 }
 
@@ -0,0 +1,307 @@
+#include "printk.h"
+#include "clocksource.h"
+#include "workqueue.h"
+#include "terminal.h"
+#include "cpu.h"
+#include "string.h"
+#include "process.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 精简的格式化器 vsnprintk (无 libgcc：64 位除法用 div_u64)
+// - 日志环形缓冲区：printk 写入，控制台与 dmesg 读出
+// - 控制台输出：启动阶段与 KERN_ERR 以上同步，其余由 system_ordered_wq 的 worker 异步完成
+//
+// 写入与 trace.c 相同：lock xadd 领取序号，各写各的槽位，写完把 seq 提交为“序号 + 1”。
+// 读者 (控制台、dmesg) 复制槽位后再检查一次 seq，复制期间被新一轮覆盖的记录会被丢弃。
+// 控制台同一时刻只有一个输出者 (console_busy)，其他 CPU 发现它在忙就直接返回，
+// 由它把新记录一起输出；它释放之后再检查一遍，不会漏掉释放前一刻提交的记录。
+// Shell 执行命令期间持有 console_hold，异步输出暂停，命令结束后补上 (console_lock/unlock)。
+
+#define LOG_MASK  (LOG_RECORDS - 1)
+
+struct log_record {
+    volatile uint32_t seq;      /* 0: 正在写；序号 + 1: 已提交 */
+    uint64_t ts_ns;             /* clock_monotonic_ns */
+    uint16_t level;
+    uint16_t len;
+    char text[LOG_LINE_MAX];    /* 以 0 结尾，不含末尾的 '\n' */
+};
+
+static struct log_record log_ring[LOG_RECORDS];
+static volatile uint32_t log_head = 0;          /* 下一个序号 */
+static volatile uint32_t dmesg_start = 0;       /* dmesg clear 之后从这里开始显示 */
+
+static volatile uint32_t console_seq = 0;       /* 控制台下一条要输出的序号 */
+static volatile uint32_t console_busy = 0;
+static volatile uint32_t console_async = 0;
+static volatile uint32_t console_wakeup = 0;    /* 有新记录等待异步输出 */
+static volatile uint32_t console_hold = 0;      /* Shell 命令执行中：异步输出暂停 */
+static uint32_t console_dropped = 0;            /* 控制台落后太多被覆盖的记录数 */
+volatile uint32_t console_loglevel = KERN_DEBUG;
+
+/* ---------------------------------------------------------------------------
+ * 格式化
+ * ------------------------------------------------------------------------- */
+
+struct fmt_out {
+    char* buf;
+    uint32_t size;      /* 含结尾 0 */
+    uint32_t pos;
+};
+
+static inline void fmt_putc(struct fmt_out* o, char c) {
+    if (o->pos + 1 < o->size) o->buf[o->pos] = c;
+    o->pos++;
+}
+
+static void fmt_pad(struct fmt_out* o, char c, int n) {
+    while (n-- > 0) fmt_putc(o, c);
+}
+
+static void fmt_str(struct fmt_out* o, const char* s, int width, int left) {
+    int n = 0;
+    if (!s) s = "(null)";
+    while (s[n]) n++;
+    if (!left) fmt_pad(o, ' ', width - n);
+    for (int i = 0; i < n; i++) fmt_putc(o, s[i]);
+    if (left) fmt_pad(o, ' ', width - n);
+}
+
+static void fmt_num(struct fmt_out* o, uint64_t v, uint32_t base, int upper, int neg,
+                    int width, int zero, int left) {
+    const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[20];
+    int n = 0;
+    do {
+        if (base == 16) {
+            tmp[n++] = digits[v & 0xF];
+            v >>= 4;
+        } else if (v >> 32) {
+            uint64_t q = div_u64(v, 10);
+            tmp[n++] = digits[(uint32_t)(v - q * 10)];
+            v = q;
+        } else {
+            uint32_t w = (uint32_t)v;
+            tmp[n++] = digits[w % 10];
+            v = w / 10;
+        }
+    } while (v);
+
+    int len = n + neg;
+    if (left) zero = 0;
+    if (neg && zero) fmt_putc(o, '-');
+    if (!left) fmt_pad(o, zero ? '0' : ' ', width - len);
+    if (neg && !zero) fmt_putc(o, '-');
+    while (n) fmt_putc(o, tmp[--n]);
+    if (left) fmt_pad(o, ' ', width - len);
+}
+
+int vsnprintk(char* buf, uint32_t size, const char* fmt, __builtin_va_list ap) {
+    struct fmt_out o = { buf, size, 0 };
+    for (; *fmt; fmt++) {
+        if (*fmt != '%') {
+            fmt_putc(&o, *fmt);
+            continue;
+        }
+        fmt++;
+        int left = 0, zero = 0, width = 0, is64 = 0;
+        for (;; fmt++) {
+            if (*fmt == '-') left = 1;
+            else if (*fmt == '0') zero = 1;
+            else break;
+        }
+        while (*fmt >= '0' && *fmt <= '9') width = width * 10 + (*fmt++ - '0');
+        if (*fmt == 'l') {
+            fmt++;
+            if (*fmt == 'l') { is64 = 1; fmt++; }
+        }
+
+        switch (*fmt) {
+        case 'd': {
+            int64_t v = is64 ? __builtin_va_arg(ap, int64_t) : __builtin_va_arg(ap, int32_t);
+            fmt_num(&o, v < 0 ? (uint64_t)-v : (uint64_t)v, 10, 0, v < 0, width, zero, left);
+            break;
+        }
+        case 'u':
+            fmt_num(&o, is64 ? __builtin_va_arg(ap, uint64_t) : __builtin_va_arg(ap, uint32_t),
+                    10, 0, 0, width, zero, left);
+            break;
+        case 'x':
+        case 'X':
+            fmt_num(&o, is64 ? __builtin_va_arg(ap, uint64_t) : __builtin_va_arg(ap, uint32_t),
+                    16, *fmt == 'X', 0, width, zero, left);
+            break;
+        case 'p':
+            /* 与 terminal_writehex 相同的形式：0x + 8 位大写十六进制 */
+            fmt_putc(&o, '0');
+            fmt_putc(&o, 'x');
+            fmt_num(&o, (uint32_t)__builtin_va_arg(ap, void*), 16, 1, 0, 8, 1, 0);
+            break;
+        case 's':
+            fmt_str(&o, __builtin_va_arg(ap, const char*), width, left);
+            break;
+        case 'c':
+            fmt_putc(&o, (char)__builtin_va_arg(ap, int));
+            break;
+        case '%':
+            fmt_putc(&o, '%');
+            break;
+        case 0:
+            fmt--;      /* 格式串以孤立的 '%' 结尾 */
+            break;
+        default:
+            fmt_putc(&o, '%');
+            fmt_putc(&o, *fmt);
+            break;
+        }
+    }
+    if (size) buf[o.pos < size ? o.pos : size - 1] = 0;
+    return (int)(o.pos < size ? o.pos : (size ? size - 1 : 0));
+}
+
+int snprintk(char* buf, uint32_t size, const char* fmt, ...) {
+    __builtin_va_list ap;
+    __builtin_va_start(ap, fmt);
+    int n = vsnprintk(buf, size, fmt, ap);
+    __builtin_va_end(ap);
+    return n;
+}
+
+/* ---------------------------------------------------------------------------
+ * 日志缓冲区
+ * ------------------------------------------------------------------------- */
+
+// 复制一条已提交的记录。返回 0 表示还在写、或复制期间被覆盖
+static int log_read(uint32_t seq, struct log_record* out) {
+    const struct log_record* r = &log_ring[seq & LOG_MASK];
+    if (r->seq != seq + 1) return 0;
+    asm volatile("" : : : "memory");
+    out->ts_ns = r->ts_ns;
+    out->level = r->level;
+    out->len = r->len < LOG_LINE_MAX ? r->len : LOG_LINE_MAX - 1;
+    memcpy(out->text, r->text, out->len);
+    out->text[out->len] = 0;
+    asm volatile("" : : : "memory");
+    return r->seq == seq + 1;
+}
+
+// 输出一行 "[    秒.微秒] 正文"，整行一次 terminal_write，不会与其他 CPU 的输出交错
+static void log_print(const struct log_record* rec) {
+    char line[LOG_LINE_MAX + 20];
+    uint64_t us = div_u64(rec->ts_ns, 1000);
+    uint32_t sec = (uint32_t)div_u64(us, 1000000);
+    uint32_t frac = (uint32_t)(us - (uint64_t)sec * 1000000);
+    int n = snprintk(line, sizeof(line) - 1, "[%5u.%06u] %s", sec, frac, rec->text);
+    line[n++] = '\n';
+    terminal_write(line, n);
+}
+
+int printk(int level, const char* fmt, ...) {
+    if (level < KERN_EMERG) level = KERN_EMERG;
+    if (level > KERN_DEBUG) level = KERN_DEBUG;
+
+    uint32_t seq = __sync_fetch_and_add(&log_head, 1);
+    struct log_record* r = &log_ring[seq & LOG_MASK];
+
+    r->seq = 0;
+    asm volatile("" : : : "memory");
+    r->ts_ns = clock_monotonic_ns();
+    r->level = (uint16_t)level;
+
+    __builtin_va_list ap;
+    __builtin_va_start(ap, fmt);
+    int n = vsnprintk(r->text, LOG_LINE_MAX, fmt, ap);
+    __builtin_va_end(ap);
+    if (n && r->text[n - 1] == '\n') r->text[--n] = 0;
+    r->len = (uint16_t)n;
+
+    asm volatile("" : : : "memory");
+    r->seq = seq + 1;
+
+    /* 出错信息和启动日志立即输出；其余只做标记，由时钟中断提交 work */
+    if (!console_async || level <= KERN_ERR) console_flush();
+    else console_wakeup = 1;
+    return n;
+}
+
+// async: 来自 worker 的异步输出，console_hold 期间不输出 (同步输出不受影响)
+static void __console_flush(int async) {
+    do {
+        if (__sync_lock_test_and_set(&console_busy, 1)) return;
+        /* 先拿到 console_busy 再检查：console_lock 设置 hold 后会等 busy 释放，两者不会同时输出 */
+        if (async && console_hold) {
+            __sync_lock_release(&console_busy);
+            return;
+        }
+        while (console_seq != log_head) {
+            uint32_t head = log_head;
+            if (head - console_seq > LOG_RECORDS) {
+                console_dropped += head - LOG_RECORDS - console_seq;
+                console_seq = head - LOG_RECORDS;
+            }
+            struct log_record rec;
+            if (!log_read(console_seq, &rec)) {
+                /* 被覆盖：下一轮按落后太多处理；还在写：写者提交后会再调用 */
+                if (log_head - console_seq > LOG_RECORDS) continue;
+                break;
+            }
+            console_seq++;
+            if (console_dropped) {
+                char line[48];
+                int n = snprintk(line, sizeof(line), "printk: %u messages dropped\n", console_dropped);
+                terminal_write(line, n);
+                console_dropped = 0;
+            }
+            if (rec.level < console_loglevel) log_print(&rec);
+        }
+        __sync_lock_release(&console_busy);
+        /* 持有 console_busy 期间提交的记录，它们的写者看到忙就返回了 */
+    } while (console_seq != log_head && log_ring[console_seq & LOG_MASK].seq == console_seq + 1);
+}
+
+void console_flush(void) {
+    __console_flush(0);
+}
+
+void console_lock(void) {
+    /* xchg 是完整的内存屏障：之后读到的 console_busy 不会早于 hold 的写入 */
+    __sync_lock_test_and_set(&console_hold, 1);
+    while (console_busy) process_yield();
+}
+
+void console_unlock(void) {
+    __sync_lock_release(&console_hold);
+    console_flush();
+}
+
+static void console_work_fn(work_t* work) {
+    (void)work;
+    __console_flush(1);
+}
+
+static work_t console_work = { console_work_fn, NULL, NULL, 0 };
+
+void console_async_start(void) {
+    console_async = 1;
+}
+
+void printk_tick(void) {
+    if (!console_wakeup || !system_ordered_wq) return;
+    console_wakeup = 0;
+    queue_work(system_ordered_wq, &console_work);
+}
+
+void dmesg_dump(void) {
+    uint32_t head = log_head;
+    uint32_t seq = dmesg_start;
+    if (head - seq > LOG_RECORDS) seq = head - LOG_RECORDS;
+    for (; seq != head; seq++) {
+        struct log_record rec;
+        if (log_read(seq, &rec)) log_print(&rec);
+    }
+}
+
+void dmesg_clear(void) {
+    dmesg_start = log_head;
+}
@@ -0,0 +1,72 @@
+/**
+ * printk.h - 格式化内核日志与日志缓冲区 (dmesg)
+ *
+ * 以前所有输出都是 terminal_writestring() 直接写 VGA：
+ * - 数字要手工拼 (pmm_init、状态栏各写了一遍十进制转换)；
+ * - 每行日志都要在调用者的上下文里逐字符写显存、持 terminal_lock 滚屏，
+ *   在中断或关中断区间里打印一行就是几十微秒；
+ * - 滚出屏幕的内容就再也看不到了。
+ *
+ * printk(level, fmt, ...) 用与 trace.c 相同的“原子领取序号 + 提交序号”在无锁的日志环形缓冲区里
+ * 领一个槽位，vsnprintk 直接格式化进槽位的 text (不经过栈上的中间缓冲区)，再提交序号；
+ * 不持锁、不写显存，可以在任何上下文调用。
+ * 控制台输出由 system_ordered_wq 的 worker 在线程上下文中异步完成；Shell 执行命令期间
+ * 持有 console_lock，异步输出暂停到命令结束，日志行不会插进一条命令的输出中间。
+ * Shell 的 dmesg 命令重放整个缓冲区。
+ *
+ * 例外：启动阶段 (console_async_start 之前) 和 KERN_ERR 及更严重的级别同步输出，
+ * 保证死机前的最后几行一定在屏幕上 (即使 Shell 持有 console_lock)。
+ *
+ * 一次 printk 是一条记录；末尾的 '\n' 可有可无，控制台输出时每条记录占一行。
+ *
+ * @see [printk.md](doc/printk.md)
+ */
+#ifndef PRINTK_H
+#define PRINTK_H
+
+#include <stdint.h>
+
+#define KERN_EMERG      0   /* 系统不可用 */
+#define KERN_ALERT      1
+#define KERN_CRIT       2
+#define KERN_ERR        3   /* 出错：同步输出 */
+#define KERN_WARNING    4
+#define KERN_NOTICE     5
+#define KERN_INFO       6   /* 启动信息等 */
+#define KERN_DEBUG      7   /* 默认只进缓冲区，不上控制台 */
+
+#define LOG_RECORDS     256     /* 日志缓冲区记录数 (2 的幂)，写满覆盖最旧的 */
+#define LOG_LINE_MAX    120     /* 每条记录的最大长度，超出截断 */
+
+/* 级别数值小于它的记录才输出到控制台 (dmesg 总是显示全部) */
+extern volatile uint32_t console_loglevel;
+
+/*
+ * 格式化输出，支持 %d %u %x %X %p %s %c %%，可带宽度与 '0'/'-' 标志，
+ * 'l' 忽略 (32 位)，"ll" 表示 64 位参数 (%llu %lld %llx)。
+ * 不做 printf 格式检查：交叉编译器下 uint32_t 是 unsigned long，按标准检查会满屏警告。
+ */
+int printk(int level, const char* fmt, ...);
+
+/* 格式化到 buf (总是以 0 结尾)，返回写入的字符数 (不含结尾 0) */
+int vsnprintk(char* buf, uint32_t size, const char* fmt, __builtin_va_list ap);
+int snprintk(char* buf, uint32_t size, const char* fmt, ...);
+
+/* 启动完成、即将开中断时调用：之后的普通日志改为异步输出 */
+void console_async_start(void);
+
+/* 由时钟中断调用：有新日志时把控制台输出的 work 提交给 system_ordered_wq */
+void printk_tick(void);
+
+/* 把尚未输出的日志全部写到控制台 (已有其他 CPU 在输出时立即返回，由它负责) */
+void console_flush(void);
+
+/* Shell 执行一条命令期间持有：暂停异步日志输出，解锁时补上暂停期间的日志 (线程上下文调用) */
+void console_lock(void);
+void console_unlock(void);
+
+/* Shell 命令 dmesg：重放缓冲区中的全部记录；dmesg clear 清空 */
+void dmesg_dump(void);
+void dmesg_clear(void);
+
+#endif
@@ -1,14 +1,162 @@
 #include "process.h"
 #include "heap.h"
-#include "terminal.h"
+#include "printk.h"
 #include <stddef.h>
 #include "gdt.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "syscall.h"
+#include "clocksource.h"
+#include "fpu.h"
+#include "trace.h"
+#include "apic.h"
+
+// SMP 调度概览：
+// - 全局进程链表 (process_list) 只用于遍历 (统计)，由 proc_list_lock 保护；
+// - 每个 CPU 有自己的运行队列 (cpu_t.rq_*)，schedule() 只锁本 CPU 的队列，
+//   不同 CPU 的调度互不干扰；
+// - 本地队列为空时，空闲的 CPU 从最忙的 CPU 偷一个任务 (work stealing)；
+// - 每 SCHED_BALANCE_TICKS 个 tick 做一次周期性负载均衡，把最忙 CPU 的一半差额拉过来。
+//
+// 锁顺序：proc_list_lock -> rq_lock。需要同时持有两个 CPU 的 rq_lock 时，
+// 第二把一律用 spin_trylock，失败就放弃本次偷取/均衡，因此不会死锁。
+//
+// on_cpu：schedule() 返回新栈指针后，中断桩还要在旧栈上执行几条指令才真正切走。
+// 这段时间里旧任务虽然已经回到运行队列，却不能被其他 CPU 拿去运行，
+// 否则两个 CPU 会同时使用同一个内核栈。finish_task_switch() 在切换完成后清除它。
 
 /* 全局进程链表 */
 static process_t* process_list = NULL;
-static process_t* current_process = NULL;
+static spinlock_t proc_list_lock = SPINLOCK_INIT("proc_list");
 static uint32_t next_pid = 1;
 
+/* === 运行队列操作：调用者持有 c->rq_lock === */
+static void rq_enqueue(cpu_t* c, process_t* p) {
+    p->rq_next = NULL;
+    p->on_rq = 1;
+    if (c->rq_tail) c->rq_tail->rq_next = p;
+    else c->rq_head = p;
+    c->rq_tail = p;
+    c->nr_running++;
+}
+
+static void rq_enqueue_head(cpu_t* c, process_t* p) {
+    p->rq_next = c->rq_head;
+    p->on_rq = 1;
+    c->rq_head = p;
+    if (!c->rq_tail) c->rq_tail = p;
+    c->nr_running++;
+}
+
+static process_t* rq_dequeue(cpu_t* c) {
+    process_t* p = c->rq_head;
+    if (p) {
+        c->rq_head = p->rq_next;
+        if (!c->rq_head) c->rq_tail = NULL;
+        p->rq_next = NULL;
+        p->on_rq = 0;
+        c->nr_running--;
+    }
+    return p;
+}
+
+// 摘下第一个可以迁移的任务 (没有任何 CPU 正在使用它的栈)
+static process_t* rq_detach_movable(cpu_t* c) {
+    process_t* prev = NULL;
+    for (process_t* p = c->rq_head; p; prev = p, p = p->rq_next) {
+        if (p->on_cpu) continue;
+        if (prev) prev->rq_next = p->rq_next;
+        else c->rq_head = p->rq_next;
+        if (c->rq_tail == p) c->rq_tail = prev;
+        p->rq_next = NULL;
+        p->on_rq = 0;
+        c->nr_running--;
+        return p;
+    }
+    return NULL;
+}
+
+// 运行队列长度超过 min 的最忙 CPU
+static cpu_t* find_busiest(cpu_t* self, uint32_t min) {
+    cpu_t* busiest = NULL;
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        cpu_t* c = smp_cpu(i);
+        if (c == self || !c->online) continue;
+        if (c->nr_running > min && (!busiest || c->nr_running > busiest->nr_running)) {
+            busiest = c;
+        }
+    }
+    return busiest;
+}
+
+// 新进程放到运行队列最短的 CPU 上
+static void sched_enqueue_new(process_t* p) {
+    cpu_t* target = this_cpu();
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        cpu_t* c = smp_cpu(i);
+        if (c->online && c->nr_running < target->nr_running) target = c;
+    }
+    uint32_t flags = spin_lock_irqsave(&target->rq_lock);
+    p->cpu = target->id;
+    rq_enqueue(target, p);
+    spin_unlock_irqrestore(&target->rq_lock, flags);
+}
+
+// 把处于 from_state 的进程设为 READY。
+// 进程可能在等待期间被迁移，所以锁住 p->cpu 的队列后要再确认一次。
+// 如果它仍是某个 CPU 的 current (还没来得及切走)，只改状态，
+// 由那个 CPU 的 schedule() 把它放回队列。
+// preempt：放到运行队列队首，目标是本 CPU 时中断返回就切换过去，
+// 是其他 CPU 时发重新调度 IPI，让它在 IPI 返回时切换。
+// 高精度定时器唤醒的休眠进程用它，否则要等到下一个 tick 才轮到，
+// 亚毫秒的休眠精度就没有意义了。
+static void wake_up_process(process_t* p, uint32_t from_state, int preempt) {
+    cpu_t* c;
+    uint32_t flags;
+    int kick = 0;
+    while (1) {
+        c = smp_cpu(p->cpu);
+        flags = spin_lock_irqsave(&c->rq_lock);
+        if (c->id == p->cpu) break;
+        spin_unlock_irqrestore(&c->rq_lock, flags);
+    }
+    if (p->state == from_state) {
+        p->state = STATE_READY;
+        if (c->current != p && !p->on_rq) {
+            if (preempt) {
+                rq_enqueue_head(c, p);
+                c->need_resched = 1;
+                kick = (c != this_cpu());
+            } else {
+                rq_enqueue(c, p);
+            }
+        }
+    }
+    spin_unlock_irqrestore(&c->rq_lock, flags);
+
+    /* 定时器到期在 BSP 上处理 (PIT 路由到 BSP)，休眠者可能在 AP 上 */
+    if (kick && apic_enabled()) apic_send_ipi(c->apic_id, APIC_ICR_FIXED | APIC_RESCHED_VECTOR);
+}
+
+// 重新调度 IPI：need_resched 已由发送方设置，irq_handler 返回前会调用 schedule()
+static int resched_ipi_handler(struct registers* regs, void* ctx) {
+    (void)regs; (void)ctx;
+    return IRQ_HANDLED;
+}
+
+// 休眠定时器到期 (硬中断上下文)
+static void process_sleep_timeout(struct hrtimer* timer) {
+    wake_up_process((process_t*)timer->data, STATE_SLEEPING, 1);
+}
+
+static void process_list_add(process_t* proc) {
+    uint32_t flags = spin_lock_irqsave(&proc_list_lock);
+    proc->pid = next_pid++;
+    proc->next = process_list->next;
+    process_list->next = proc;
+    spin_unlock_irqrestore(&proc_list_lock, flags);
+}
+
 void process_init(void) {
     /* 创建代表当前执行流 (Kernel Main) 的 PCB */
     /* 注意：我们不需要给它分配栈，因为我们已经在它的栈里运行了 */
@@ -25,18 +173,63 @@ void process_init(void) {
     main_proc->next = main_proc; /* 循环链表：自己指向自己 */
     main_proc->kernel_stack_top = 0x90000; // 初始栈
     main_proc->state = STATE_READY;
-    main_proc->sleep_ticks = 0;
+    hrtimer_setup(&main_proc->sleep_timer, process_sleep_timeout, main_proc);
+    main_proc->fpu_state = NULL;
+    main_proc->fpu_cpu = FPU_NO_CPU;
+    main_proc->cpu = 0;
+    main_proc->on_cpu = 1;
+    main_proc->on_rq = 0;
+    main_proc->rq_next = NULL;
     
     process_list = main_proc;
-    current_process = main_proc;
+
+    /* PID 0 即 BSP 的 idle 进程 */
+    cpu_t* c = this_cpu();
+    spin_lock_init(&c->rq_lock, "rq");
+    c->current = main_proc;
+    c->idle = main_proc;
+    c->online = 1;
+
+    irq_register(IRQ_RESCHED, resched_ipi_handler, NULL);
     
-    terminal_writestring("Multitasking initialized. Kernel is PID 0.\n");
+    printk(KERN_INFO, "Multitasking initialized. Kernel is PID 0.\n");
 }
 
-process_t* process_create(void (*entry_point)(void), const char* name) {
+process_t* process_create_idle(const char* name) {
+    process_t* proc = (process_t*)kmalloc(sizeof(process_t));
+    int i = 0;
+    for(; i < PROCESS_NAME_LEN-1 && name[i]; i++) proc->name[i] = name[i];
+    proc->name[i] = 0;
+
+    cpu_t* c = this_cpu();
+    proc->esp = 0;
+    proc->kernel_stack_top = 0;   /* idle 不会进入用户态，不需要 esp0 */
+    proc->state = STATE_READY;
+    hrtimer_setup(&proc->sleep_timer, process_sleep_timeout, proc);
+    proc->fpu_state = NULL;
+    proc->fpu_cpu = FPU_NO_CPU;
+    proc->cpu = c->id;
+    proc->on_cpu = 1;
+    proc->on_rq = 0;
+    proc->rq_next = NULL;
+    spin_lock_init(&c->rq_lock, "rq");   /* 本 CPU 上线 (online=1) 前没有人会访问它 */
+    c->current = proc;
+    c->idle = proc;
+
+    process_list_add(proc);
+    return proc;
+}
+
+/* 内核线程函数返回后会“返回”到这里：没有退出机制，只能永久阻塞 */
+static void kthread_return(void) {
+    local_irq_disable();
+    process_block_current();
+    while (1) process_yield();
+}
+
+process_t* process_create_arg(void (*entry_point)(void*), void* arg, const char* name) {
     /* 1. 分配 PCB */
     process_t* proc = (process_t*)kmalloc(sizeof(process_t));
-    proc->pid = next_pid++;
     
     int i = 0;
     for(; i < PROCESS_NAME_LEN-1 && name[i]; i++) proc->name[i] = name[i];
@@ -69,6 +262,11 @@ process_t* process_create(void (*entry_point)(void), const char* name) {
     
     uint32_t* stack_ptr = (uint32_t*)esp;
     
+    /* cdecl 调用帧：Ring 0 的 IRET 不切换栈，返回后 ESP 正好指向这里，
+       entry_point 会把它看成 [返回地址] [第一个参数] */
+    *(--stack_ptr) = (uint32_t)arg;
+    *(--stack_ptr) = (uint32_t)kthread_return;
+    
     /* IRET Frame */
     *(--stack_ptr) = 0x202;         /* EFLAGS (Interrupts Enabled) */
     *(--stack_ptr) = 0x08;          /* CS (Kernel Code) */
@@ -92,24 +290,31 @@ process_t* process_create(void (*entry_point)(void), const char* name) {
     *(--stack_ptr) = 0x10; /* DS */
     *(--stack_ptr) = 0x10; /* ES */
     *(--stack_ptr) = 0x10; /* FS */
-    *(--stack_ptr) = 0x10; /* GS */
+    *(--stack_ptr) = GDT_PERCPU_SEL; /* GS：内核线程通过它访问每 CPU 数据 */
     
     /* 保存最终的 ESP 到 PCB */
     proc->esp = (uint32_t)stack_ptr;
     proc->kernel_stack_top = esp;
     proc->state = STATE_READY;
-    proc->sleep_ticks = 0;
+    hrtimer_setup(&proc->sleep_timer, process_sleep_timeout, proc);
+    proc->fpu_state = NULL;
+    proc->fpu_cpu = FPU_NO_CPU;
+    proc->on_cpu = 0;
     
-    /* 4. 插入链表 (插入到 head 后面) */
-    proc->next = process_list->next;
-    process_list->next = proc;
+    /* 4. 插入全局链表，并放入最空闲 CPU 的运行队列 */
+    process_list_add(proc);
+    sched_enqueue_new(proc);
     
     return proc;
 }
 
+process_t* process_create(void (*entry_point)(void), const char* name) {
+    /* 无参数线程：多压入的参数会被 entry_point 忽略 (cdecl 由调用者清理参数) */
+    return process_create_arg((void (*)(void*))entry_point, NULL, name);
+}
+
 process_t* process_create_user(void (*entry_point)(void), const char* name) {
     process_t* proc = (process_t*)kmalloc(sizeof(process_t));
-    proc->pid = next_pid++;
     
     int i = 0;
     for(; i < PROCESS_NAME_LEN-1 && name[i]; i++) proc->name[i] = name[i];
@@ -145,77 +350,148 @@ process_t* process_create_user(void (*entry_point)(void), const char* name) {
     
     proc->esp = (uint32_t)stack_ptr;
     proc->state = STATE_READY;
-    proc->sleep_ticks = 0;
+    hrtimer_setup(&proc->sleep_timer, process_sleep_timeout, proc);
+    proc->fpu_state = NULL;
+    proc->fpu_cpu = FPU_NO_CPU;
+    proc->on_cpu = 0;
     
     /* 插入链表 */
-    proc->next = process_list->next;
-    process_list->next = proc;
+    process_list_add(proc);
+    sched_enqueue_new(proc);
     
     return proc;
 }
 
+// 空闲时的工作窃取：从最忙的 CPU 拿走一个可迁移的任务直接运行
+static process_t* steal_task(cpu_t* c) {
+    cpu_t* busiest = find_busiest(c, 0);
+    if (!busiest || !spin_trylock(&busiest->rq_lock)) return NULL;
+    process_t* p = rq_detach_movable(busiest);
+    if (p) {
+        p->cpu = c->id;
+        c->nr_steals++;
+    }
+    spin_unlock(&busiest->rq_lock);
+    return p;
+}
+
+// 周期性负载均衡：最忙的 CPU 比自己多 2 个以上任务时，拉过来一半差额
+static void load_balance(cpu_t* c) {
+    c->last_balance = c->sched_ticks;
+    cpu_t* busiest = find_busiest(c, c->nr_running + 1);
+    if (!busiest || !spin_trylock(&busiest->rq_lock)) return;
+    uint32_t n = 0;
+    if (busiest->nr_running > c->nr_running) n = (busiest->nr_running - c->nr_running) / 2;
+    while (n--) {
+        process_t* p = rq_detach_movable(busiest);
+        if (!p) break;
+        p->cpu = c->id;
+        rq_enqueue(c, p);
+        c->nr_pulled++;
+    }
+    spin_unlock(&busiest->rq_lock);
+}
+
 struct registers* schedule(struct registers* current_regs) {
-    if (!current_process) return current_regs;
+    cpu_t* c = this_cpu();
+    process_t* prev = c->current;
+    if (!prev) return current_regs;
     
     /* 1. 保存当前任务的栈指针 */
-    /* 注意：current_regs 其实就是指向旧栈栈顶的指针（在 isr.asm 里 push esp 传递过来的）*/
-    /* 但是 isr.asm 里是在 push esp, call handler 之前 push 的。
-       iret 前的栈顶实际上就是 current_regs 指向的位置（如果忽略参数 push）。
-       准确地说，current_regs 指向的是 `push esp` 压入的那个值，也就是 `push ds` 之后的 ESP。
-       而我们的 `mov esp, eax` 会把 ESP 设为 EAX。
-       如果我不切换，返回 curent_regs，ESP 就恢复到调用 handler 之前...
-       
-       等待，isr.asm:
-       push esp  <-- regs 参数
-       call handler
-       mov esp, eax
-       
-       如果 handler 返回的是 regs (即旧 ESP)，那么 esp 恢复原位，接下来的 pop gs 等正常执行。
-       
-       所以，我们只需要把 current_regs 保存进 PCB 即可。
-    */
-    current_process->esp = (uint32_t)current_regs;
-    
-    /* 2. 轮转调度 (Round Robin) */
-    /* 循环查找下一个处于 READY 状态的进程 */
-    process_t* next = current_process->next;
-    while (next->state != STATE_READY) {
-        next = next->next;
-        /* 安全保障：PID 0 (Kernel_Idle) 永远是 READY 的，
-           所以这个循环一定能退出来，不会死循环。 */
+    /* current_regs 就是 isr.asm 里 push esp 传进来的现场指针，
+       以后切回这个任务时，中断桩会把 ESP 设为它，然后 pop/iret 恢复现场。 */
+    /* 调度只在中断/系统调用上下文中发生 (IF=0)，直接加锁即可 */
+    spin_lock(&c->rq_lock);
+    prev->esp = (uint32_t)current_regs;
+
+    /* 2. 仍可运行的任务放回本 CPU 队尾 (idle 不进入队列) */
+    if (prev != c->idle && prev->state == STATE_READY && !prev->on_rq) {
+        rq_enqueue(c, prev);
+    }
+
+    if (c->sched_ticks - c->last_balance >= SCHED_BALANCE_TICKS) {
+        load_balance(c);
+    }
+
+    /* 3. 轮转调度 (Round Robin)：取队头；本地没有任务就去偷，还没有就运行 idle */
+    process_t* next = rq_dequeue(c);
+    if (!next) next = steal_task(c);
+    if (!next) next = c->idle;
+
+    if (next != prev) {
+        TRACE_POINT(TRACE_SCHED_SWITCH, prev->pid, next->pid);
+        c->prev = prev;
+        c->nr_switches++;
     }
-    current_process = next;
+    next->on_cpu = 1;
+    next->cpu = c->id;
+    c->current = next;
+    spin_unlock(&c->rq_lock);
     
-    /* 3. 更新 TSS 中的内核栈 */
+    /* 4. 本时间片用过 FPU 的任务保存 x87/SSE 状态，并置 CR0.TS 让新任务按需装入 (惰性切换)。
+       此时 prev->on_cpu 仍为 1，其他 CPU 还不能运行它，保存完成前状态不会被读走 */
+    if (next != prev) fpu_switch_out(prev);
+
+    /* 5. 更新本 CPU TSS 中的内核栈 */
     /* 当从这个新任务的 User Mode 发生中断时，CPU 会自动切换到这个 esp0 */
-    tss_set_stack(current_process->kernel_stack_top);
+    /* SYSENTER 不读 TSS，同一个栈顶还要写进 MSR_SYSENTER_ESP */
+    if (next->kernel_stack_top) {
+        tss_set_stack(next->kernel_stack_top);
+        syscall_set_kernel_stack(next->kernel_stack_top);
+    }
     
-    /* 4. 返回新任务的栈指针 */
-    return (struct registers*)current_process->esp;
+    /* 6. 返回新任务的栈指针 */
+    return (struct registers*)next->esp;
 }
 
-void process_update_sleep_ticks(void) {
-    if (!process_list) return;
+void finish_task_switch(void) {
+    cpu_t* c = this_cpu();
+    process_t* prev = c->prev;
+    if (prev) {
+        c->prev = NULL;
+        prev->on_cpu = 0;
+    }
+}
 
-    process_t* first = process_list;
-    process_t* curr = first;
-    
-    do {
-        if (curr->state == STATE_SLEEPING) {
-            if (curr->sleep_ticks > 0) {
-                curr->sleep_ticks--;
-            }
-            if (curr->sleep_ticks == 0) {
-                curr->state = STATE_READY;
-            }
-        }
-        curr = curr->next;
-    } while (curr != first);
+void sched_tick(void) {
+    cpu_t* c = this_cpu();
+    c->sched_ticks++;
+    if (c->current == c->idle) c->idle_ticks++;
+    c->need_resched = 1;
+}
+
+int process_sleep_until(uint64_t deadline) {
+    cpu_t* c = this_cpu();
+    process_t* cur = c->current;
+    if (!cur || cur == c->idle) return 0;
+    if (deadline <= clock_monotonic_ns()) return 0;
+    /* 先改状态再启动定时器：定时器可能马上在 BSP 上到期，唤醒时必须看到 SLEEPING */
+    cur->state = STATE_SLEEPING;
+    hrtimer_start(&cur->sleep_timer, deadline);
+    return 1;
+}
+
+process_t* process_current(void) {
+    return this_cpu()->current;
 }
 
-void process_sleep(uint32_t ticks) {
-    if (current_process && current_process->pid != 0) {
-        current_process->state = STATE_SLEEPING;
-        current_process->sleep_ticks = ticks;
+void process_block_current(void) {
+    cpu_t* c = this_cpu();
+    if (c->current && c->current != c->idle) {
+        c->current->state = STATE_BLOCKED;
     }
 }
+
+void process_wake(process_t* proc) {
+    if (proc && proc->state == STATE_BLOCKED) {
+        wake_up_process(proc, STATE_BLOCKED, 0);
+    }
+}
+
+void process_yield(void) {
+    /* 复用 2 号系统调用 (yield)：Ring 0 同样可以执行 int 0x80，
+       中断门会在当前内核栈上压入现场，schedule() 保存后切走，
+       之后被调度回来时从 int 指令的下一条继续执行。 */
+    uint32_t nr = SYS_YIELD;
+    asm volatile("int $0x80" : "+a"(nr) : : "memory");   /* EAX 带回返回值 */
+}
@@ -1,36 +1,73 @@
 #pragma once
 #include "interrupts.h"
+#include "hrtimer.h"
 #include <stdint.h>
 
 #define PROCESS_NAME_LEN 32
 
 #define STATE_READY    0
 #define STATE_SLEEPING 1
+#define STATE_BLOCKED  2   /* 等待事件，由 process_wake() 唤醒 */
+
+/* 周期性负载均衡的间隔 (每个 CPU 自己的时钟 tick 数) */
+#define SCHED_BALANCE_TICKS 20
 
 typedef struct process {
     uint32_t pid;
     uint32_t esp;              /* 当前保存的栈指针 (struct registers*) */
     uint32_t kernel_stack_top; /* 初始/基础内核栈顶 (用于 TSS.esp0) */
-    uint32_t state;            /* 进程状态 (READY, SLEEPING 等) */
-    uint32_t sleep_ticks;      /* 休眠剩余滴答数 */
+    volatile uint32_t state;   /* 进程状态 (READY, SLEEPING 等) */
+    struct hrtimer sleep_timer; /* 休眠到期时唤醒 (STATE_SLEEPING) */
+    uint8_t* fpu_state;        /* FXSAVE 区 (16 字节对齐)，第一次使用 FPU 时分配 (fpu.c) */
+    uint32_t fpu_cpu;          /* 上一次把状态装入寄存器的 CPU */
     char name[PROCESS_NAME_LEN];
-    struct process* next;
+    struct process* next;      /* 全局进程链表 (循环)，受 proc_list_lock 保护 */
+
+    /* SMP 调度 (受所在 CPU 的 rq_lock 保护) */
+    uint32_t cpu;              /* 所属 CPU (运行队列) */
+    volatile uint32_t on_cpu;  /* 1: 某个 CPU 正在使用它的栈，不能被迁移 */
+    uint32_t on_rq;            /* 1: 在运行队列中 */
+    struct process* rq_next;
 } process_t;
 
 /* 初始化多任务系统 (将当前流作为 Idle 任务) */
 void process_init(void);
 
+/* 为 AP 创建 idle 进程 (代表 AP 启动后的当前执行流，不进入运行队列) */
+process_t* process_create_idle(const char* name);
+
 /* 创建新内核线程 (Ring 0) */
 process_t* process_create(void (*entry_point)(void), const char* name);
 
+/* 创建带参数的内核线程：entry_point(arg) */
+process_t* process_create_arg(void (*entry_point)(void*), void* arg, const char* name);
+
 /* 创建新用户进程 (Ring 3) */
 process_t* process_create_user(void (*entry_point)(void), const char* name);
 
-/* 调度函数 (被时钟中断调用) */
+/* 调度函数 (被时钟中断调用)：在本 CPU 的运行队列中选择下一个进程，
+   队列为空时从最忙的 CPU 偷取任务 */
 struct registers* schedule(struct registers* current_regs);
 
-/* 更新所有进程的休眠计时 (由时钟中断调用) */
-void process_update_sleep_ticks(void);
+/* 由中断桩在切换到新栈之后调用：清除上一个进程的 on_cpu 标记 */
+void finish_task_switch(void);
+
+/* 每个 CPU 的时钟中断调用：统计并请求调度 */
+void sched_tick(void);
+
+/* 使当前进程休眠到 deadline (clock_monotonic_ns) 为止。需关中断调用，
+   随后由系统调用返回路径 schedule() 或 process_yield() 真正让出 CPU。
+   deadline 已经过去时什么都不做，返回 0；否则返回 1 */
+int process_sleep_until(uint64_t deadline);
+
+/* 获取当前正在运行的进程 */
+process_t* process_current(void);
+
+/* 将当前进程标记为阻塞 (需关中断调用，随后调用 process_yield 真正让出 CPU) */
+void process_block_current(void);
+
+/* 唤醒一个阻塞的进程 (可在中断上下文调用) */
+void process_wake(process_t* proc);
 
-/* 使当前进程进入休眠 (由系统调用调用) */
-void process_sleep(uint32_t ticks);
+/* 内核线程主动让出 CPU (通过 int 0x80 触发一次调度) */
+void process_yield(void);
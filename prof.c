@@ -0,0 +1,165 @@
+#include "prof.h"
+#include "ksyms.h"
+#include "interrupts.h"
+#include "process.h"
+#include "heap.h"
+#include "terminal.h"
+#include "smp.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 时钟中断中采样 (任意 CPU，无锁：用原子加法领取缓冲区中的槽位)
+// - 扁平剖析与原始样本输出
+//
+// 采样期间只写不读；prof_report/prof_dump_raw 应在 prof stop 之后使用，
+// 否则可能读到其他 CPU 正在填写的样本 (只影响那一个样本)。
+
+struct prof_sample {
+    uint32_t eip;
+    uint32_t callers[PROF_DEPTH];   /* 0 表示回溯到此为止 */
+    uint16_t cs;
+    uint16_t cpu;
+    uint32_t pid;
+};
+
+static struct prof_sample prof_buf[PROF_MAX_SAMPLES];
+static volatile uint32_t prof_next = 0;     /* 下一个空槽 (可能超过容量，超出部分即丢弃数) */
+static volatile int prof_enabled = 0;
+
+// 沿 EBP 链回溯：[ebp] = 上一帧的 EBP，[ebp+4] = 返回地址。
+// 被打断的代码与中断帧在同一个内核栈上，合法的帧一定在 regs 之上 4KB (一个内核栈) 之内，
+// 并且越往外层地址越高；不满足就停止，避免跟着垃圾指针读到未映射的内存。
+static void prof_backtrace(struct registers* regs, uint32_t* callers) {
+    uint32_t lo = (uint32_t)regs;
+    uint32_t hi = lo + 4096;
+    uint32_t ebp = regs->ebp;
+    for (int i = 0; i < PROF_DEPTH; i++) {
+        if (ebp <= lo || ebp + 8 > hi || (ebp & 3)) {
+            callers[i] = 0;
+            continue;
+        }
+        callers[i] = ((uint32_t*)ebp)[1];
+        lo = ebp;
+        ebp = ((uint32_t*)ebp)[0];
+    }
+}
+
+void prof_tick(struct registers* regs) {
+    if (!prof_enabled) return;
+    uint32_t idx = __sync_fetch_and_add(&prof_next, 1);
+    if (idx >= PROF_MAX_SAMPLES) return;
+
+    struct prof_sample* s = &prof_buf[idx];
+    cpu_t* c = this_cpu();
+    s->eip = regs->eip;
+    s->cs = (uint16_t)regs->cs;
+    s->cpu = (uint16_t)c->id;
+    s->pid = c->current ? c->current->pid : 0;
+    if ((regs->cs & 3) == 0) {
+        prof_backtrace(regs, s->callers);
+    } else {
+        for (int i = 0; i < PROF_DEPTH; i++) s->callers[i] = 0;
+    }
+}
+
+void prof_start(void) {
+    prof_enabled = 0;
+    prof_next = 0;
+    prof_enabled = 1;
+    terminal_writestring("prof: sampling on every timer tick\n");
+}
+
+void prof_stop(void) {
+    prof_enabled = 0;
+    uint32_t n = prof_next;
+    terminal_writestring("prof: stopped, ");
+    terminal_writedec(n < PROF_MAX_SAMPLES ? n : PROF_MAX_SAMPLES);
+    terminal_writestring(" samples");
+    if (n > PROF_MAX_SAMPLES) {
+        terminal_writestring(", ");
+        terminal_writedec(n - PROF_MAX_SAMPLES);
+        terminal_writestring(" dropped");
+    }
+    terminal_putchar('\n');
+}
+
+static uint32_t prof_samples(void) {
+    uint32_t n = prof_next;
+    return n < PROF_MAX_SAMPLES ? n : PROF_MAX_SAMPLES;
+}
+
+#define PROF_TOP 20
+
+void prof_report(void) {
+    uint32_t n = prof_samples();
+    uint32_t nsyms = ksyms_count();
+    if (n == 0) {
+        terminal_writestring("prof: no samples ('prof start' first)\n");
+        return;
+    }
+    if (nsyms == 0) {
+        terminal_writestring("prof: kernel built without symbol table, use 'prof raw'\n");
+        return;
+    }
+
+    /* 每个符号一个计数器，最后一个给找不到符号的内核地址 */
+    uint32_t* counts = (uint32_t*)kmalloc((nsyms + 1) * sizeof(uint32_t));
+    if (!counts) return;
+    for (uint32_t i = 0; i <= nsyms; i++) counts[i] = 0;
+    uint32_t user = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (prof_buf[i].cs & 3) { user++; continue; }
+        int sym = ksyms_lookup(prof_buf[i].eip, NULL);
+        counts[sym < 0 ? nsyms : (uint32_t)sym]++;
+    }
+
+    terminal_writestring("samples: ");
+    terminal_writedec(n);
+    terminal_writestring("  (user ");
+    terminal_writedec(user);
+    terminal_writestring(")\n  %  SAMPLES  FUNCTION\n");
+
+    /* 每轮选出剩余最多的一项 (只打印前 PROF_TOP 项，选择排序足够) */
+    for (int rank = 0; rank < PROF_TOP; rank++) {
+        uint32_t best = 0, best_count = 0;
+        for (uint32_t i = 0; i <= nsyms; i++) {
+            if (counts[i] > best_count) { best = i; best_count = counts[i]; }
+        }
+        if (best_count == 0) break;
+        counts[best] = 0;
+
+        uint32_t pct = best_count * 100 / n;
+        if (pct < 10) terminal_putchar(' ');
+        if (pct < 100) terminal_putchar(' ');
+        terminal_writedec(pct);
+        terminal_writestring("  ");
+        for (uint32_t w = 1000000; w > 1; w /= 10) if (best_count < w) terminal_putchar(' ');
+        terminal_writedec(best_count);
+        terminal_writestring("  ");
+        terminal_writestring(best < nsyms ? ksyms_name(best) : "[unknown]");
+        terminal_putchar('\n');
+    }
+    kfree(counts);
+}
+
+void prof_dump_raw(void) {
+    uint32_t n = prof_samples();
+    /* 格式：cpu pid cs eip caller1 caller2 ... (均为十六进制，调用者由内向外) */
+    terminal_writestring("# prof raw: cpu pid cs eip callers...\n");
+    for (uint32_t i = 0; i < n; i++) {
+        struct prof_sample* s = &prof_buf[i];
+        terminal_writehex(s->cpu);
+        terminal_putchar(' ');
+        terminal_writehex(s->pid);
+        terminal_putchar(' ');
+        terminal_writehex(s->cs);
+        terminal_putchar(' ');
+        terminal_writehex(s->eip);
+        for (int k = 0; k < PROF_DEPTH && s->callers[k]; k++) {
+            terminal_putchar(' ');
+            terminal_writehex(s->callers[k]);
+        }
+        terminal_putchar('\n');
+    }
+    terminal_writestring("# end\n");
+}
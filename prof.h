@@ -0,0 +1,36 @@
+/**
+ * prof.h - 基于时钟中断的统计采样剖析器 (shell 命令 prof)
+ *
+ * 开启后，每个 CPU 的每次时钟中断都从被打断的现场 (struct registers) 取一个样本：
+ * EIP、CS (区分内核/用户态)、CPU 号、当前进程 PID；内核态样本还沿 EBP 链回溯
+ * 最多 PROF_DEPTH 层调用者 (内核以 -O0 编译，保留帧指针)。
+ * 样本写入一个固定大小的缓冲区，写满后丢弃并计数。
+ *
+ * 输出：
+ * - prof       扁平剖析：按内嵌符号表 (ksyms.h) 把内核样本归到函数，按样本数降序打印；
+ * - prof raw   每个样本一行十六进制地址，主机上用 kernel.elf 符号化后可生成火焰图 (见 doc/prof.md)。
+ *
+ * 采样频率就是时钟频率 (每 CPU 100Hz)：采样要足够长 (数十秒) 才有统计意义。
+ * 关中断的代码不会被时钟中断打断，样本会堆积在它重新开中断的位置。
+ *
+ * @see [prof.md](doc/prof.md)
+ */
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+
+#define PROF_MAX_SAMPLES 2048
+#define PROF_DEPTH       5      /* 内核态样本额外记录的调用者层数 */
+
+struct registers;
+
+/* 由时钟中断调用：未开启时立即返回 */
+void prof_tick(struct registers* regs);
+
+void prof_start(void);          /* 清空缓冲区并开始采样 */
+void prof_stop(void);
+void prof_report(void);         /* 扁平剖析 */
+void prof_dump_raw(void);       /* 原始样本 */
+
+#endif
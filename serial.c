@@ -0,0 +1,205 @@
+#include "serial.h"
+#include "interrupts.h"
+#include "spinlock.h"
+#include "terminal.h"
+#include "printk.h"
+#include "kbd.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - COM1 的探测与初始化 (115200 8N1，FIFO 14 字节触发)
+// - TX 环形缓冲区与发送中断：写者入队即返回，中断处理函数补满硬件 FIFO
+// - 接收：IRQ4 收字节，转换后放入控制台输入设备 (kbd.c)，由 Shell 任务读取
+//
+// 并发说明：TX 缓冲区、IER 的影子值由 serial_lock (关中断自旋锁) 保护。
+// serial_write 在 terminal_lock 内被调用 (终端 → 串口)，中断处理函数只拿 serial_lock，
+// 两把锁的顺序固定，不会死锁。唤醒 Shell 任务要拿运行队列的锁，放在释放 serial_lock 之后。
+
+#define UART_DATA   0       /* 收发数据 (DLAB=1 时为除数低字节) */
+#define UART_IER    1       /* 中断使能 (DLAB=1 时为除数高字节) */
+#define UART_IIR    2       /* 读：中断标识 */
+#define UART_FCR    2       /* 写：FIFO 控制 */
+#define UART_LCR    3
+#define UART_MCR    4
+#define UART_LSR    5
+
+#define IER_RDI     0x01    /* 接收数据可用 (含 FIFO 超时) */
+#define IER_THRI    0x02    /* 发送保持寄存器空 */
+#define IIR_NO_INT  0x01
+#define IIR_FIFO    0xC0    /* 16550A：FIFO 已启用 */
+#define LCR_DLAB    0x80
+#define LCR_8N1     0x03
+#define MCR_DTR_RTS_OUT2 0x0B   /* OUT2 接通 UART 到中断控制器的 IRQ 线 */
+#define MCR_LOOP    0x10
+#define LSR_DR      0x01    /* 有数据可读 */
+#define LSR_THRE    0x20    /* 发送保持寄存器 (FIFO) 空 */
+
+#define TX_MASK     (SERIAL_TX_BUF_SIZE - 1)
+
+static inline void outb(uint16_t port, uint8_t val) {
+    asm volatile ( "outb %0, %1" : : "a"(val), "Nd"(port) );
+}
+
+static inline uint8_t inb(uint16_t port) {
+    uint8_t ret;
+    asm volatile ( "inb %1, %0" : "=a"(ret) : "Nd"(port) );
+    return ret;
+}
+
+static int serial_ok = 0;
+static int serial_irq_mode = 0;
+static uint32_t tx_fifo_size = 1;       /* 16550A 为 16，老式 8250/16450 没有 FIFO */
+static uint8_t serial_ier = 0;          /* IER 的影子值，避免读端口 */
+static spinlock_t serial_lock = SPINLOCK_INIT("serial");
+
+static char tx_buf[SERIAL_TX_BUF_SIZE];
+static uint32_t tx_head = 0;            /* 写者推进 */
+static uint32_t tx_tail = 0;            /* 中断处理函数推进 */
+static uint32_t tx_dropped = 0;
+
+static inline void serial_set_ier(uint8_t ier) {
+    if (ier != serial_ier) {
+        serial_ier = ier;
+        outb(SERIAL_COM1 + UART_IER, ier);
+    }
+}
+
+// 持锁调用：向硬件 FIFO 补满数据 (调用前 LSR.THRE 必须为 1)。
+// 缓冲区还有数据就保持发送中断打开，发完就关掉，否则 THR 空会一直触发中断。
+static void serial_tx_fill(void) {
+    for (uint32_t i = 0; i < tx_fifo_size && tx_tail != tx_head; i++) {
+        outb(SERIAL_COM1 + UART_DATA, (uint8_t)tx_buf[tx_tail++ & TX_MASK]);
+    }
+    if (tx_tail != tx_head) serial_set_ier(serial_ier | IER_THRI);
+    else serial_set_ier(serial_ier & ~IER_THRI);
+}
+
+// 持锁调用：放入一个字节。启动阶段 (还没有中断) 轮询发送
+static void serial_tx_byte(char c) {
+    if (!serial_irq_mode) {
+        while (!(inb(SERIAL_COM1 + UART_LSR) & LSR_THRE)) { }
+        outb(SERIAL_COM1 + UART_DATA, (uint8_t)c);
+        return;
+    }
+    if (tx_head - tx_tail >= SERIAL_TX_BUF_SIZE) {
+        tx_dropped++;
+        return;
+    }
+    tx_buf[tx_head++ & TX_MASK] = c;
+}
+
+void serial_write(const char* data, size_t size) {
+    if (!serial_ok) return;
+    uint32_t flags = spin_lock_irqsave(&serial_lock);
+
+    /* 之前丢过数据：腾出空间后先插一行提示，读日志的人知道这里缺了内容 */
+    if (tx_dropped && SERIAL_TX_BUF_SIZE - (tx_head - tx_tail) >= 64) {
+        char note[48];
+        int n = snprintk(note, sizeof(note), "\r\n[serial: %u bytes dropped]\r\n", tx_dropped);
+        tx_dropped = 0;
+        for (int i = 0; i < n; i++) serial_tx_byte(note[i]);
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        char c = data[i];
+        if (c == '\n') {
+            serial_tx_byte('\r');
+            serial_tx_byte('\n');
+        } else if (c == '\b') {
+            /* 终端的退格会擦掉前一个字符，串口终端上要显式覆盖 */
+            serial_tx_byte('\b');
+            serial_tx_byte(' ');
+            serial_tx_byte('\b');
+        } else {
+            serial_tx_byte(c);
+        }
+    }
+
+    /* 发送中断没开着说明发送器空闲 (或正在发最后一批)：FIFO 空就直接补，否则等中断 */
+    if (serial_irq_mode && tx_tail != tx_head && !(serial_ier & IER_THRI)) {
+        if (inb(SERIAL_COM1 + UART_LSR) & LSR_THRE) serial_tx_fill();
+        else serial_set_ier(serial_ier | IER_THRI);
+    }
+    spin_unlock_irqrestore(&serial_lock, flags);
+}
+
+// 接收 (IRQ4 中调用)：转换成与键盘相同的字符放入输入设备。
+// 串口终端发来的回车是 '\r'，退格是 DEL (0x7F)；PgUp/PgDn 是 "ESC [5~" / "ESC [6~"，
+// 方向键等其他 ESC 序列直接丢弃。
+static void serial_rx_char(char c) {
+    static int esc_state = 0;   /* 0: 普通；1: 收到 ESC；2: 收到 "ESC [" */
+    static char esc_param = 0;  /* "ESC [" 之后最后一个参数字符 */
+    if (esc_state == 1) {
+        esc_state = (c == '[') ? 2 : 0;
+        esc_param = 0;
+        return;
+    }
+    if (esc_state == 2) {
+        if (c >= 0x40 && c <= 0x7E) {
+            esc_state = 0;
+            if (c == '~' && esc_param == '5') kbd_put(KBD_SRC_SERIAL, KBD_KEY_PGUP);
+            if (c == '~' && esc_param == '6') kbd_put(KBD_SRC_SERIAL, KBD_KEY_PGDN);
+        } else {
+            esc_param = c;
+        }
+        return;
+    }
+    if (c == 0x1B) esc_state = 1;
+    else if (c == '\r' || c == '\n') kbd_put(KBD_SRC_SERIAL, '\n');
+    else if (c == 0x7F || c == '\b') kbd_put(KBD_SRC_SERIAL, '\b');
+    else if (c >= 0x20 && c < 0x7F) kbd_put(KBD_SRC_SERIAL, c);
+}
+
+static int serial_interrupt(struct registers* regs, void* ctx) {
+    (void)regs; (void)ctx;
+    if (inb(SERIAL_COM1 + UART_IIR) & IIR_NO_INT) return IRQ_NONE;
+
+    int got = 0;
+    spin_lock(&serial_lock);
+    uint8_t lsr;
+    while ((lsr = inb(SERIAL_COM1 + UART_LSR)) & LSR_DR) {
+        serial_rx_char((char)inb(SERIAL_COM1 + UART_DATA));
+        got = 1;
+    }
+    if ((lsr & LSR_THRE) && (serial_ier & IER_THRI)) serial_tx_fill();
+    spin_unlock(&serial_lock);
+
+    if (got) kbd_wake();
+    return IRQ_HANDLED;
+}
+
+int serial_init(void) {
+    uint16_t port = SERIAL_COM1;
+    outb(port + UART_IER, 0x00);
+
+    /* 波特率：除数 = 115200 / baud */
+    uint16_t divisor = (uint16_t)(115200 / SERIAL_BAUD);
+    outb(port + UART_LCR, LCR_DLAB);
+    outb(port + UART_DATA, (uint8_t)(divisor & 0xFF));
+    outb(port + UART_IER, (uint8_t)(divisor >> 8));
+    outb(port + UART_LCR, LCR_8N1);
+
+    outb(port + UART_FCR, 0xC7);        /* 启用并清空 FIFO，接收 14 字节触发 */
+
+    /* 回环自检：没有串口时读回的是 0xFF */
+    outb(port + UART_MCR, MCR_LOOP | MCR_DTR_RTS_OUT2);
+    outb(port + UART_DATA, 0xAE);
+    if (inb(port + UART_DATA) != 0xAE) return 0;
+    outb(port + UART_MCR, MCR_DTR_RTS_OUT2);
+
+    if ((inb(port + UART_IIR) & IIR_FIFO) == IIR_FIFO) tx_fifo_size = 16;
+    serial_ok = 1;
+    terminal_add_console(serial_write);
+    printk(KERN_INFO, "serial: COM1 at %u baud, %s\n", SERIAL_BAUD,
+           tx_fifo_size > 1 ? "16550A FIFO" : "no FIFO");
+    return 1;
+}
+
+void serial_start_irq(void) {
+    if (!serial_ok) return;
+    irq_register(SERIAL_IRQ, serial_interrupt, NULL);
+    uint32_t flags = spin_lock_irqsave(&serial_lock);
+    serial_irq_mode = 1;
+    serial_set_ier(IER_RDI);
+    spin_unlock_irqrestore(&serial_lock, flags);
+}
@@ -0,0 +1,42 @@
+/**
+ * serial.h - 16550 UART 串口控制台 (COM1)
+ *
+ * 唯一的输出设备是 0xB8000 的 VGA 文本缓冲区：没有显示器就看不到任何东西，
+ * 不能用 qemu -nographic 运行，也没法在 CI 里抓日志。
+ *
+ * COM1 (I/O 端口 0x3F8，IRQ4) 作为第二个控制台：
+ * - 挂在 terminal_write 上 (terminal_add_console)，屏幕上的所有内容同时从串口发出，
+ *   '\n' 转换为 "\r\n"，退格转换为 "\b \b"；
+ * - 串口收到的字符与键盘一样放进控制台输入设备 (kbd.h)，由 Shell 任务读取。
+ *
+ * 发送与接收都经过环形缓冲区，由中断驱动：
+ * - 写者只把数据放进 TX 缓冲区，必要时打开“发送保持寄存器空”中断后立即返回，
+ *   从不轮询线路状态寄存器等待发送完成；缓冲区满时丢弃并计数，之后插入一行提示；
+ * - 中断处理函数每次向 16 字节的硬件 FIFO 补满数据，发送完毕后关掉发送中断；
+ * - 接收到的字节在中断里直接转换后放进输入设备 (FIFO 满 14 字节或超时才中断一次)。
+ *
+ * 开中断之前 (serial_start_irq 之前) 还没有中断可用：启动日志以轮询方式同步发送。
+ *
+ * @see [serial.md](doc/serial.md)
+ */
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SERIAL_COM1         0x3F8
+#define SERIAL_IRQ          4
+#define SERIAL_BAUD         115200
+#define SERIAL_TX_BUF_SIZE  16384   /* 2 的幂 */
+
+/* 探测并初始化 COM1 (轮询模式)，注册为控制台。返回 0 表示没有串口 */
+int serial_init(void);
+
+/* 注册 IRQ4 并切换到中断驱动 (在 irq_init 之后、开中断之前调用) */
+void serial_start_irq(void);
+
+/* 发送数据 (不阻塞；中断模式下缓冲区满时丢弃) */
+void serial_write(const char* data, size_t size);
+
+#endif
@@ -1,6 +1,17 @@
 #include "shell.h"
 #include "terminal.h"
 #include "string.h"
+#include "smp.h"
+#include "irqbench.h"
+#include "membench.h"
+#include "boottime.h"
+#include "irqstat.h"
+#include "irqsoff.h"
+#include "prof.h"
+#include "trace.h"
+#include "printk.h"
+#include "kbd.h"
+#include "process.h"
 
 #define CMD_BUF_SIZE 256
 
@@ -22,11 +33,26 @@ void shell_prompt() {
     terminal_writestring("root@myos /> ");
 }
 
+// Shell 任务：阻塞读取控制台输入设备 (键盘与串口)，逐字符交给 shell_input。
+// 命令在这个内核线程中执行 (开中断、可被抢占)，既不占用中断上下文，也不占用系统工作队列
+static void shell_task(void) {
+    char buf[16];
+    while (1) {
+        uint32_t n = vfs_read(&kbd_dev, 0, sizeof(buf), (uint8_t*)buf);
+        for (uint32_t i = 0; i < n; i++) {
+            if (buf[i] == KBD_KEY_PGUP) terminal_scroll_view(-12);     /* 回看历史，每次半屏 */
+            else if (buf[i] == KBD_KEY_PGDN) terminal_scroll_view(12);
+            else shell_input(buf[i]);
+        }
+    }
+}
+
 void shell_init() {
     terminal_writestring("\nWelcome to MyOS Shell!\n");
     terminal_writestring("Type 'help' for commands.\n");
     cmd_len = 0;
     shell_prompt();
+    process_create(shell_task, "shell");
 }
 
 void cmd_help() {
@@ -36,6 +62,19 @@ void cmd_help() {
     terminal_writestring("  reboot   - Reboot system\n");
     terminal_writestring("  ls       - List files\n");
     terminal_writestring("  cat <f>  - Print file content\n");
+    terminal_writestring("  cpus     - Per-CPU scheduler statistics\n");
+    terminal_writestring("  lockstat - Spinlock statistics ('lockstat reset' clears)\n");
+    terminal_writestring("  irqbench - Interrupt entry/exit cost in cycles\n");
+    terminal_writestring("  membench - memcpy variants, 8 B .. 1 MB\n");
+    terminal_writestring("  boottime - Boot phase timeline in us\n");
+    terminal_writestring("  irqstat  - Per-vector interrupt time ('irqstat reset' clears)\n");
+#ifdef CONFIG_IRQSOFF_TRACE
+    terminal_writestring("  irqsoff  - Longest irqs-off sections ('irqsoff reset' clears)\n");
+#endif
+    terminal_writestring("  prof     - Sampling profiler: prof start|stop|raw, 'prof' = report\n");
+    terminal_writestring("  trace    - Event trace: trace on|off|clear, trace [pid N|func NAME]\n");
+    terminal_writestring("  dmesg    - Kernel log buffer ('dmesg clear' clears)\n");
+    terminal_writestring("  termbench - Terminal output speed, legacy vs shadow buffer\n");
 }
 
 void cmd_clear() {
@@ -85,6 +124,9 @@ void shell_execute() {
     }
 
     cmd_buffer[cmd_len] = '\0';
+
+    /* 命令的输出期间暂停异步日志，之后的日志行出现在提示符之前 */
+    console_lock();
     
     // 简单的命令解析：分离命令和参数
     char* cmd = cmd_buffer;
@@ -110,6 +152,62 @@ void shell_execute() {
         cmd_ls();
     } else if (strcmp(cmd, "cat") == 0) {
         cmd_cat(args);
+    } else if (strcmp(cmd, "cpus") == 0) {
+        smp_dump();
+    } else if (strcmp(cmd, "lockstat") == 0) {
+        if (args && strcmp(args, "reset") == 0) {
+            lockstat_reset();
+        } else {
+            lockstat_dump();
+        }
+    } else if (strcmp(cmd, "irqbench") == 0) {
+        irqbench_run();
+    } else if (strcmp(cmd, "membench") == 0) {
+        membench_run();
+    } else if (strcmp(cmd, "boottime") == 0) {
+        boottime_dump();
+    } else if (strcmp(cmd, "irqstat") == 0) {
+        if (args && strcmp(args, "reset") == 0) {
+            irqstat_reset();
+        } else {
+            irqstat_dump();
+        }
+#ifdef CONFIG_IRQSOFF_TRACE
+    } else if (strcmp(cmd, "irqsoff") == 0) {
+        if (args && strcmp(args, "reset") == 0) {
+            irqsoff_reset();
+        } else {
+            irqsoff_dump();
+        }
+#endif
+    } else if (strcmp(cmd, "prof") == 0) {
+        if (args && strcmp(args, "start") == 0) {
+            prof_start();
+        } else if (args && strcmp(args, "stop") == 0) {
+            prof_stop();
+        } else if (args && strcmp(args, "raw") == 0) {
+            prof_dump_raw();
+        } else {
+            prof_report();
+        }
+    } else if (strcmp(cmd, "trace") == 0) {
+        if (args && strcmp(args, "on") == 0) {
+            trace_on();
+        } else if (args && strcmp(args, "off") == 0) {
+            trace_off();
+        } else if (args && strcmp(args, "clear") == 0) {
+            trace_clear();
+        } else {
+            trace_dump(args);
+        }
+    } else if (strcmp(cmd, "termbench") == 0) {
+        terminal_bench();
+    } else if (strcmp(cmd, "dmesg") == 0) {
+        if (args && strcmp(args, "clear") == 0) {
+            dmesg_clear();
+        } else {
+            dmesg_dump();
+        }
     } else {
         terminal_writestring("Unknown command: ");
         terminal_writestring(cmd);
@@ -117,6 +215,7 @@ void shell_execute() {
     }
 
     cmd_len = 0;
+    console_unlock();
     shell_prompt();
 }
 
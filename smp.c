@@ -0,0 +1,159 @@
+#include "smp.h"
+#include "apic.h"
+#include "gdt.h"
+#include "idt.h"
+#include "heap.h"
+#include "process.h"
+#include "interrupts.h"
+#include "terminal.h"
+#include "printk.h"
+#include "syscall.h"
+#include "fpu.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 每 CPU 数据数组 cpus[]（GS 段基址指向其中一项）
+// - AP 启动：复制 trampoline、发送 INIT/SIPI/SIPI、等待 AP 上线
+// - AP 的 C 入口：加载自己的 GDT/TSS 与共享 IDT、启用 LAPIC、创建 idle 进程、开始接受调度
+// - 每 CPU 调度统计 (shell 的 cpus 命令)
+
+#define AP_STACK_SIZE 4096
+
+static cpu_t cpus[SMP_MAX_CPUS];
+static volatile uint32_t ap_boot_cpu = 0;   /* 正在启动的 AP 的逻辑编号 */
+
+extern uint8_t trampoline_start[];
+extern uint8_t trampoline_end[];
+extern uint8_t tramp_cr3[];
+extern uint8_t tramp_stack[];
+extern uint8_t tramp_entry[];
+
+cpu_t* smp_cpu(uint32_t index) {
+    return &cpus[index];
+}
+
+uint32_t smp_num_cpus(void) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        if (cpus[i].online) n++;
+    }
+    return n;
+}
+
+// 忙等 us 微秒 (启动阶段，关中断)
+static void udelay(uint32_t us) {
+    while (us) {
+        uint32_t chunk = us > 50000 ? 50000 : us;
+        pit_oneshot_start(chunk);
+        while (!pit_oneshot_expired()) { }
+        us -= chunk;
+    }
+}
+
+// trampoline 的数据字段 (复制后的位置)
+static void tramp_set(uint8_t* field, uint32_t value) {
+    *(volatile uint32_t*)(TRAMPOLINE_BASE + (uint32_t)(field - trampoline_start)) = value;
+}
+
+// AP 的 C 入口：运行在 BSP 为它分配的栈上，之后这条执行流就是本 CPU 的 idle 进程
+static void ap_main(void) {
+    uint32_t id = ap_boot_cpu;
+
+    gdt_init_cpu(id, 0);    /* 同时把 GS 指向 cpus[id] */
+    idt_load();
+    syscall_init();         /* SYSENTER MSR 是每个 CPU 各自的 */
+    fpu_init();             /* CR0/CR4 也是每个 CPU 各自的 */
+    lapic_enable();
+
+    char name[] = "idle/0";
+    name[5] = '0' + id;
+    process_create_idle(name);
+
+    apic_timer_start_ap();
+    cpus[id].online = 1;
+
+    local_irq_enable();
+    while (1) {
+        asm volatile("hlt");
+    }
+}
+
+static int smp_boot_ap(uint32_t cpu, uint32_t apic_id) {
+    cpu_t* c = &cpus[cpu];
+    c->apic_id = apic_id;
+
+    uint8_t* stack = (uint8_t*)kmalloc(AP_STACK_SIZE);
+    if (!stack) return 0;
+    tramp_set(tramp_stack, (uint32_t)stack + AP_STACK_SIZE);
+    ap_boot_cpu = cpu;
+
+    /* Intel MP 规范的启动序列：INIT，等 10ms，SIPI，等 200us，必要时再发一次 SIPI */
+    apic_send_ipi(apic_id, APIC_ICR_INIT);
+    udelay(10000);
+    apic_send_ipi(apic_id, APIC_ICR_STARTUP | (TRAMPOLINE_BASE >> 12));
+    udelay(200);
+    if (!c->online) {
+        apic_send_ipi(apic_id, APIC_ICR_STARTUP | (TRAMPOLINE_BASE >> 12));
+    }
+
+    /* 最多等 100ms */
+    for (int i = 0; i < 100 && !c->online; i++) udelay(1000);
+    return c->online;
+}
+
+void smp_init(void) {
+    if (!apic_enabled()) {
+        printk(KERN_INFO, "SMP: APIC unavailable, running on BSP only\n");
+        return;
+    }
+    cpus[0].apic_id = apic_id();
+
+    /* 复制 trampoline 到 0x8000 (低于 1MB 且位于恒等映射区，PMM 已保留该区域) */
+    uint32_t size = (uint32_t)(trampoline_end - trampoline_start);
+    for (uint32_t i = 0; i < size; i++) {
+        ((volatile uint8_t*)TRAMPOLINE_BASE)[i] = trampoline_start[i];
+    }
+    uint32_t cr3;
+    asm volatile("mov %%cr3, %0" : "=r"(cr3));
+    tramp_set(tramp_cr3, cr3);
+    tramp_set(tramp_entry, (uint32_t)ap_main);
+
+    uint32_t next = 1;
+    for (uint32_t i = 0; i < apic_cpu_count() && next < SMP_MAX_CPUS; i++) {
+        uint32_t id = apic_cpu_apic_id(i);
+        if (id == cpus[0].apic_id) continue;
+        if (smp_boot_ap(next, id)) {
+            next++;
+        } else {
+            printk(KERN_WARNING, "SMP: CPU with APIC ID %u did not start\n", id);
+        }
+    }
+
+    printk(KERN_INFO, "SMP: %u CPU(s) online\n", smp_num_cpus());
+}
+
+void smp_dump(void) {
+    terminal_writestring("CPU APIC  RUNQ  SWITCH  STEAL  PULL  IDLE%  FPU-NM  FXRSTOR\n");
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        cpu_t* c = &cpus[i];
+        if (!c->online) continue;
+        terminal_writedec(c->id);
+        terminal_writestring("   ");
+        terminal_writedec(c->apic_id);
+        terminal_writestring("     ");
+        terminal_writedec(c->nr_running);
+        terminal_writestring("     ");
+        terminal_writedec(c->nr_switches);
+        terminal_writestring("  ");
+        terminal_writedec(c->nr_steals);
+        terminal_writestring("  ");
+        terminal_writedec(c->nr_pulled);
+        terminal_writestring("  ");
+        terminal_writedec(c->sched_ticks ? c->idle_ticks * 100 / c->sched_ticks : 0);
+        terminal_writestring("  ");
+        terminal_writedec(c->nr_fpu_traps);
+        terminal_writestring("  ");
+        terminal_writedec(c->nr_fpu_restores);
+        terminal_putchar('\n');
+    }
+}
@@ -0,0 +1,82 @@
+/**
+ * smp.h - 对称多处理 (SMP)：AP 启动与每 CPU 数据
+ *
+ * 开机时只有一个 CPU (BSP, Bootstrap Processor) 在运行，其余核心 (AP, Application
+ * Processor) 停在等待状态，需要 BSP 通过 LAPIC 发送 INIT + SIPI 核间中断唤醒。
+ * AP 醒来时处于实模式，从 SIPI 指定的 4KB 对齐物理页开始执行 (trampoline.asm)。
+ *
+ * 每 CPU 数据 (Per-CPU Data)：
+ * 每个 CPU 拥有自己的 GDT，其中第 6 项 (选择子 0x30) 是一个基址指向本 CPU cpu_t 的
+ * 数据段。内核入口统一把 GS 设为 0x30，于是 %gs:0 在不同 CPU 上读到的是各自的
+ * cpu_t.self —— 不需要查 APIC ID，也不需要任何锁。
+ *
+ * @see [smp.md](doc/smp.md)
+ */
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+#include "spinlock.h"
+
+#define SMP_MAX_CPUS      8
+#define GDT_PERCPU_SEL    0x30    /* 每 CPU 数据段选择子 (GDT 第 6 项) */
+#define TRAMPOLINE_BASE   0x8000  /* AP 实模式入口 (SIPI 向量 0x08) */
+
+struct process;
+
+typedef struct cpu {
+    struct cpu* self;              /* 必须是第一个成员：this_cpu() 读取 %gs:0 */
+    uint32_t id;                   /* 逻辑编号 0..n-1，0 为 BSP */
+    uint32_t apic_id;
+    volatile uint32_t online;
+
+    /* 调度相关 (process.c) */
+    struct process* current;       /* 本 CPU 正在运行的进程 */
+    struct process* idle;          /* 本 CPU 的 idle 进程，不进入运行队列 */
+    struct process* prev;          /* 刚被切走的进程，切换完成后清除其 on_cpu */
+    spinlock_t rq_lock;
+    struct process* rq_head;       /* 运行队列 (FIFO)：不含 current 与 idle */
+    struct process* rq_tail;
+    volatile uint32_t nr_running;  /* 运行队列长度 */
+    volatile uint32_t need_resched;
+    uint32_t sched_ticks;          /* 本 CPU 收到的时钟中断次数 */
+    uint32_t last_balance;
+    uint32_t sysenter_esp;         /* 当前写入 MSR_SYSENTER_ESP 的值 (syscall.c) */
+    struct process* fpu_owner;     /* FPU 寄存器中是哪个任务的状态 (fpu.c) */
+
+    /* 统计 */
+    uint32_t nr_switches;
+    uint32_t nr_steals;            /* 空闲时从其他 CPU 偷来的任务数 */
+    uint32_t nr_pulled;            /* 周期性负载均衡迁入的任务数 */
+    uint32_t idle_ticks;
+    uint32_t nr_fpu_traps;         /* #NM 次数 */
+    uint32_t nr_fpu_restores;      /* 其中真正执行 FXRSTOR 的次数 */
+} cpu_t;
+
+/* 当前 CPU 的 cpu_t (通过 GS 段基址，一条指令) */
+static inline cpu_t* this_cpu(void) {
+    cpu_t* c;
+    asm volatile("mov %%gs:0, %0" : "=r"(c));
+    return c;
+}
+
+static inline uint32_t smp_processor_id(void) {
+    return this_cpu()->id;
+}
+
+/* 第 i 个 CPU 的 cpu_t (gdt_init_cpu 用它作为 GS 段基址) */
+cpu_t* smp_cpu(uint32_t index);
+
+/* 已上线的 CPU 数量 */
+uint32_t smp_num_cpus(void);
+
+/*
+ * 启动 MADT 中列出的所有 AP (需在 apic_init、process_init 之后调用)。
+ * APIC 不可用时什么都不做。
+ */
+void smp_init(void);
+
+/* 打印每个 CPU 的调度统计 (shell 的 cpus 命令) */
+void smp_dump(void);
+
+#endif
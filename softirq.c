@@ -0,0 +1,103 @@
+#include "softirq.h"
+#include "smp.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 软中断向量表与待处理位图 (softirq_pending)
+// - do_softirq：在中断退出路径上开中断执行下半部，最多重复 MAX_SOFTIRQ_RESTART 轮
+// - Tasklet：挂在 TASKLET_SOFTIRQ 上的动态下半部
+//
+// 为什么要限制轮数？下半部执行期间中断是开着的，设备可能源源不断地产生新事件。
+// 如果一直处理到位图清零，被中断的任务可能永远得不到 CPU；超过轮数后剩余的
+// 位留在本 CPU 的位图里，由本 CPU 的下一次中断（至少是下一个时钟节拍）接着处理。
+// 不交给工作队列：worker 不绑定 CPU，它在别的 CPU 上只能看到那个 CPU 的位图，
+// 而每 CPU 的位图与 tasklet 链表只靠关本地中断保护，不能跨 CPU 代为处理。
+//
+// SMP：待处理位图、嵌套标志与 tasklet 链表都是每 CPU 的 ——
+// 软中断在哪个 CPU 上触发就在哪个 CPU 上执行，访问它们只需关本地中断，不需要锁。
+
+static softirq_action_t softirq_vec[NR_SOFTIRQS];
+static volatile uint32_t softirq_pending[SMP_MAX_CPUS];
+static volatile uint32_t softirq_active[SMP_MAX_CPUS];
+
+static tasklet_t* tasklet_head[SMP_MAX_CPUS];
+
+void open_softirq(uint32_t nr, softirq_action_t action) {
+    if (nr < NR_SOFTIRQS) softirq_vec[nr] = action;
+}
+
+void raise_softirq(uint32_t nr) {
+    uint32_t flags = local_irq_save();
+    softirq_pending[smp_processor_id()] |= (1u << nr);
+    local_irq_restore(flags);
+}
+
+int in_softirq(void) {
+    return softirq_active[smp_processor_id()];
+}
+
+void do_softirq(void) {
+    /* 关中断期间不会被调度走，cpu 编号在整个函数内有效
+       (下半部开中断执行时也禁止切换进程，见 irq_handler) */
+    uint32_t cpu = smp_processor_id();
+
+    /* 嵌套保护：下半部执行期间到来的中断不会再次进入这里 */
+    if (softirq_active[cpu] || !softirq_pending[cpu]) return;
+    softirq_active[cpu] = 1;
+
+    uint32_t restart = MAX_SOFTIRQ_RESTART;
+    do {
+        uint32_t pending = softirq_pending[cpu];
+        softirq_pending[cpu] = 0;
+
+        local_irq_enable();
+        for (uint32_t nr = 0; pending; nr++, pending >>= 1) {
+            if ((pending & 1) && softirq_vec[nr]) softirq_vec[nr]();
+        }
+        local_irq_disable();
+    } while (softirq_pending[cpu] && --restart);
+
+    /* 轮数用完仍有 pending：原样留给本 CPU 的下一次中断退出 */
+    softirq_active[cpu] = 0;
+}
+
+// TASKLET_SOFTIRQ：一次性摘下整条链表再逐个执行，
+// 执行期间新调度的 tasklet 会进入新链表，留到下一轮。
+static void tasklet_action(void) {
+    uint32_t flags = local_irq_save();
+    uint32_t cpu = smp_processor_id();
+    tasklet_t* list = tasklet_head[cpu];
+    tasklet_head[cpu] = NULL;
+    local_irq_restore(flags);
+
+    while (list) {
+        tasklet_t* t = list;
+        list = t->next;
+        t->next = NULL;
+        t->scheduled = 0;   /* 先清标记：执行期间可以再次被调度 */
+        t->func(t->data);
+    }
+}
+
+void tasklet_init(tasklet_t* t, void (*func)(void* data), void* data) {
+    t->next = NULL;
+    t->scheduled = 0;
+    t->func = func;
+    t->data = data;
+}
+
+void tasklet_schedule(tasklet_t* t) {
+    uint32_t flags = local_irq_save();
+    /* xchg 原子地检查并设置：同一 tasklet 只会挂到一个 CPU 的链表上 */
+    if (__sync_lock_test_and_set(&t->scheduled, 1) == 0) {
+        uint32_t cpu = smp_processor_id();
+        t->next = tasklet_head[cpu];
+        tasklet_head[cpu] = t;
+        softirq_pending[cpu] |= (1u << TASKLET_SOFTIRQ);
+    }
+    local_irq_restore(flags);
+}
+
+void softirq_init(void) {
+    open_softirq(TASKLET_SOFTIRQ, tasklet_action);
+}
@@ -0,0 +1,59 @@
+/**
+ * softirq.h - 软中断 (Softirq) 与 Tasklet：中断的“下半部” (Bottom Half)
+ *
+ * 硬件中断处理分成两半：
+ * - 上半部 (Top Half / Hard IRQ)：在关中断的 irq_handler 里运行，只做必须立即完成的事
+ *   （读设备寄存器、应答中断、记录事件），然后 raise_softirq() 标记“还有活要干”；
+ * - 下半部 (Bottom Half / Softirq)：在中断退出前、**开中断**的环境中运行，
+ *   处理真正耗时的部分。这期间新的硬件中断可以随时打断它。
+ *
+ * 这样，无论设备处理函数做多少事，关中断的时间都只取决于上半部的长度。
+ *
+ * @see [irq_softirq.md](doc/irq_softirq.md)
+ */
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include <stdint.h>
+
+/* 软中断编号：数值越小优先级越高 (按位从低到高依次执行) */
+#define TIMER_SOFTIRQ    0   /* 时钟下半部：进程休眠计时、异步任务定时器 */
+#define TASKLET_SOFTIRQ  1   /* 执行已调度的 tasklet */
+#define NR_SOFTIRQS      2
+
+/* 一次中断退出最多重复处理几轮新产生的软中断，超出部分留给本 CPU 的下一次中断 */
+#define MAX_SOFTIRQ_RESTART 10
+
+typedef void (*softirq_action_t)(void);
+
+/*
+ * Tasklet：动态注册的下半部。同一个 tasklet 在执行前被多次调度只会执行一次。
+ */
+typedef struct tasklet {
+    struct tasklet* next;
+    volatile uint32_t scheduled;   /* 1 表示已在待执行链表中 */
+    void (*func)(void* data);
+    void* data;
+} tasklet_t;
+
+/* 注册软中断处理函数 (启动阶段调用) */
+void open_softirq(uint32_t nr, softirq_action_t action);
+
+/* 标记软中断待处理 (通常在硬中断上半部中调用) */
+void raise_softirq(uint32_t nr);
+
+/* 处理所有待处理的软中断：要求调用时关中断，返回时仍是关中断 */
+void do_softirq(void);
+
+/* 当前是否正在执行软中断 (此时不允许切换进程) */
+int in_softirq(void);
+
+/* 初始化软中断子系统 (注册 TASKLET_SOFTIRQ) */
+void softirq_init(void);
+
+void tasklet_init(tasklet_t* t, void (*func)(void* data), void* data);
+
+/* 调度 tasklet，可在中断上下文调用 */
+void tasklet_schedule(tasklet_t* t);
+
+#endif
@@ -0,0 +1,149 @@
+#include "spinlock.h"
+#include "terminal.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 锁统计钩子：获取/释放/恢复中断时由 spinlock.h 的内联函数调用
+// - 全局锁链表：静态定义的锁在第一次被获取时自动登记，无需显式注册
+// - lockstat 报表
+//
+// 统计字段只在持锁期间修改，本身就受这把锁保护，不需要额外同步；
+// 只有“登记到全局链表”会在不同锁之间竞争，用 cmpxchg 无锁插入；
+// 跨所有锁的最长关中断区间 (长度 + 锁名) 是一对全局变量，任何 CPU 释放任何锁时都可能更新，
+// 由一个裸的 test-and-set 标志保护，保证报表里的长度和锁名来自同一次记录。
+// (统计代码不能再使用 spinlock_t，否则会递归进入自己。)
+
+#ifdef CONFIG_LOCK_STAT
+
+static spinlock_t* volatile lock_list = NULL;
+
+/* 全局最长关中断区间 (跨所有锁)，两个字段只在持有 irqsoff_max_lock 时读写 */
+static uint32_t irqsoff_max_all = 0;
+static const char* irqsoff_max_name = NULL;
+static volatile uint32_t irqsoff_max_lock = 0;
+
+/* 调用者必须已关中断：否则持有标志时被本 CPU 的中断打断、中断里再释放 irqsave 锁就会自旋死锁 */
+static void irqsoff_max_acquire(void) {
+    while (__sync_lock_test_and_set(&irqsoff_max_lock, 1)) {
+        while (irqsoff_max_lock) asm volatile("pause" : : : "memory");
+    }
+}
+
+static void irqsoff_max_release(void) {
+    __sync_lock_release(&irqsoff_max_lock);
+}
+
+static void lock_stat_register(spinlock_t* lock) {
+    if (__sync_lock_test_and_set(&lock->stat.registered, 1)) return;
+    spinlock_t* head;
+    do {
+        head = lock_list;
+        lock->stat.next = head;
+    } while (!__sync_bool_compare_and_swap(&lock_list, head, lock));
+}
+
+void lock_stat_acquired(spinlock_t* lock, int contended) {
+    struct lock_stat* st = &lock->stat;
+    if (!st->registered) lock_stat_register(lock);
+    st->acquired++;
+    if (contended) st->contended++;
+    st->hold_start = rdtsc();
+}
+
+void lock_stat_release(spinlock_t* lock) {
+    struct lock_stat* st = &lock->stat;
+    uint64_t hold = rdtsc() - st->hold_start;
+    st->hold_total += hold;
+    uint32_t h = (hold >> 32) ? 0xFFFFFFFF : (uint32_t)hold;
+    if (h > st->hold_max) st->hold_max = h;
+}
+
+// 只在真正恢复到开中断 (IF=1) 时记录：嵌套在更外层关中断区间里的那一段不算独立区间
+void lock_stat_irqrestore(spinlock_t* lock, uint32_t flags) {
+    if (!(flags & 0x200)) return;
+    struct lock_stat* st = &lock->stat;
+    uint64_t off = rdtsc() - st->irqsoff_start;
+    uint32_t o = (off >> 32) ? 0xFFFFFFFF : (uint32_t)off;
+    if (o > st->irqsoff_max) st->irqsoff_max = o;
+    /* 先无锁地比较一次：绝大多数释放都刷新不了全局最大值，不必碰共享的标志 */
+    if (o > irqsoff_max_all) {
+        irqsoff_max_acquire();   /* 仍在 irqsave 区间里，中断是关的 */
+        if (o > irqsoff_max_all) {
+            irqsoff_max_all = o;
+            irqsoff_max_name = lock->name;
+        }
+        irqsoff_max_release();
+    }
+}
+
+static void print_padded(const char* s, int width) {
+    int n = 0;
+    if (!s) s = "?";
+    while (s[n]) n++;
+    terminal_writestring(s);
+    while (n++ < width) terminal_putchar(' ');
+}
+
+static void print_num(uint32_t v, int width) {
+    char buf[11];
+    int i = 11;
+    do { buf[--i] = '0' + (v % 10); v /= 10; } while (v);
+    for (int pad = width - (11 - i); pad > 0; pad--) terminal_putchar(' ');
+    terminal_write(&buf[i], 11 - i);
+}
+
+void lockstat_dump(void) {
+    terminal_writestring("LOCK          ACQUIRED  CONTENDED   HOLD-AVG   HOLD-MAX  IRQOFF-MAX (cycles)\n");
+    for (spinlock_t* l = lock_list; l; l = l->stat.next) {
+        struct lock_stat* st = &l->stat;
+        uint32_t avg = st->acquired ? (uint32_t)div_u64(st->hold_total, st->acquired) : 0;
+        print_padded(l->name, 12);
+        print_num(st->acquired, 10);
+        print_num(st->contended, 11);
+        print_num(avg, 11);
+        print_num(st->hold_max, 11);
+        print_num(st->irqsoff_max, 12);
+        terminal_putchar('\n');
+    }
+    /* 在标志保护下取一份快照再打印：打印会拿终端的锁，不能在持有标志时进行 */
+    uint32_t flags = local_irq_save();
+    irqsoff_max_acquire();
+    uint32_t max_all = irqsoff_max_all;
+    const char* max_name = irqsoff_max_name;
+    irqsoff_max_release();
+    local_irq_restore(flags);
+
+    terminal_writestring("Longest irqs-off section: ");
+    terminal_writedec(max_all);
+    terminal_writestring(" cycles (");
+    terminal_writestring(max_name ? max_name : "-");
+    terminal_writestring(")\n");
+}
+
+void lockstat_reset(void) {
+    for (spinlock_t* l = lock_list; l; l = l->stat.next) {
+        struct lock_stat* st = &l->stat;
+        st->acquired = 0;
+        st->contended = 0;
+        st->hold_total = 0;
+        st->hold_max = 0;
+        st->irqsoff_max = 0;
+    }
+    uint32_t flags = local_irq_save();
+    irqsoff_max_acquire();
+    irqsoff_max_all = 0;
+    irqsoff_max_name = NULL;
+    irqsoff_max_release();
+    local_irq_restore(flags);
+}
+
+#else
+
+void lockstat_dump(void) {
+    terminal_writestring("Lock statistics disabled (build with LOCK_STAT=1).\n");
+}
+
+void lockstat_reset(void) {
+}
+
+#endif
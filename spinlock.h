@@ -0,0 +1,138 @@
+/**
+ * spinlock.h - 排队自旋锁 (Ticket Spinlock) 与锁统计
+ *
+ * 单 CPU 时，关中断 (cli) 就足以保护共享数据：没有别的执行流能插进来。
+ * 多 CPU 时，其他核心会同时访问同一份数据，关本地中断挡不住它们，
+ * 必须再加一把所有 CPU 都能看见的锁。
+ *
+ * 为什么用 Ticket 锁而不是简单的 xchg 锁？
+ * xchg 锁释放时所有等待者一起抢，离锁所在缓存行“近”的 CPU 总是赢，
+ * 其他 CPU 可能被饿死。Ticket 锁像银行叫号：
+ * - 加锁：原子地取一个号 (next++)，然后等待 owner 叫到自己的号；
+ * - 解锁：owner++，叫下一个号。
+ * 等待者严格按到达顺序获得锁 (FIFO)，这就是“公平”。
+ *
+ * 使用约定：
+ * - 会被中断上下文访问的数据，一律使用 spin_lock_irqsave/spin_unlock_irqrestore，
+ *   否则持锁期间本 CPU 被中断打断、中断处理函数又去抢同一把锁，就会自己等自己 (死锁)；
+ * - 已经处于关中断环境 (中断处理函数、schedule) 时可以直接用 spin_lock/spin_unlock；
+ * - 持锁期间不能睡眠/让出 CPU。
+ *
+ * 锁统计 (可选，build.sh 中 LOCK_STAT=1 开启，对应 CONFIG_LOCK_STAT)：
+ * 每把锁记录获取次数、发生竞争的次数、最长/平均持有周期数，以及经由
+ * spin_lock_irqsave 关中断的最长时间。shell 命令 lockstat 打印报表。
+ *
+ * @see [spinlock.md](doc/spinlock.md)
+ */
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+#include "cpu.h"
+
+#ifdef CONFIG_LOCK_STAT
+struct lock_stat {
+    uint32_t acquired;          /* 获取次数 */
+    uint32_t contended;         /* 获取时锁已被占用的次数 */
+    uint64_t hold_total;        /* 累计持有周期 (平均值 = hold_total / acquired) */
+    uint32_t hold_max;          /* 最长持有周期 */
+    uint32_t irqsoff_max;       /* irqsave 版本中最长的关中断周期 */
+    uint64_t hold_start;        /* 本次获取的时刻 (持锁者写) */
+    uint64_t irqsoff_start;     /* 本次关中断的时刻 */
+    uint32_t registered;        /* 是否已加入全局锁链表 */
+    struct spinlock* next;      /* 全局锁链表 (lockstat 报表遍历) */
+};
+#endif
+
+typedef struct spinlock {
+    union {
+        volatile uint32_t head_tail;      /* 整体读写，供 trylock 的 cmpxchg 使用 */
+        struct {
+            volatile uint16_t owner;      /* 正在服务的号 */
+            volatile uint16_t next;       /* 下一个可取的号 */
+        } tickets;
+    };
+    const char* name;
+#ifdef CONFIG_LOCK_STAT
+    struct lock_stat stat;
+#endif
+} spinlock_t;
+
+#define SPINLOCK_INIT(n) { .head_tail = 0, .name = (n) }   /* 指定成员：LOCK_STAT 的 stat 自动清零 */
+
+static inline void spin_lock_init(spinlock_t* lock, const char* name) {
+    uint8_t* p = (uint8_t*)lock;
+    for (uint32_t i = 0; i < sizeof(spinlock_t); i++) p[i] = 0;
+    lock->name = name;
+}
+
+#ifdef CONFIG_LOCK_STAT
+/* 统计钩子 (spinlock.c)：都在持锁期间调用，统计字段本身由锁保护 */
+void lock_stat_acquired(spinlock_t* lock, int contended);
+void lock_stat_release(spinlock_t* lock);
+void lock_stat_irqrestore(spinlock_t* lock, uint32_t flags);
+#endif
+
+// 取号 (lock xadd)，然后只读等待叫到自己 (不产生总线锁定)
+static inline void spin_lock(spinlock_t* lock) {
+    uint16_t ticket = __sync_fetch_and_add(&lock->tickets.next, 1);
+    int contended = 0;
+    while (lock->tickets.owner != ticket) {
+        contended = 1;
+        asm volatile("pause" : : : "memory");
+    }
+    asm volatile("" : : : "memory");
+#ifdef CONFIG_LOCK_STAT
+    lock_stat_acquired(lock, contended);
+#else
+    (void)contended;
+#endif
+}
+
+// 只有锁空闲 (owner == next) 时才取号，用一次 cmpxchg 同时检查与取号
+static inline int spin_trylock(spinlock_t* lock) {
+    uint32_t old = lock->head_tail;
+    if ((old & 0xFFFF) != (old >> 16)) return 0;
+    if (!__sync_bool_compare_and_swap(&lock->head_tail, old, old + 0x10000)) return 0;
+#ifdef CONFIG_LOCK_STAT
+    lock_stat_acquired(lock, 0);
+#endif
+    return 1;
+}
+
+// owner 只由持锁者修改，普通的加一即可；x86 的写不会与之前的读写重排
+static inline void spin_unlock(spinlock_t* lock) {
+#ifdef CONFIG_LOCK_STAT
+    lock_stat_release(lock);
+#endif
+    asm volatile("" : : : "memory");
+    lock->tickets.owner++;
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t flags = local_irq_save();
+#ifdef CONFIG_LOCK_STAT
+    uint64_t off = rdtsc();
+    spin_lock(lock);
+    lock->stat.irqsoff_start = off;
+#else
+    spin_lock(lock);
+#endif
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags) {
+#ifdef CONFIG_LOCK_STAT
+    lock_stat_irqrestore(lock, flags);
+#endif
+    spin_unlock(lock);
+    local_irq_restore(flags);
+}
+
+/* 打印所有被使用过的锁的统计 (shell 的 lockstat 命令) */
+void lockstat_dump(void);
+
+/* 清零所有锁的统计 */
+void lockstat_reset(void);
+
+#endif
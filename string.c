@@ -1,4 +1,17 @@
 #include "string.h"
+#include "cpu.h"
+#include "alternative.h"
+#include "printk.h"
+
+// 本文件负责：
+// - 字符串函数 (strlen/strcmp/strcpy)
+// - memcpy/memmove/memset/memcmp：按长度分档，各档的实现在启动时按 CPU 特性修补选定
+// - SSE 区间 (sse_begin/sse_end)：在内核里安全地借用 xmm0..xmm3
+
+#define MEM_SMALL       64              /* 以下按 32 位字循环 */
+#define MEM_SSE_MIN     2048            /* 以上使用 SSE2 (关中断、改 CR0.TS 有固定开销，小块不划算) */
+#define MEM_NT_MIN      (256 * 1024)    /* 以上使用非临时写 (大于 L2，写进缓存也会被挤出去) */
+#define MEM_SSE_CHUNK   (64 * 1024)     /* SSE 区间每段最多处理的字节数 (关中断的最长时间) */
 
 size_t strlen(const char* str) {
     size_t len = 0;
@@ -21,9 +34,290 @@ char* strcpy(char* dest, const char* src) {
     return dest;
 }
 
-void* memset(void* ptr, int value, size_t num) {
-    unsigned char* p = ptr;
-    while (num--)
-        *p++ = (unsigned char)value;
+/* ---------------------------------------------------------------------------
+ * SSE 区间：关中断 (不会被抢占，也不会有中断处理函数插进来)，TS 置位时临时清除
+ * (否则第一条 SSE 指令触发 #NM，把当前任务的状态装进来)，xmm0..xmm3 先存到栈上。
+ * 结束时恢复寄存器和 TS：FPU 寄存器里仍是原来那个任务的状态，惰性切换察觉不到。
+ * 内核栈只保证 4 字节对齐 (gcc 却假定 16 字节)，保存区用 movdqu 访问。
+ * ------------------------------------------------------------------------- */
+
+struct sse_save {
+    uint8_t xmm[4][16];
+};
+
+static inline uint32_t sse_begin(struct sse_save* s, uint32_t* cr0) {
+    uint32_t flags = local_irq_save();
+    *cr0 = read_cr0();
+    if (*cr0 & CR0_TS) clts();
+    asm volatile("movdqu %%xmm0, 0(%0)\n\t"
+                 "movdqu %%xmm1, 16(%0)\n\t"
+                 "movdqu %%xmm2, 32(%0)\n\t"
+                 "movdqu %%xmm3, 48(%0)"
+                 : : "r"(s) : "memory");
+    return flags;
+}
+
+static inline void sse_end(struct sse_save* s, uint32_t cr0, uint32_t flags) {
+    asm volatile("movdqu 0(%0), %%xmm0\n\t"
+                 "movdqu 16(%0), %%xmm1\n\t"
+                 "movdqu 32(%0), %%xmm2\n\t"
+                 "movdqu 48(%0), %%xmm3"
+                 : : "r"(s) : "memory");
+    if (cr0 & CR0_TS) write_cr0(cr0);
+    local_irq_restore(flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * memcpy 的各个实现 (都是从前往后拷贝)
+ * ------------------------------------------------------------------------- */
+
+void* memcpy_words(void* dst, const void* src, size_t n) {
+    uint32_t* d = dst;
+    const uint32_t* s = src;
+    for (; n >= 4; n -= 4) *d++ = *s++;
+    uint8_t* db = (uint8_t*)d;
+    const uint8_t* sb = (const uint8_t*)s;
+    while (n--) *db++ = *sb++;
+    return dst;
+}
+
+void* memcpy_movsd(void* dst, const void* src, size_t n) {
+    void* d = dst;
+    uint32_t dwords = n >> 2;
+    asm volatile("rep movsl\n\t"
+                 "mov %3, %%ecx\n\t"
+                 "rep movsb"
+                 : "+D"(d), "+S"(src), "+c"(dwords)
+                 : "r"(n & 3)
+                 : "memory");
+    return dst;
+}
+
+void* memcpy_movsb(void* dst, const void* src, size_t n) {
+    void* d = dst;
+    asm volatile("rep movsb" : "+D"(d), "+S"(src), "+c"(n) : : "memory");
+    return dst;
+}
+
+// 调用者已进入 SSE 区间，d 按 16 字节对齐：每次 4 个 movdqu 读、4 个对齐写，共 64 字节
+static inline void sse2_copy64(uint8_t* d, const uint8_t* s, size_t blocks, int nt) {
+    if (nt) {
+        asm volatile("1:\n\t"
+                     "movdqu 0(%1), %%xmm0\n\t"
+                     "movdqu 16(%1), %%xmm1\n\t"
+                     "movdqu 32(%1), %%xmm2\n\t"
+                     "movdqu 48(%1), %%xmm3\n\t"
+                     "movntdq %%xmm0, 0(%0)\n\t"
+                     "movntdq %%xmm1, 16(%0)\n\t"
+                     "movntdq %%xmm2, 32(%0)\n\t"
+                     "movntdq %%xmm3, 48(%0)\n\t"
+                     "add $64, %1\n\t"
+                     "add $64, %0\n\t"
+                     "dec %2\n\t"
+                     "jnz 1b\n\t"
+                     "sfence"           /* 非临时写是弱序的，离开前保证全部可见 */
+                     : "+r"(d), "+r"(s), "+r"(blocks) : : "memory", "cc");
+    } else {
+        asm volatile("1:\n\t"
+                     "movdqu 0(%1), %%xmm0\n\t"
+                     "movdqu 16(%1), %%xmm1\n\t"
+                     "movdqu 32(%1), %%xmm2\n\t"
+                     "movdqu 48(%1), %%xmm3\n\t"
+                     "movdqa %%xmm0, 0(%0)\n\t"
+                     "movdqa %%xmm1, 16(%0)\n\t"
+                     "movdqa %%xmm2, 32(%0)\n\t"
+                     "movdqa %%xmm3, 48(%0)\n\t"
+                     "add $64, %1\n\t"
+                     "add $64, %0\n\t"
+                     "dec %2\n\t"
+                     "jnz 1b"
+                     : "+r"(d), "+r"(s), "+r"(blocks) : : "memory", "cc");
+    }
+}
+
+// 先按字节拷到目标 16 字节对齐，中间按 64 字节块分段进入 SSE 区间，剩余部分用 rep movsd
+static void* memcpy_sse(void* dst, const void* src, size_t n, int nt) {
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+    size_t head = (16 - ((uint32_t)d & 15)) & 15;
+    if (head > n) head = n;
+    memcpy_words(d, s, head);
+    d += head; s += head; n -= head;
+
+    while (n >= 64) {
+        size_t bytes = n < MEM_SSE_CHUNK ? (n & ~(size_t)63) : MEM_SSE_CHUNK;
+        struct sse_save save;
+        uint32_t cr0;
+        uint32_t flags = sse_begin(&save, &cr0);
+        sse2_copy64(d, s, bytes / 64, nt);
+        sse_end(&save, cr0, flags);
+        d += bytes; s += bytes; n -= bytes;
+    }
+    if (n) memcpy_movsd(d, s, n);
+    return dst;
+}
+
+void* memcpy_sse2(void* dst, const void* src, size_t n) {
+    return memcpy_sse(dst, src, n, 0);
+}
+
+void* memcpy_nt(void* dst, const void* src, size_t n) {
+    return memcpy_sse(dst, src, n, 1);
+}
+
+/* ---------------------------------------------------------------------------
+ * memset 的各个实现
+ * ------------------------------------------------------------------------- */
+
+static void* memset_words(void* ptr, uint32_t pattern, size_t n) {
+    uint32_t* p = ptr;
+    for (; n >= 4; n -= 4) *p++ = pattern;
+    uint8_t* pb = (uint8_t*)p;
+    while (n--) *pb++ = (uint8_t)pattern;
     return ptr;
-}
\ No newline at end of file
+}
+
+static void* memset_stosd(void* ptr, uint32_t pattern, size_t n) {
+    void* p = ptr;
+    uint32_t dwords = n >> 2;
+    asm volatile("rep stosl\n\t"
+                 "mov %3, %%ecx\n\t"
+                 "rep stosb"
+                 : "+D"(p), "+c"(dwords)
+                 : "a"(pattern), "r"(n & 3)
+                 : "memory");
+    return ptr;
+}
+
+static void* memset_stosb(void* ptr, uint32_t pattern, size_t n) {
+    void* p = ptr;
+    asm volatile("rep stosb" : "+D"(p), "+c"(n) : "a"(pattern) : "memory");
+    return ptr;
+}
+
+static void* memset_sse(void* ptr, uint32_t pattern, size_t n, int nt) {
+    uint8_t* p = ptr;
+    size_t head = (16 - ((uint32_t)p & 15)) & 15;
+    if (head > n) head = n;
+    memset_words(p, pattern, head);
+    p += head; n -= head;
+
+    while (n >= 64) {
+        size_t bytes = n < MEM_SSE_CHUNK ? (n & ~(size_t)63) : MEM_SSE_CHUNK;
+        size_t blocks = bytes / 64;
+        uint8_t* d = p;
+        struct sse_save save;
+        uint32_t cr0;
+        uint32_t flags = sse_begin(&save, &cr0);
+        /* pattern 广播到 xmm0 的 4 个双字 */
+        asm volatile("movd %0, %%xmm0\n\t"
+                     "pshufd $0, %%xmm0, %%xmm0" : : "r"(pattern));
+        if (nt) {
+            asm volatile("1:\n\t"
+                         "movntdq %%xmm0, 0(%0)\n\t"
+                         "movntdq %%xmm0, 16(%0)\n\t"
+                         "movntdq %%xmm0, 32(%0)\n\t"
+                         "movntdq %%xmm0, 48(%0)\n\t"
+                         "add $64, %0\n\t"
+                         "dec %1\n\t"
+                         "jnz 1b\n\t"
+                         "sfence"
+                         : "+r"(d), "+r"(blocks) : : "memory", "cc");
+        } else {
+            asm volatile("1:\n\t"
+                         "movdqa %%xmm0, 0(%0)\n\t"
+                         "movdqa %%xmm0, 16(%0)\n\t"
+                         "movdqa %%xmm0, 32(%0)\n\t"
+                         "movdqa %%xmm0, 48(%0)\n\t"
+                         "add $64, %0\n\t"
+                         "dec %1\n\t"
+                         "jnz 1b"
+                         : "+r"(d), "+r"(blocks) : : "memory", "cc");
+        }
+        sse_end(&save, cr0, flags);
+        p += bytes; n -= bytes;
+    }
+    if (n) memset_stosd(p, pattern, n);
+    return ptr;
+}
+
+static void* memset_sse2(void* ptr, uint32_t pattern, size_t n) {
+    return memset_sse(ptr, pattern, n, 0);
+}
+
+static void* memset_nt(void* ptr, uint32_t pattern, size_t n) {
+    return memset_sse(ptr, pattern, n, 1);
+}
+
+/* ---------------------------------------------------------------------------
+ * 分档与选择
+ * ------------------------------------------------------------------------- */
+
+// 各档的实现由 static_cpu_has 在启动时修补选定：运行时只有长度比较，没有特性判断。
+// alternatives_apply 之前 (以及没有 SSE2 时) 各档都用 rep 指令
+void* memcpy(void* dst, const void* src, size_t n) {
+    if (n < MEM_SMALL) return memcpy_words(dst, src, n);
+    if (n >= MEM_SSE_MIN && static_cpu_has(X86_FEATURE_SSE2)) {
+        return n < MEM_NT_MIN ? memcpy_sse2(dst, src, n) : memcpy_nt(dst, src, n);
+    }
+    if (static_cpu_has(X86_FEATURE_ERMS)) return memcpy_movsb(dst, src, n);
+    return memcpy_movsd(dst, src, n);
+}
+
+void* memset(void* ptr, int value, size_t num) {
+    uint32_t pattern = (uint8_t)value * 0x01010101u;
+    if (num < MEM_SMALL) return memset_words(ptr, pattern, num);
+    if (num >= MEM_SSE_MIN && static_cpu_has(X86_FEATURE_SSE2)) {
+        return num < MEM_NT_MIN ? memset_sse2(ptr, pattern, num) : memset_nt(ptr, pattern, num);
+    }
+    if (static_cpu_has(X86_FEATURE_ERMS)) return memset_stosb(ptr, pattern, num);
+    return memset_stosd(ptr, pattern, num);
+}
+
+// 重叠时按方向逐字拷贝。目标在源之前且相距至少 64 字节时仍可用 memcpy：
+// 它的每种实现都是从前往后、每次最多先读 64 字节再写，写入追不上还没读的源数据
+void* memmove(void* dst, const void* src, size_t n) {
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+    if (d == s || n == 0) return dst;
+    if (d + n <= s || s + n <= d || (d < s && (size_t)(s - d) >= MEM_SMALL)) {
+        return memcpy(dst, src, n);
+    }
+    if (d < s) {
+        if (s - d >= 4) return memcpy_words(dst, src, n);
+        while (n--) *d++ = *s++;
+    } else {
+        d += n; s += n;
+        if (d - s >= 4) {
+            for (; n >= 4; n -= 4) {
+                d -= 4; s -= 4;
+                *(uint32_t*)d = *(const uint32_t*)s;
+            }
+        }
+        while (n--) *--d = *--s;
+    }
+    return dst;
+}
+
+// 按 32 位字比较，遇到不同的字再逐字节找出第一个不同的位置
+int memcmp(const void* s1, const void* s2, size_t n) {
+    const uint8_t* a = s1;
+    const uint8_t* b = s2;
+    for (; n >= 4; n -= 4, a += 4, b += 4) {
+        if (*(const uint32_t*)a != *(const uint32_t*)b) break;
+    }
+    for (; n; n--, a++, b++) {
+        if (*a != *b) return *a - *b;
+    }
+    return 0;
+}
+
+void string_init(void) {
+    const char* rep = cpu_has(X86_FEATURE_ERMS) ? "rep movsb/stosb (ERMS)" : "rep movsd/stosd";
+    if (cpu_has(X86_FEATURE_SSE2)) {
+        printk(KERN_INFO, "string: %s below %u B, SSE2 above, non-temporal from %u KB\n",
+               rep, MEM_SSE_MIN, MEM_NT_MIN / 1024);
+    } else {
+        printk(KERN_INFO, "string: %s from %u B (no SSE2)\n", rep, MEM_SMALL);
+    }
+}
@@ -1,3 +1,20 @@
+/**
+ * string.h - 字符串与内存操作
+ *
+ * memcpy/memset 按长度分成几档，每档用各自最快的实现：
+ * - < 64 字节：按 32 位字循环 (rep 指令的启动开销比拷贝本身还大)；
+ * - < 2KB：rep movsd/stosd，CPU 支持 ERMS (增强的 rep movsb/stosb) 时改用按字节的 rep 指令；
+ * - < 256KB：SSE2，每次 64 字节 (4 个 XMM 寄存器)，目标按 16 字节对齐；
+ * - 更大：SSE2 非临时写 (movntdq)，写入绕过缓存，不把缓存里有用的数据挤出去。
+ * 用哪种实现由 static_cpu_has (alternative.h) 在启动时修补决定，运行时不再判断 CPU 特性；
+ * 修补之前 (以及不支持 SSE2 的 CPU) 一律走 rep 指令。
+ *
+ * 内核里用 XMM 寄存器要小心：寄存器里可能是某个任务的 FPU 状态 (惰性切换，见 fpu.h)。
+ * SSE 路径每段 (最多 64KB) 关中断，临时清除 CR0.TS，把用到的 xmm0..xmm3 存到栈上，
+ * 用完恢复，寄存器里原来是谁的状态就还是谁的。中断处理函数中调用也是安全的。
+ *
+ * @see [memcpy.md](doc/memcpy.md)
+ */
 #ifndef STRING_H
 #define STRING_H
 
@@ -7,6 +24,20 @@
 size_t strlen(const char* str);
 int strcmp(const char* s1, const char* s2);
 char* strcpy(char* dest, const char* src);
+
+void* memcpy(void* dst, const void* src, size_t n);     /* 源与目标不能重叠 */
+void* memmove(void* dst, const void* src, size_t n);    /* 允许重叠 */
 void* memset(void* ptr, int value, size_t num);
+int memcmp(const void* s1, const void* s2, size_t n);
+
+/* 打印各档选用的实现 (启动时调用一次) */
+void string_init(void);
+
+/* 各个实现本身 (membench 对比用)。sse2/nt 只能在 cpu_has(X86_FEATURE_SSE2) 时调用 */
+void* memcpy_words(void* dst, const void* src, size_t n);
+void* memcpy_movsd(void* dst, const void* src, size_t n);
+void* memcpy_movsb(void* dst, const void* src, size_t n);
+void* memcpy_sse2(void* dst, const void* src, size_t n);
+void* memcpy_nt(void* dst, const void* src, size_t n);
 
-#endif
\ No newline at end of file
+#endif
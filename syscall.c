@@ -1,24 +1,150 @@
 #include "syscall.h"
 #include "terminal.h"
 #include "process.h"
+#include "uaccess.h"
+#include "uring.h"
+#include "cpu.h"
+#include "alternative.h"
+#include "smp.h"
+#include "clocksource.h"
+#include "trace.h"
 
-static void sys_write(char* str) {
-    terminal_writestring(str);
+// 本文件负责：
+// - 系统调用表与分发 (int 0x80 与 SYSENTER 两条入口共用，见 sysenter.asm)
+// - SYSENTER MSR 的初始化，以及随任务切换更新 SYSENTER 使用的内核栈
+//
+// 系统调用表按调用号索引，每项记录处理函数、参数个数与名字。
+// 分发时只从寄存器取出声明个数的参数，其余参数位置一律为 0，
+// 处理函数不会看到用户随手留在寄存器里的垃圾值。
+
+extern void sysenter_entry(void);
+
+void syscall_init(void) {
+    if (!cpu_has(X86_FEATURE_SEP)) return;
+
+    wrmsr(MSR_SYSENTER_CS, 0x08);                       /* SS 自动取 0x10；SYSEXIT 用 0x1B / 0x23 */
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)sysenter_entry);
+    wrmsr(MSR_SYSENTER_ESP, 0);                         /* 第一次切换到任务时填写 */
+    this_cpu()->sysenter_esp = 0;
+}
+
+// 与 TSS.esp0 的作用相同，只是 SYSENTER 不读 TSS，而是读 MSR。
+// wrmsr 是串行化指令 (上百个周期)，值没变时跳过。
+// 每次任务切换都会调用：是否支持 SYSENTER 在启动时修补决定 (alternative.h)，运行时不再判断。
+void syscall_set_kernel_stack(uint32_t stack_top) {
+    if (!static_cpu_has(X86_FEATURE_SEP)) return;
+    cpu_t* c = this_cpu();
+    if (c->sysenter_esp == stack_top) return;
+    wrmsr(MSR_SYSENTER_ESP, stack_top);
+    c->sysenter_esp = stack_top;
+}
+
+/* === 系统调用实现 === */
+
+/* 处理函数的返回值写回用户的 EAX */
+typedef int32_t (*syscall_fn_t)(const uint32_t* args);
+
+#define SYSCALL_RESCHED 0x1     /* 处理完成后调用 schedule() (yield / sleep) */
+
+struct syscall_entry {
+    syscall_fn_t fn;
+    uint8_t nargs;
+    uint8_t flags;
+    const char* name;
+};
+
+static int32_t sys_null(const uint32_t* args) {
+    (void)args;
+    return 0;
+}
+
+#define WRITE_CHUNK 128
+
+// write(buf, len)：按块拷贝到内核栈上的缓冲区再输出，内核从不直接读用户内存，
+// 也不需要在用户内存上找字符串结尾
+int32_t ksys_write(const char* ubuf, uint32_t len) {
+    char kbuf[WRITE_CHUNK];
+
+    if (!access_ok(ubuf, len)) return -EFAULT;
+
+    uint32_t done = 0;
+    while (done < len) {
+        uint32_t n = len - done;
+        if (n > WRITE_CHUNK) n = WRITE_CHUNK;
+        uint32_t left = copy_from_user(kbuf, ubuf + done, n);
+        terminal_write(kbuf, n - left);
+        done += n - left;
+        if (left) return done ? (int32_t)done : -EFAULT;
+    }
+    return (int32_t)done;
 }
 
+static int32_t sys_write(const uint32_t* args) {
+    return ksys_write((const char*)args[0], args[1]);
+}
+
+static int32_t sys_yield(const uint32_t* args) {
+    (void)args;
+    return 0;
+}
+
+// sleep(ms)：与 nanosleep 共用高精度定时器，不再按 10ms 的 tick 取整
+static int32_t sys_sleep(const uint32_t* args) {
+    process_sleep_until(clock_monotonic_ns() + (uint64_t)args[0] * NSEC_PER_MSEC);
+    return 0;
+}
+
+// clock_gettime(clockid, ts)：只支持 CLOCK_MONOTONIC (没有 RTC，不知道墙上时间)。
+// 用户态也可以直接读 vDSO 时间页，省掉这次陷入。
+static int32_t sys_clock_gettime(const uint32_t* args) {
+    if (args[0] != CLOCK_MONOTONIC) return -EINVAL;
+    uint64_t ns = clock_monotonic_ns();
+    struct timespec ts;
+    uint64_t sec = div_u64(ns, NSEC_PER_SEC);
+    ts.tv_sec = (uint32_t)sec;
+    ts.tv_nsec = (uint32_t)(ns - sec * NSEC_PER_SEC);
+    if (copy_to_user((void*)args[1], &ts, sizeof(ts))) return -EFAULT;
+    return 0;
+}
+
+// nanosleep(req, rem)：休眠到“现在 + req”，由高精度定时器在到期时刻唤醒。
+// 没有信号，休眠不会被打断，rem 永远不会被写入。
+static int32_t sys_nanosleep(const uint32_t* args) {
+    struct timespec req;
+    if (copy_from_user(&req, (const void*)args[0], sizeof(req))) return -EFAULT;
+    if (req.tv_nsec >= NSEC_PER_SEC) return -EINVAL;
+    uint64_t ns = (uint64_t)req.tv_sec * NSEC_PER_SEC + req.tv_nsec;
+    process_sleep_until(clock_monotonic_ns() + ns);
+    return 0;
+}
+
+static const struct syscall_entry syscall_table[NR_SYSCALLS] = {
+    [SYS_NULL]  = { sys_null,  0, 0,               "null"  },
+    [SYS_WRITE] = { sys_write, 2, 0,               "write" },
+    [SYS_YIELD] = { sys_yield, 0, SYSCALL_RESCHED, "yield" },
+    [SYS_SLEEP] = { sys_sleep, 1, SYSCALL_RESCHED, "sleep" },
+    [SYS_URING_SETUP] = { sys_uring_setup, 1, 0, "uring_setup" },
+    [SYS_URING_ENTER] = { sys_uring_enter, 4, 0, "uring_enter" },
+    [SYS_CLOCK_GETTIME] = { sys_clock_gettime, 2, 0, "clock_gettime" },
+    [SYS_NANOSLEEP] = { sys_nanosleep, 2, SYSCALL_RESCHED, "nanosleep" },
+};
+
 struct registers* syscall_handler(struct registers* regs) {
-    // 简单的系统调用分发
-    // EAX = 系统调用号
-    // EBX = 参数 1
-    if (regs->eax == 1) { // 约定 1 为 write
-        sys_write((char*)regs->ebx);
-    } else if (regs->eax == 2) { // 约定 2 为 yield
-        return schedule(regs);
-    } else if (regs->eax == 3) { // 约定 3 为 sleep
-        // EBX = ms
-        uint32_t ticks = regs->ebx / 10;
-        if (ticks == 0) ticks = 1;
-        process_sleep(ticks);
+    uint32_t nr = regs->eax;
+    TRACE_POINT(TRACE_SYSCALL, nr, regs->ebx);
+    if (nr >= NR_SYSCALLS || !syscall_table[nr].fn) {
+        regs->eax = (uint32_t)-ENOSYS;
+        return regs;
+    }
+
+    const struct syscall_entry* e = &syscall_table[nr];
+    uint32_t args[SYSCALL_MAX_ARGS] = { 0 };
+    const uint32_t regs_args[SYSCALL_MAX_ARGS] = { regs->ebx, regs->ecx, regs->edx, regs->esi, regs->edi };
+    for (uint32_t i = 0; i < e->nargs; i++) args[i] = regs_args[i];
+
+    regs->eax = (uint32_t)e->fn(args);
+
+    if (e->flags & SYSCALL_RESCHED) {
         return schedule(regs);
     }
     return regs;
@@ -3,7 +3,44 @@
 
 #include "interrupts.h"
 
+/*
+ * 系统调用号 (EAX)。参数依次放在 EBX, ECX, EDX, ESI, EDI，返回值在 EAX，
+ * 出错时返回负的错误码 (与 Linux 相同的编号)。
+ */
+#define SYS_NULL    0   /* 空调用，测量系统调用开销 */
+#define SYS_WRITE   1   /* write(buf, len)：返回写出的字节数 */
+#define SYS_YIELD   2   /* yield() */
+#define SYS_SLEEP   3   /* sleep(ms) */
+#define SYS_URING_SETUP 4   /* uring_setup(flags)：返回共享页地址 (uring.h) */
+#define SYS_URING_ENTER 5   /* uring_enter(ring, to_submit, min_complete, flags) */
+#define SYS_CLOCK_GETTIME 6 /* clock_gettime(clockid, struct timespec*) (clocksource.h) */
+#define SYS_NANOSLEEP 7     /* nanosleep(const struct timespec* req, struct timespec* rem) */
+#define NR_SYSCALLS 8
+
+#define SYSCALL_MAX_ARGS 5
+
+#define ENOENT  2
+#define ENOMEM  12
+#define EFAULT  14      /* 用户指针无效 */
+#define EBUSY   16
+#define EINVAL  22
+#define ENOSYS  38      /* 没有这个系统调用 */
+
+/* 本 CPU 的 SYSENTER MSR 初始化 (BSP 与每个 AP 各调用一次)，不支持 SEP 时什么都不做 */
 void syscall_init(void);
+
+/* 调度器切换到新任务时调用：SYSENTER 直接使用这个任务的内核栈 */
+void syscall_set_kernel_stack(uint32_t stack_top);
+
 struct registers* syscall_handler(struct registers* regs);
 
+/* write 的实现，供 uring 复用：返回写出的字节数或负的错误码 */
+int32_t ksys_write(const char* ubuf, uint32_t len);
+
+/*
+ * 用户态系统调用 stub (sysenter.asm，Ring 3 调用)：
+ * 第一次调用时用 CPUID 检测 SEP，支持则走 SYSENTER，否则走 int 0x80。
+ */
+uint32_t user_syscall(uint32_t num, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4);
+
 #endif
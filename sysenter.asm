@@ -0,0 +1,159 @@
+; =============================================================================
+; sysenter.asm - 快速系统调用 (SYSENTER / SYSEXIT)
+; =============================================================================
+; int 0x80 走的是完整的中断流程：查 IDT、特权级检查、从 TSS 取内核栈、压入 5 个字，
+; 返回时 iret 再做一遍检查。SYSENTER 把这些都省掉了：
+;   - CS/SS 固定为 MSR 0x174 指定的平坦段 (0x08 / 0x10)，不查 GDT 描述符；
+;   - ESP 直接取 MSR 0x175，EIP 取 MSR 0x176；
+;   - 不向栈里压任何东西，也不保存用户的 EIP/ESP。
+; SYSEXIT 同样简单：CS/SS 固定为 0x1B / 0x23，EIP = EDX，ESP = ECX。
+;
+; 因为 CPU 不记录返回地址，用户态必须通过本文件的 user_syscall_sysenter 进入：
+; 它把 ECX/EDX/EBP 压到用户栈上，EBP = 用户 ESP，返回地址固定为 sysenter_return。
+;
+; 内核入口 sysenter_entry 在内核栈上拼出与 int 0x80 完全相同的 struct registers
+; (包括 iret 需要的 SS/ESP/EFLAGS/CS/EIP)，所以：
+;   - syscall_handler / schedule 无需区分两条路径；
+;   - 系统调用中发生任务切换时，改走普通的 iret 返回路径，
+;     以后任何中断桩切回这个任务都能正确 iret 到 sysenter_return。
+; =============================================================================
+
+[global sysenter_entry]
+[global user_syscall]
+[global user_syscall_int80]
+[global user_syscall_sysenter]
+[global sysenter_return]
+
+extern syscall_handler
+extern finish_task_switch
+extern interrupt_exit
+%ifdef CONFIG_IRQSOFF_TRACE
+extern irqsoff_irq_enter
+extern irqsoff_irq_exit
+%endif
+
+section .text
+
+; -----------------------------------------------------------------------------
+; 内核入口 (MSR 0x176)
+; 进入时：CS=0x08 SS=0x10 ESP=当前任务的内核栈顶 (MSR 0x175) IF=0
+;         EBP=用户 ESP，其余通用寄存器与段寄存器仍是用户态的值
+; -----------------------------------------------------------------------------
+sysenter_entry:
+    push 0x23               ; SS (用户数据段)
+    push ebp                ; 用户 ESP
+    pushfd
+    or dword [esp], 0x200   ; SYSENTER 清了 IF，用户态的 IF 必然为 1
+    push 0x1B               ; CS (用户代码段)
+    push sysenter_return    ; EIP：用户 stub 中 sysenter 的下一条指令
+    push 0                  ; 错误码
+    push 128                ; 与 int 0x80 相同的中断号
+    pusha
+    push ds
+    push es
+    push fs
+    push gs
+
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov ax, 0x30            ; 每 CPU 数据段
+    mov gs, ax
+
+%ifdef CONFIG_IRQSOFF_TRACE
+    push 128                ; SYSENTER 清了 IF：关中断区间从这里开始
+    call irqsoff_irq_enter
+    add esp, 4
+%endif
+
+    mov ebx, esp            ; EBX 被 cdecl 保存：调用后用来判断是否发生了任务切换
+    push esp
+    call syscall_handler
+    cmp eax, ebx
+    jne .switched
+
+    ; 快速返回：仍是同一个任务，用 SYSEXIT 回到用户态
+    mov esp, eax
+%ifdef CONFIG_IRQSOFF_TRACE
+    push esp                ; 马上要 sti：关中断区间到此结束
+    call irqsoff_irq_exit
+    add esp, 4
+%endif
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    popa                    ; EAX = 系统调用返回值
+    add esp, 8              ; 跳过中断号和错误码
+    mov edx, [esp]          ; SYSEXIT: EIP = EDX
+    mov ecx, [esp + 12]     ;          ESP = ECX
+    and dword [esp + 8], ~0x200
+    push dword [esp + 8]    ; 先恢复 IF=0 的用户 EFLAGS ...
+    popfd
+    sti                     ; ... 再开中断：sti 的效果延迟一条指令，
+    sysexit                 ;     中断只会在回到用户态之后才被响应
+
+.switched:
+    ; 调度到了别的任务：它的现场可能是任意中断桩保存的，走中断桩的公共返回路径 (iret)
+    mov esp, eax
+    call finish_task_switch
+%ifdef CONFIG_IRQSOFF_TRACE
+    push esp                ; 入口处开了区间，这条出口也要收尾：新现场 IF=1 时区间在 iret 处结束
+    call irqsoff_irq_exit
+    add esp, 4
+%endif
+    jmp interrupt_exit
+
+; -----------------------------------------------------------------------------
+; 用户态系统调用 stub (Ring 3 执行)
+; uint32_t user_syscall(uint32_t num, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4)
+; 寄存器约定与 int 0x80 相同：EAX=调用号，EBX/ECX/EDX/ESI=参数，EAX=返回值。
+; 第一次调用时用 CPUID 检测 SEP 位，之后直接跳到选好的路径。
+; -----------------------------------------------------------------------------
+user_syscall:
+    push ebx
+    push esi
+    mov eax, [esp + 12]
+    mov ebx, [esp + 16]
+    mov ecx, [esp + 20]
+    mov edx, [esp + 24]
+    mov esi, [esp + 28]
+    call [user_syscall_path]
+    pop esi
+    pop ebx
+    ret
+
+user_syscall_detect:
+    pusha
+    mov eax, 1
+    cpuid                   ; CPUID 在 Ring 3 也可以执行
+    mov eax, user_syscall_int80
+    test edx, (1 << 11)     ; CPUID.01H:EDX.SEP
+    jz .set
+    mov eax, user_syscall_sysenter
+.set:
+    mov [user_syscall_path], eax
+    popa
+    jmp [user_syscall_path]
+
+; 传统路径
+user_syscall_int80:
+    int 0x80
+    ret
+
+; 快速路径：ECX/EDX 会被 SYSEXIT 用掉，先存到用户栈上
+user_syscall_sysenter:
+    push ecx
+    push edx
+    push ebp
+    mov ebp, esp            ; 内核通过 EBP 得知用户 ESP
+    sysenter
+sysenter_return:
+    pop ebp
+    pop edx
+    pop ecx
+    ret
+
+section .data
+user_syscall_path: dd user_syscall_detect
@@ -1,13 +1,48 @@
 #include "terminal.h"
 #include <stddef.h>
 #include "string.h"
+#include "spinlock.h"
+#include "clocksource.h"
+#include "cpu.h"
+#include "fbcon.h"
 
 static const size_t VGA_WIDTH = 80;
 static const size_t VGA_HEIGHT = 25;
 static uint16_t* const VGA_MEMORY = (uint16_t*) 0xB8000;
 
+// 显存影子 (Shadow Buffer) 与硬件滚屏：
+// - 所有字符先写进内存中的 shadow (布局与显存完全相同)，并在脏行位图中记下行号；
+//   每次 terminal_write 结束时才把脏行整行拷进显存 (flush)，批量输出只写一次显存；
+// - 文本模式显存 (0xB8000 起 32KB) 能放 204 行，这里用前 VGA_ROWS 行。屏幕显示从
+//   terminal_top 开始的 25 行，换行滚屏只是 terminal_top + 1 并改写 CRTC 起始地址 (0x3D4 寄存器 0x0C/0x0D)，
+//   不再搬动 24x80 个显存单元；
+// - 窗口到达显存末尾时，把最后 VGA_KEEP_ROWS 行在内存中搬回开头 (每 VGA_ROWS - VGA_KEEP_ROWS
+//   行一次)，这些行同时作为回看 (PgUp/PgDn) 的历史。
+#define VGA_ROWS        200
+#define VGA_KEEP_ROWS   100
+#define VGA_DIRTY_WORDS ((VGA_ROWS + 31) / 32)
+
+static uint16_t terminal_shadow[VGA_ROWS * 80];
+static uint32_t terminal_dirty[VGA_DIRTY_WORDS];
+static size_t terminal_top = 0;     /* 屏幕第 0 行对应的 shadow 行 */
+static size_t terminal_view = 0;    /* 实际显示的起始行 (回看历史时小于 terminal_top) */
+static size_t terminal_crtc = 0;    /* CRTC 当前的起始行 */
+
+// 图形控制台 (fbcon)：接管之后 shadow 不再拷进文本显存，而是把正在显示的 25 行交给
+// fbcon_update 画成像素。fbcon 自己比较单元内容，只重画变化的字符
+static int terminal_fb = 0;
+static size_t terminal_fb_view = 0; /* fbcon 上次显示的起始行 */
+
 static terminal_t terminal;
 
+/* SMP：多个 CPU 同时输出时保护光标位置与滚屏 (整串输出持锁，避免字符交错) */
+static spinlock_t terminal_lock = SPINLOCK_INIT("terminal");
+
+/* 额外的控制台 (串口等)：在 terminal_lock 内按同样的顺序收到全部输出 */
+#define TERMINAL_MAX_CONSOLES 2
+static console_write_t terminal_consoles[TERMINAL_MAX_CONSOLES];
+static int terminal_nr_consoles = 0;
+
 static inline void outb(uint16_t port, uint8_t val) {
     asm volatile ( "outb %0, %1" : : "a"(val), "Nd"(port) );
 }
@@ -18,6 +53,16 @@ static void terminal_disable_cursor(void) {
     outb(0x3D5, 0x20);
 }
 
+// CRTC 起始地址 (以字符单元计)：屏幕左上角显示的是显存中的第几个单元
+static void terminal_set_start(size_t row) {
+    uint16_t pos = (uint16_t)(row * VGA_WIDTH);
+    outb(0x3D4, 0x0C);
+    outb(0x3D5, (uint8_t)(pos >> 8));
+    outb(0x3D4, 0x0D);
+    outb(0x3D5, (uint8_t)(pos & 0xFF));
+    terminal_crtc = row;
+}
+
 // 合并前景色和背景色
 uint8_t vga_entry_color(enum vga_color fg, enum vga_color bg) {
     return fg | bg << 4;
@@ -28,24 +73,70 @@ static inline uint16_t vga_entry(unsigned char uc, uint8_t color) {
     return (uint16_t) uc | (uint16_t) color << 8;
 }
 
+static inline void terminal_mark_dirty(size_t shadow_row) {
+    terminal_dirty[shadow_row / 32] |= 1u << (shadow_row % 32);
+}
+
+static void terminal_clear_row(size_t shadow_row) {
+    uint16_t blank = vga_entry(' ', terminal.color);
+    uint16_t* p = &terminal_shadow[shadow_row * VGA_WIDTH];
+    for (size_t x = 0; x < VGA_WIDTH; x++) p[x] = blank;
+    terminal_mark_dirty(shadow_row);
+}
+
+// 把脏行拷进显存 (每行 160 字节，按 32 位写)，再按需改写 CRTC 起始地址。
+// fbcon 接管后改为把当前一屏交给 fbcon。调用者持有 terminal_lock
+static void terminal_flush(void) {
+    if (terminal_fb) {
+        for (size_t w = 0; w < VGA_DIRTY_WORDS; w++) terminal_dirty[w] = 0;
+        fbcon_update(&terminal_shadow[terminal_view * VGA_WIDTH],
+                     (int)terminal_view - (int)terminal_fb_view);
+        terminal_fb_view = terminal_view;
+        return;
+    }
+    for (size_t w = 0; w < VGA_DIRTY_WORDS; w++) {
+        uint32_t bits = terminal_dirty[w];
+        terminal_dirty[w] = 0;
+        while (bits) {
+            size_t row = w * 32 + (size_t)__builtin_ctz(bits);
+            bits &= bits - 1;
+            memcpy((void*)&VGA_MEMORY[row * VGA_WIDTH], &terminal_shadow[row * VGA_WIDTH],
+                   VGA_WIDTH * sizeof(uint16_t));
+        }
+    }
+    if (terminal_view != terminal_crtc) terminal_set_start(terminal_view);
+}
+
 // 初始化终端：
 // - 设置游标位置、默认颜色与缓冲区指针
 // - 关闭硬件光标以减少视觉闪烁
-// - 将整个 80x25 文本缓冲区清为背景色空格
+// - 窗口回到显存开头，将整个 80x25 屏幕清为背景色空格
 void terminal_initialize(void) {
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
     terminal.row = 0;
     terminal.column = 0;
     terminal.color = vga_entry_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
-    terminal.buffer = VGA_MEMORY;
-    terminal_disable_cursor();
-    
+    terminal.buffer = terminal_shadow;
+    if (!terminal_fb) terminal_disable_cursor();
+
     // 清屏
+    terminal_top = 0;
+    terminal_view = 0;
     for (size_t y = 0; y < VGA_HEIGHT; y++) {
-        for (size_t x = 0; x < VGA_WIDTH; x++) {
-            const size_t index = y * VGA_WIDTH + x;
-            terminal.buffer[index] = vga_entry(' ', terminal.color);
-        }
+        terminal_clear_row(y);
     }
+    terminal_flush();
+    if (!terminal_fb) terminal_set_start(0);
+    spin_unlock_irqrestore(&terminal_lock, flags);
+}
+
+// fbcon 完成模式切换后调用：之后的 flush 都交给 fbcon，先把当前一屏完整画一次
+void terminal_attach_fb(void) {
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
+    terminal_fb = 1;
+    terminal_fb_view = terminal_view;
+    terminal_flush();
+    spin_unlock_irqrestore(&terminal_lock, flags);
 }
 
 // 设置颜色
@@ -54,42 +145,42 @@ void terminal_setcolor(uint8_t color) {
 }
 
 // 在指定位置放置字符：
-// - 直接计算线性索引 y*WIDTH+x 并写入字符与颜色
+// - (x, y) 是屏幕坐标，对应 shadow 中的第 top + y 行
 // - VGA 文本模式每个单元为 2 字节：低字节字符，高字节颜色
+// - 只写 shadow 并标记脏行，由 terminal_flush 写入显存
 void terminal_putentryat(char c, uint8_t color, size_t x, size_t y) {
-    const size_t index = y * VGA_WIDTH + x;
-    terminal.buffer[index] = vga_entry(c, color);
+    const size_t row = terminal_top + y;
+    terminal.buffer[row * VGA_WIDTH + x] = vga_entry(c, color);
+    terminal_mark_dirty(row);
 }
 
 // 处理换行：
 // - 列归零，行+1
-// - 如果到达底部，整体上移一行（滚屏）
+// - 如果到达底部，窗口下移一行 (硬件滚屏)，清空新进入屏幕的最后一行
+// - 窗口到达显存末尾时，把最后 VGA_KEEP_ROWS 行搬回开头 (内存拷贝，之后整体 flush)
 static void terminal_newline(void) {
     terminal.column = 0;
-    if (++terminal.row == VGA_HEIGHT) {
-        // 滚屏逻辑：将后24行复制到前24行
-        for (size_t y = 1; y < VGA_HEIGHT; y++) {
-            for (size_t x = 0; x < VGA_WIDTH; x++) {
-                const size_t src_index = y * VGA_WIDTH + x;
-                const size_t dst_index = (y - 1) * VGA_WIDTH + x;
-                terminal.buffer[dst_index] = terminal.buffer[src_index];
-            }
-        }
-        // 清空最后一行
-        const size_t last_row_start = (VGA_HEIGHT - 1) * VGA_WIDTH;
-        for (size_t x = 0; x < VGA_WIDTH; x++) {
-            terminal.buffer[last_row_start + x] = vga_entry(' ', terminal.color);
-        }
-        // 保持在最后一行
-        terminal.row = VGA_HEIGHT - 1;
+    if (++terminal.row < VGA_HEIGHT) return;
+    terminal.row = VGA_HEIGHT - 1;
+
+    if (terminal_top + VGA_HEIGHT >= VGA_ROWS) {
+        size_t from = VGA_ROWS - VGA_KEEP_ROWS;
+        memcpy(terminal_shadow, &terminal_shadow[from * VGA_WIDTH],
+               VGA_KEEP_ROWS * VGA_WIDTH * sizeof(uint16_t));
+        for (size_t r = 0; r < VGA_KEEP_ROWS; r++) terminal_mark_dirty(r);
+        terminal_top -= from;
     }
+    terminal_top++;
+    terminal_view = terminal_top;
+    terminal_clear_row(terminal_top + VGA_HEIGHT - 1);
 }
 
 // 输出单个字符：
 // - '\n'：调用换行处理
 // - '\b'：行内退格，向左移动并将当前位置擦为背景色空格
 // - 普通字符：写入当前位置并推进列；行末自动换行
-void terminal_putchar(char c) {
+// 调用者持有 terminal_lock
+static void terminal_putchar_locked(char c) {
     if (c == '\n') {
         terminal_newline();
         return;
@@ -102,19 +193,73 @@ void terminal_putchar(char c) {
         }
         return;
     }
-    
+
     terminal_putentryat(c, terminal.color, terminal.column, terminal.row);
     if (++terminal.column == VGA_WIDTH) {
         terminal_newline();
     }
 }
 
+// 输出单个字符 (同样要转交给其他控制台)
+void terminal_putchar(char c) {
+    terminal_write(&c, 1);
+}
+
 // 写入字符串：
-// - 连续调用 terminal_putchar 写入 size 个字符
+// - 连续调用 terminal_putchar_locked 写入 size 个字符 (只写 shadow)
 // - 保持逐字符语义，便于处理控制字符（如 \n、\b）
+// - 整串写完后原样转交给注册的其他控制台，再一次性把脏行刷进显存
 void terminal_write(const char* data, size_t size) {
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
     for (size_t i = 0; i < size; i++) {
-        terminal_putchar(data[i]);
+        terminal_putchar_locked(data[i]);
+    }
+    for (int i = 0; i < terminal_nr_consoles; i++) {
+        terminal_consoles[i](data, size);
+    }
+    terminal_view = terminal_top;   /* 新的输出总是让显示回到最新的一屏 */
+    terminal_flush();
+    spin_unlock_irqrestore(&terminal_lock, flags);
+}
+
+void terminal_add_console(console_write_t write) {
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
+    if (terminal_nr_consoles < TERMINAL_MAX_CONSOLES) {
+        terminal_consoles[terminal_nr_consoles++] = write;
+    }
+    spin_unlock_irqrestore(&terminal_lock, flags);
+}
+
+// 在屏幕固定位置写入 (状态栏)：不移动光标，不转交给其他控制台
+void terminal_write_at(size_t x, size_t y, const char* data, size_t size, uint8_t color) {
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
+    for (size_t i = 0; i < size && x + i < VGA_WIDTH; i++) {
+        terminal_putentryat(data[i], color, x + i, y);
+    }
+    terminal_flush();
+    spin_unlock_irqrestore(&terminal_lock, flags);
+}
+
+// 回看历史：lines < 0 向上，> 0 向下，只改 CRTC 起始地址
+void terminal_scroll_view(int lines) {
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
+    int view = (int)terminal_view + lines;
+    if (view < 0) view = 0;
+    if (view > (int)terminal_top) view = (int)terminal_top;
+    terminal_view = (size_t)view;
+    terminal_flush();
+    spin_unlock_irqrestore(&terminal_lock, flags);
+}
+
+// 致命异常路径：不拿锁 (出错的可能正是持锁的代码)，直接写显存中正在显示的第 0 行
+void terminal_emergency_write(const char* data, uint8_t color) {
+    if (terminal_fb) {
+        fbcon_emergency_write(data, color);
+        return;
+    }
+    volatile uint16_t* vga = &VGA_MEMORY[terminal_crtc * VGA_WIDTH];
+    for (size_t i = 0; data[i] && i < VGA_WIDTH; i++) {
+        vga[i] = vga_entry((unsigned char)data[i], color);
     }
 }
 
@@ -124,3 +269,117 @@ void terminal_write(const char* data, size_t size) {
 void terminal_writestring(const char* data) {
     terminal_write(data, strlen(data));
 }
+
+// 输出无符号十进制数 (例如统计信息)
+void terminal_writedec(uint32_t value) {
+    char buf[11];
+    int i = 11;
+    do { buf[--i] = '0' + (value % 10); value /= 10; } while (value);
+    terminal_write(&buf[i], 11 - i);
+}
+
+// 输出 "0x" 前缀的 8 位十六进制数 (例如地址、寄存器值)
+void terminal_writehex(uint32_t value) {
+    const char hex[] = "0123456789ABCDEF";
+    char buf[10] = { '0', 'x' };
+    for (int i = 0; i < 8; i++) {
+        buf[2 + i] = hex[(value >> (28 - i * 4)) & 0xF];
+    }
+    terminal_write(buf, 10);
+}
+
+/* ---------------------------------------------------------------------------
+ * termbench：同样的输出分别走“直写显存 + 逐行拷贝滚屏”(改造前的做法) 和
+ * “shadow + 脏行 flush + 硬件滚屏”，比较每秒输出的字符数。
+ * 两种方式都按行调用 (与 cat、printk 相同)，不转交给串口，只测终端本身。
+ * ------------------------------------------------------------------------- */
+
+#define TERMBENCH_LINES 1000
+
+// 改造前的 terminal_putchar + terminal_newline：每个字符写显存，滚屏时读写 24x80 个显存单元
+static void termbench_legacy_line(const char* line, size_t len, size_t* row, size_t* col) {
+    volatile uint16_t* vga = VGA_MEMORY;
+    for (size_t i = 0; i < len; i++) {
+        char c = line[i];
+        if (c != '\n') {
+            vga[*row * VGA_WIDTH + *col] = vga_entry((unsigned char)c, terminal.color);
+            if (++*col < VGA_WIDTH) continue;
+        }
+        *col = 0;
+        if (++*row == VGA_HEIGHT) {
+            for (size_t y = 1; y < VGA_HEIGHT; y++) {
+                for (size_t x = 0; x < VGA_WIDTH; x++) {
+                    vga[(y - 1) * VGA_WIDTH + x] = vga[y * VGA_WIDTH + x];
+                }
+            }
+            for (size_t x = 0; x < VGA_WIDTH; x++) {
+                vga[(VGA_HEIGHT - 1) * VGA_WIDTH + x] = vga_entry(' ', terminal.color);
+            }
+            *row = VGA_HEIGHT - 1;
+        }
+    }
+}
+
+static void termbench_report(const char* name, uint64_t cycles) {
+    uint32_t khz = clocksource_tsc_khz();
+    uint32_t per_line = (uint32_t)div_u64(cycles, TERMBENCH_LINES);
+    terminal_writestring(name);
+    terminal_writedec(per_line);
+    terminal_writestring(" cycles/line");
+    if (khz && per_line) {
+        /* 每行 80 个字符：字符/秒 = 80 * (khz * 1000) / 每行周期数 */
+        terminal_writestring(", ");
+        terminal_writedec((uint32_t)div_u64((uint64_t)VGA_WIDTH * khz * 1000, per_line));
+        terminal_writestring(" chars/s");
+    }
+    terminal_putchar('\n');
+}
+
+// 改造后：每行一次 terminal_write 的完整路径 (不含其他控制台)
+static uint64_t termbench_shadow(const char* line) {
+    uint64_t cycles = 0;
+    for (int n = 0; n < TERMBENCH_LINES; n++) {
+        uint32_t flags = spin_lock_irqsave(&terminal_lock);
+        uint64_t t0 = rdtsc();
+        for (size_t i = 0; i < VGA_WIDTH; i++) terminal_putchar_locked(line[i]);
+        terminal_view = terminal_top;
+        terminal_flush();
+        cycles += rdtsc() - t0;
+        spin_unlock_irqrestore(&terminal_lock, flags);
+    }
+    return cycles;
+}
+
+void terminal_bench(void) {
+    char line[VGA_WIDTH];
+    for (size_t i = 0; i < VGA_WIDTH - 1; i++) line[i] = (char)('!' + i % 90);
+    line[VGA_WIDTH - 1] = '\n';
+
+    /* 图形模式下 0xB8000 不是显示内容 (可能映射到显存开头)，只测 fbcon 的完整路径 */
+    if (terminal_fb) {
+        termbench_report("fbcon (cell diff, glyph blit): ", termbench_shadow(line));
+        return;
+    }
+
+    /* 改造前：窗口固定在显存开头。每行单独持锁，行与行之间允许中断 */
+    size_t row = 0, col = 0;
+    uint64_t legacy = 0;
+    for (int n = 0; n < TERMBENCH_LINES; n++) {
+        uint32_t flags = spin_lock_irqsave(&terminal_lock);
+        if (terminal_crtc != 0) terminal_set_start(0);
+        uint64_t t0 = rdtsc();
+        termbench_legacy_line(line, VGA_WIDTH, &row, &col);
+        legacy += rdtsc() - t0;
+        spin_unlock_irqrestore(&terminal_lock, flags);
+    }
+
+    /* 显存被直接改写过：整个区域重新 flush，恢复原来的画面 */
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
+    for (size_t r = 0; r < VGA_ROWS; r++) terminal_mark_dirty(r);
+    terminal_flush();
+    spin_unlock_irqrestore(&terminal_lock, flags);
+
+    uint64_t shadow = termbench_shadow(line);
+    termbench_report("legacy (direct VGA, copy scroll): ", legacy);
+    termbench_report("shadow (dirty rows, CRTC scroll): ", shadow);
+}
@@ -29,7 +29,7 @@ typedef struct {
     size_t row;        // 当前行
     size_t column;     // 当前列
     uint8_t color;     // 当前颜色
-    uint16_t* buffer;  // VGA缓冲区指针
+    uint16_t* buffer;  // 显存影子 (shadow)，flush 时整行拷进 VGA 显存
 } terminal_t;
 
 // 函数声明
@@ -40,5 +40,22 @@ void terminal_putentryat(char c, uint8_t color, size_t x, size_t y);
 void terminal_putchar(char c);
 void terminal_write(const char* data, size_t size);
 void terminal_writestring(const char* data);
+void terminal_writedec(uint32_t value);
+void terminal_writehex(uint32_t value);
+
+// 在屏幕固定位置写入 (状态栏)：不移动光标，不转交给其他控制台
+void terminal_write_at(size_t x, size_t y, const char* data, size_t size, uint8_t color);
+// 回看历史 (PgUp/PgDn)：lines < 0 向上，> 0 向下；有新输出时自动回到最新一屏
+void terminal_scroll_view(int lines);
+// 致命异常路径：不拿锁，直接写正在显示的第 0 行
+void terminal_emergency_write(const char* data, uint8_t color);
+// fbcon 切换到图形模式后调用：之后的输出由 fbcon 画到线性帧缓冲
+void terminal_attach_fb(void);
+// termbench 命令：改造前后终端输出速度对比
+void terminal_bench(void);
+
+// 额外的控制台：terminal_write 的内容原样转交 (在终端锁内调用，不能阻塞，不能再输出到终端)
+typedef void (*console_write_t)(const char* data, size_t size);
+void terminal_add_console(console_write_t write);
 
 #endif
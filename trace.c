@@ -0,0 +1,232 @@
+#include "trace.h"
+#include "ksyms.h"
+#include "clocksource.h"
+#include "terminal.h"
+#include "string.h"
+#include "process.h"
+#include "smp.h"
+#include "cpu.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 无锁环形缓冲区的写入 (trace_record) 与读取 (trace_dump)
+// - -finstrument-functions 的钩子 __cyg_profile_func_enter/exit
+//
+// 本文件在 FTRACE 构建下也不加 -finstrument-functions 编译 (见 build.sh)：
+// 钩子调用到的任何函数都不能再触发钩子，否则无限递归。
+
+#define TRACE_MASK       (TRACE_ENTRIES - 1)
+#define TRACE_DUMP_MAX   40         /* 一屏能看完的条数 */
+
+static struct trace_entry trace_ring[TRACE_ENTRIES];
+static volatile uint32_t trace_head = 0;    /* 下一个序号 (单调递增，回绕后取模) */
+volatile uint32_t trace_enabled = 0;
+
+void trace_record(uint32_t type, uint32_t a, uint32_t b) {
+    uint32_t seq = __sync_fetch_and_add(&trace_head, 1);
+    struct trace_entry* e = &trace_ring[seq & TRACE_MASK];
+    uint64_t tsc = rdtsc();
+
+    e->seq = 0;
+    asm volatile("" : : : "memory");
+    e->tsc_lo = (uint32_t)tsc;
+    e->tsc_hi = (uint32_t)(tsc >> 32);
+    e->a = a;
+    e->b = b;
+    e->type = (uint8_t)type;
+
+    /* 启动早期和 AP 刚启动时 GS 还不是每 CPU 段，不能用 this_cpu() */
+    uint16_t gs;
+    asm volatile("mov %%gs, %0" : "=r"(gs));
+    if (gs == 0x30) {
+        cpu_t* c = this_cpu();
+        e->cpu = (uint8_t)c->id;
+        e->pid = c->current ? (uint16_t)c->current->pid : 0;
+    } else {
+        e->cpu = 0xFF;
+        e->pid = 0;
+    }
+    asm volatile("" : : : "memory");
+    e->seq = seq + 1;
+}
+
+// 拷贝序号为 seq 的事件：拷贝前后都检查序号，期间被覆盖或正在写时返回 0 (同 printk.c 的 log_read)
+static int trace_read(uint32_t seq, struct trace_entry* out) {
+    const struct trace_entry* e = &trace_ring[seq & TRACE_MASK];
+    if (e->seq != seq + 1) return 0;
+    asm volatile("" : : : "memory");
+    out->tsc_lo = e->tsc_lo;
+    out->tsc_hi = e->tsc_hi;
+    out->a = e->a;
+    out->b = e->b;
+    out->pid = e->pid;
+    out->cpu = e->cpu;
+    out->type = e->type;
+    asm volatile("" : : : "memory");
+    out->seq = e->seq;
+    return out->seq == seq + 1;
+}
+
+/* 编译器插入的钩子：fn 是被调用的函数，call_site 是调用它的位置 */
+void __cyg_profile_func_enter(void* fn, void* call_site) __attribute__((no_instrument_function));
+void __cyg_profile_func_exit(void* fn, void* call_site) __attribute__((no_instrument_function));
+
+// kernel.c 中的用户态演示程序也被插桩，它们在 Ring 3 运行：不记录
+static inline int trace_from_user(void) {
+    uint16_t cs;
+    asm volatile("mov %%cs, %0" : "=r"(cs));
+    return cs & 3;
+}
+
+void __cyg_profile_func_enter(void* fn, void* call_site) {
+    if (trace_enabled && !trace_from_user()) trace_record(TRACE_FUNC_ENTER, (uint32_t)fn, (uint32_t)call_site);
+}
+
+void __cyg_profile_func_exit(void* fn, void* call_site) {
+    if (trace_enabled && !trace_from_user()) trace_record(TRACE_FUNC_EXIT, (uint32_t)fn, (uint32_t)call_site);
+}
+
+void trace_on(void) {
+    trace_enabled = 1;
+    terminal_writestring("trace: on\n");
+}
+
+void trace_off(void) {
+    trace_enabled = 0;
+    terminal_writestring("trace: off\n");
+}
+
+void trace_clear(void) {
+    /* 序号继续递增：旧槽位的 seq 与新序号对不上，读者自然会跳过 */
+    for (uint32_t i = 0; i < TRACE_ENTRIES; i++) trace_ring[i].seq = 0;
+    terminal_writestring("trace: cleared\n");
+}
+
+static const char* trace_sym(uint32_t addr) {
+    int i = ksyms_lookup(addr, NULL);
+    return i < 0 ? "?" : ksyms_name((uint32_t)i);
+}
+
+static uint32_t trace_parse_dec(const char* s) {
+    uint32_t v = 0;
+    while (*s >= '0' && *s <= '9') v = v * 10 + (uint32_t)(*s++ - '0');
+    return v;
+}
+
+static int trace_prefix(const char* s, const char* prefix) {
+    while (*prefix) if (*s++ != *prefix++) return 0;
+    return 1;
+}
+
+void trace_dump(const char* filter) {
+    int by_pid = 0, by_func = 0;
+    uint32_t want_pid = 0, want_fn = 0;
+    if (filter && trace_prefix(filter, "pid ")) {
+        by_pid = 1;
+        want_pid = trace_parse_dec(filter + 4);
+    } else if (filter && trace_prefix(filter, "func ")) {
+        const char* name = filter + 5;
+        for (uint32_t i = 0; i < ksyms_count(); i++) {
+            if (strcmp(ksyms_name(i), name) == 0) { want_fn = ksyms_addr(i); break; }
+        }
+        if (!want_fn) {
+            terminal_writestring("trace: no such function\n");
+            return;
+        }
+        by_func = 1;
+    }
+
+    /* 从最新往回找最多 TRACE_DUMP_MAX 条符合条件的完整事件，再按时间顺序打印 */
+    uint32_t picked[TRACE_DUMP_MAX];
+    uint32_t n = 0;
+    uint32_t head = trace_head;
+    for (uint32_t k = 0; k < TRACE_ENTRIES && k < head && n < TRACE_DUMP_MAX; k++) {
+        uint32_t seq = head - 1 - k;
+        struct trace_entry* e = &trace_ring[seq & TRACE_MASK];
+        if (e->seq != seq + 1) continue;
+        if (by_pid && e->pid != want_pid) continue;
+        if (by_func && !((e->type == TRACE_FUNC_ENTER || e->type == TRACE_FUNC_EXIT) && e->a == want_fn)) continue;
+        picked[n++] = seq;
+    }
+    if (n == 0) {
+        terminal_writestring("trace: no events\n");
+        return;
+    }
+
+    uint32_t khz = clocksource_tsc_khz();
+    uint64_t t0 = 0;
+    int have_t0 = 0;
+    uint32_t depth[SMP_MAX_CPUS] = { 0 };
+
+    /* 打印本身 (终端、串口) 在 FTRACE 构建下会产生大量事件，环在打印期间可能回绕：
+     * 每条都重新拷贝并校验序号，已被覆盖或正在写的跳过 */
+    terminal_writestring("    TIME(us) CPU PID  EVENT\n");
+    while (n--) {
+        struct trace_entry e;
+        if (!trace_read(picked[n], &e)) continue;
+        uint64_t tsc = ((uint64_t)e.tsc_hi << 32) | e.tsc_lo;
+        if (!have_t0) {
+            t0 = tsc;
+            have_t0 = 1;
+        }
+        uint64_t dt = tsc - t0;
+        uint32_t us = khz ? (uint32_t)div_u64(dt * 1000, khz) : (uint32_t)dt;
+        for (uint32_t w = 100000000; w > 1; w /= 10) if (us < w) terminal_putchar(' ');
+        terminal_writedec(us);
+        terminal_writestring("   ");
+        if (e.cpu == 0xFF) terminal_putchar('-'); else terminal_writedec(e.cpu);
+        terminal_writestring("  ");
+        if (e.pid < 10) terminal_putchar(' ');
+        terminal_writedec(e.pid);
+        terminal_writestring("  ");
+
+        uint32_t* d = &depth[e.cpu < SMP_MAX_CPUS ? e.cpu : 0];
+        switch (e.type) {
+        case TRACE_FUNC_ENTER:
+            for (uint32_t i = 0; i < *d && i < 16; i++) terminal_writestring("  ");
+            terminal_writestring(trace_sym(e.a));
+            terminal_writestring("() {");
+            (*d)++;
+            break;
+        case TRACE_FUNC_EXIT:
+            if (*d) (*d)--;
+            for (uint32_t i = 0; i < *d && i < 16; i++) terminal_writestring("  ");
+            terminal_writestring("} ");
+            terminal_writestring(trace_sym(e.a));
+            break;
+        case TRACE_SCHED_SWITCH:
+            terminal_writestring("sched_switch ");
+            terminal_writedec(e.a);
+            terminal_writestring(" -> ");
+            terminal_writedec(e.b);
+            break;
+        case TRACE_KMALLOC:
+            terminal_writestring("kmalloc size=");
+            terminal_writedec(e.a);
+            terminal_writestring(" ptr=");
+            terminal_writehex(e.b);
+            break;
+        case TRACE_PAGE_ALLOC:
+            terminal_writestring("page_alloc ");
+            terminal_writehex(e.b);
+            terminal_writestring(" from ");
+            terminal_writestring(trace_sym(e.a));
+            break;
+        case TRACE_VFS_READ:
+            terminal_writestring("vfs_read inode=");
+            terminal_writedec(e.a);
+            terminal_writestring(" size=");
+            terminal_writedec(e.b);
+            break;
+        case TRACE_SYSCALL:
+            terminal_writestring("syscall nr=");
+            terminal_writedec(e.a);
+            terminal_writestring(" arg0=");
+            terminal_writehex(e.b);
+            break;
+        default:
+            terminal_writestring("?");
+        }
+        terminal_putchar('\n');
+    }
+}
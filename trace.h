@@ -0,0 +1,61 @@
+/**
+ * trace.h - 函数级追踪与静态追踪点 (ftrace 风格的环形缓冲区)
+ *
+ * 所有事件写入一个固定大小的全局环形缓冲区 (TRACE_ENTRIES 项，写满后覆盖最旧的)：
+ * - 写入无锁：原子加法领取序号，序号对容量取模就是槽位；任意 CPU、任意上下文
+ *   (包括中断处理函数里) 都可以写，写者之间互不等待；
+ * - 每项带 TSC 时间戳、CPU 号、当前 PID；
+ * - 槽位的 seq 在填写期间为 0，填完才写入“序号 + 1”，读者据此跳过未写完或已被覆盖的项。
+ *
+ * 两类事件：
+ * - 静态追踪点 (始终编译)：schedule() 切换、kmalloc、pmm_alloc_page、vfs_read、系统调用入口。
+ *   关闭时只有一次读和一次分支；
+ * - 函数进入/退出 (FTRACE=1 ./build.sh)：用 -finstrument-functions 编译，
+ *   编译器在每个函数的入口和出口插入 __cyg_profile_func_enter/exit 调用。
+ *
+ * 运行时用 shell 的 trace 命令开关、清空、查看 (可按 PID 或函数名过滤)。
+ *
+ * @see [trace.md](doc/trace.md)
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_ENTRIES 4096          /* 必须是 2 的幂 */
+
+enum trace_type {
+    TRACE_FUNC_ENTER = 1,           /* a = 函数地址, b = 调用点 */
+    TRACE_FUNC_EXIT,                /* a = 函数地址, b = 调用点 */
+    TRACE_SCHED_SWITCH,             /* a = 切出的 PID, b = 切入的 PID */
+    TRACE_KMALLOC,                  /* a = 请求大小, b = 返回的指针 */
+    TRACE_PAGE_ALLOC,               /* a = 调用者地址, b = 物理页地址 */
+    TRACE_VFS_READ,                 /* a = inode, b = 请求字节数 */
+    TRACE_SYSCALL,                  /* a = 系统调用号, b = 第一个参数 */
+};
+
+struct trace_entry {
+    volatile uint32_t seq;          /* 0: 正在写；否则为序号 + 1 */
+    uint32_t tsc_lo, tsc_hi;
+    uint32_t a, b;
+    uint16_t pid;
+    uint8_t cpu;                    /* 0xFF: GS 还没指向 cpu_t (启动早期) */
+    uint8_t type;
+};
+
+extern volatile uint32_t trace_enabled;
+
+void trace_record(uint32_t type, uint32_t a, uint32_t b);
+
+/* 静态追踪点：关闭时不调用 trace_record */
+#define TRACE_POINT(type, a, b) \
+    do { if (trace_enabled) trace_record((type), (uint32_t)(a), (uint32_t)(b)); } while (0)
+
+void trace_on(void);
+void trace_off(void);
+void trace_clear(void);
+
+/* 打印最近的事件。filter 为 NULL 或 "pid <n>" 或 "func <函数名>" */
+void trace_dump(const char* filter);
+
+#endif
@@ -0,0 +1,76 @@
+; =============================================================================
+; trampoline.asm - AP (Application Processor) 启动跳板
+; =============================================================================
+; BSP 发送 SIPI 后，AP 从实模式的 (向量 << 12) 地址开始执行，也就是 TRAMPOLINE_BASE。
+; 这段代码被 smp.c 复制到 0x8000，然后：
+;   实模式 -> 加载临时 GDT -> 保护模式 -> 加载 BSP 的页目录并开启分页
+;   -> 切换到 BSP 分配的栈 -> 调用 C 语言的 AP 入口
+;
+; 【注意】代码被复制后才运行，链接地址与运行地址不同，
+; 所以所有绝对地址都写成 "TRAMPOLINE_BASE + (标签 - trampoline_start)"。
+; tramp_cr3 / tramp_stack / tramp_entry 由 BSP 在复制后填写。
+; =============================================================================
+
+TRAMPOLINE_BASE equ 0x8000
+
+%define TADDR(label) (TRAMPOLINE_BASE + (label - trampoline_start))
+
+[global trampoline_start]
+[global trampoline_end]
+[global tramp_cr3]
+[global tramp_stack]
+[global tramp_entry]
+
+section .text
+[bits 16]
+trampoline_start:
+    cli
+    cld
+    xor ax, ax
+    mov ds, ax
+
+    lgdt [TADDR(tramp_gdt_ptr)]
+
+    mov eax, cr0
+    or eax, 1               ; PE=1：进入保护模式
+    mov cr0, eax
+
+    jmp dword 0x08:TADDR(tramp_pm)   ; 远跳转刷新 CS，进入 32 位代码
+
+[bits 32]
+tramp_pm:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    ; 与 BSP 共用同一套页表 (单地址空间)
+    mov eax, [TADDR(tramp_cr3)]
+    mov cr3, eax
+    mov eax, cr0
+    or eax, 0x80000000      ; PG=1
+    mov cr0, eax
+
+    mov esp, [TADDR(tramp_stack)]
+    mov eax, [TADDR(tramp_entry)]
+    call eax                ; ap_main() 不会返回
+
+.hang:
+    hlt
+    jmp .hang
+
+align 8
+tramp_gdt:
+    dq 0x0000000000000000   ; 空描述符
+    dq 0x00CF9A000000FFFF   ; 0x08: 内核代码段 (平坦 4GB)
+    dq 0x00CF92000000FFFF   ; 0x10: 内核数据段 (平坦 4GB)
+tramp_gdt_ptr:
+    dw 23
+    dd TADDR(tramp_gdt)
+
+tramp_cr3:   dd 0
+tramp_stack: dd 0
+tramp_entry: dd 0
+trampoline_end:
@@ -0,0 +1,78 @@
+#include "uaccess.h"
+#include "heap.h"
+
+// 本文件负责：
+// - 用户地址范围检查
+// - 带异常修复的 rep movs 拷贝
+// - 异常表查找
+//
+// 异常表每项两个地址：{可能出错的指令, 出错后跳转的修复代码}。
+// 表项由内联汇编的 .pushsection __ex_table 生成，链接脚本把所有目标文件的
+// __ex_table 收集到一起，并用 __start_ex_table / __stop_ex_table 标出范围。
+
+struct exception_table_entry {
+    uint32_t insn;
+    uint32_t fixup;
+};
+
+extern struct exception_table_entry __start_ex_table[];
+extern struct exception_table_entry __stop_ex_table[];
+
+static int range_within(uint32_t addr, uint32_t size, uint32_t start, uint32_t end) {
+    return addr >= start && addr <= end && size <= end - addr;
+}
+
+int access_ok(const void* addr, uint32_t size) {
+    uint32_t a = (uint32_t)addr;
+    if (size == 0) return 1;
+    if (a + size < a) return 0;   /* 回绕 */
+    return range_within(a, size, USER_LOW_START, USER_LOW_END) ||
+           range_within(a, size, KHEAP_START, KHEAP_START + KHEAP_INITIAL_SIZE);
+}
+
+/*
+ * 先按 4 字节 rep movsl 拷贝，再用 rep movsb 拷贝剩余的 0~3 字节。
+ * 出错时 ECX 是当前 rep 指令尚未完成的次数：
+ * - movsl 中出错：剩余 = ECX * 4 + 尾部字节数 (修复代码 3 计算后跳回出口)；
+ * - movsb 中出错：剩余 = ECX，直接跳到出口。
+ */
+static uint32_t __copy_user(void* to, const void* from, uint32_t n) {
+    uint32_t d0, d1;
+    asm volatile(
+        "0:  rep movsl\n"
+        "    movl %3, %0\n"
+        "1:  rep movsb\n"
+        "2:\n"
+        ".pushsection .fixup, \"ax\"\n"
+        "3:  leal (%3, %0, 4), %0\n"
+        "    jmp 2b\n"
+        ".popsection\n"
+        ".pushsection __ex_table, \"a\"\n"
+        "    .long 0b, 3b\n"
+        "    .long 1b, 2b\n"
+        ".popsection\n"
+        : "=&c"(n), "=&D"(d0), "=&S"(d1)
+        : "r"(n & 3), "0"(n / 4), "1"(to), "2"(from)
+        : "memory");
+    return n;
+}
+
+uint32_t copy_from_user(void* to, const void* from, uint32_t n) {
+    if (!access_ok(from, n)) return n;
+    return __copy_user(to, from, n);
+}
+
+uint32_t copy_to_user(void* to, const void* from, uint32_t n) {
+    if (!access_ok(to, n)) return n;
+    return __copy_user(to, from, n);
+}
+
+int fixup_exception(struct registers* regs) {
+    for (struct exception_table_entry* e = __start_ex_table; e < __stop_ex_table; e++) {
+        if (e->insn == regs->eip) {
+            regs->eip = e->fixup;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+/**
+ * uaccess.h - 用户空间内存访问 (access_ok / copy_from_user / copy_to_user)
+ *
+ * 系统调用拿到的指针来自 Ring 3，内核绝不能直接解引用：
+ * - 指针可能指向 Ring 3 自己访问不了的地址 (没有 PAGE_USER 的映射，如高半核 0xC0000000)，
+ *   内核以 Ring 0 访问时分页硬件不会拦截；
+ * - 指针可能指向未映射的页，内核自己触发缺页异常。
+ *
+ * 做法与 Linux 相同，分两步：
+ * 1. access_ok()：只检查地址范围是否落在用户区，不逐页查页表 (快)；
+ * 2. 真正的拷贝用 rep movs 完成，拷贝指令登记在异常表 (__ex_table) 中。
+ *    如果拷贝中途缺页，异常处理函数在表中查到出错指令，把 EIP 改到修复代码，
+ *    拷贝函数返回“未拷贝的字节数”，而不是让整个内核停机。
+ *
+ * @see [syscall_table.md](doc/syscall_table.md)
+ */
+#ifndef UACCESS_H
+#define UACCESS_H
+
+#include <stdint.h>
+#include "interrupts.h"
+
+/*
+ * 用户可以访问的地址范围 (与 vmm.c 中带 PAGE_USER 的映射一致)：
+ * - 低端恒等映射区 [0x1000, 4MB)：用户代码所在位置，第 0 页不算，用来捕获空指针；
+ * - 内核堆 [KHEAP_START, +1MB)：目前用户栈由 kmalloc 分配。
+ *
+ * 注意这只是“范围内/范围外”的检查，不是隔离：所有任务共用一个地址空间，
+ * 用户代码就在内核映像里，用户栈与内核栈都来自同一个堆，所以这两个区间同样包含
+ * 内核映像、内核栈、页表和堆上的内核数据 (Ring 3 本来就能直接访问它们)。
+ * access_ok 挡住的是越界、回绕和范围外的地址 (未映射区、高半核别名 0xC0000000)；
+ * 后者只是低 4MB 的另一个映射，挡住它并不能保护内核内存。
+ */
+#define USER_LOW_START   0x1000
+#define USER_LOW_END     0x400000
+
+/* [addr, addr+size) 是否完全位于某个用户区 (size 为 0 时总是成立) */
+int access_ok(const void* addr, uint32_t size);
+
+/*
+ * 在用户区与内核缓冲区之间拷贝 n 字节。
+ * 返回未能拷贝的字节数：0 表示全部成功；地址越界时不拷贝，返回 n。
+ */
+uint32_t copy_from_user(void* to, const void* from, uint32_t n);
+uint32_t copy_to_user(void* to, const void* from, uint32_t n);
+
+/*
+ * 由缺页 / 通用保护异常处理调用：如果出错指令 (regs->eip) 在异常表中，
+ * 把 EIP 改为修复地址并返回 1；否则返回 0 (真正的内核错误)。
+ */
+int fixup_exception(struct registers* regs);
+
+#endif
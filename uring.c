@@ -0,0 +1,233 @@
+#include "uring.h"
+#include "uaccess.h"
+#include "process.h"
+#include "pmm.h"
+#include "vmm.h"
+#include "fs.h"
+#include "spinlock.h"
+#include "clocksource.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - uring_setup：分配共享页并映射到用户地址，可选创建 SQPOLL 内核线程
+// - uring_enter：消费 SQ 中的一批 SQE，逐个执行并把结果写入 CQ
+// - SQPOLL 线程：轮询 SQ；空闲一段时间后设置 NEED_WAKEUP 并睡眠
+//
+// 共享页对用户可写，内核读取 SQE 时先把每个字段拷贝到内核栈上的局部变量，
+// 之后只使用这份拷贝：执行过程中用户再改 SQE 也影响不到内核 (TOCTOU)。
+// SQE 里的缓冲区地址和普通系统调用的参数一样，只通过 copy_from_user/copy_to_user 访问。
+
+#define URING_SQPOLL_IDLE_SPINS 200     /* SQPOLL 线程连续空转多少次后睡眠 */
+#define URING_IO_CHUNK          128
+
+struct uring {
+    struct uring_shared* sh;    /* 共享页：内核与用户使用同一个虚拟地址 */
+    process_t* owner;           /* 创建者；只有它可以 enter */
+    process_t* sqpoll;          /* SQPOLL 线程 (可选) */
+    uint32_t setup_flags;
+    spinlock_t lock;            /* 只保护 SQPOLL 线程的睡眠/唤醒握手 */
+};
+
+static struct uring rings[URING_MAX_RINGS];
+static spinlock_t rings_lock = SPINLOCK_INIT("uring");
+
+/* === 单个操作 === */
+
+static int32_t uring_op_read(uint32_t ubuf, uint32_t len, uint32_t off, uint32_t uname) {
+    char name[32];
+    uint32_t left = copy_from_user(name, (const void*)uname, sizeof(name));
+    if (left == sizeof(name)) return -EFAULT;
+    name[sizeof(name) - left - 1] = 0;
+
+    if (!fs_root) return -ENOENT;
+    fs_node_t* node = vfs_finddir(fs_root, name);
+    if (!node) return -ENOENT;
+    if (!access_ok((void*)ubuf, len)) return -EFAULT;
+
+    uint8_t kbuf[URING_IO_CHUNK];
+    uint32_t done = 0;
+    while (done < len) {
+        uint32_t n = len - done;
+        if (n > URING_IO_CHUNK) n = URING_IO_CHUNK;
+        uint32_t got = vfs_read(node, off + done, n, kbuf);
+        if (got == 0) break;    /* 文件结束 */
+        if (copy_to_user((void*)(ubuf + done), kbuf, got)) return done ? (int32_t)done : -EFAULT;
+        done += got;
+    }
+    return (int32_t)done;
+}
+
+static int32_t uring_exec(uint8_t opcode, uint32_t addr, uint32_t len, uint32_t off, uint32_t addr2) {
+    switch (opcode) {
+    case URING_OP_NOP:
+        return 0;
+    case URING_OP_WRITE:
+        return ksys_write((const char*)addr, len);
+    case URING_OP_READ:
+        return uring_op_read(addr, len, off, addr2);
+    case URING_OP_SLEEP: {
+        /* 在系统调用 (或 SQPOLL 线程) 中直接睡眠：process_yield 在当前内核栈上
+           再陷入一次，醒来后从这里继续处理下一个 SQE。
+           SQPOLL 线程开着中断，设置休眠状态到让出 CPU 之间要关中断 */
+        uint32_t flags = local_irq_save();
+        if (process_sleep_until(clock_monotonic_ns() + (uint64_t)len * NSEC_PER_MSEC)) {
+            process_yield();
+        }
+        local_irq_restore(flags);
+        return 0;
+    }
+    case URING_OP_YIELD:
+        process_yield();
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+// 消费最多 to_submit 个 SQE，返回处理的个数。CQ 已满时提前停止，剩下的留在 SQ 中。
+static uint32_t uring_submit(struct uring* r, uint32_t to_submit) {
+    struct uring_shared* sh = r->sh;
+    uint32_t head = sh->sq_head;
+    uint32_t avail = sh->sq_tail - head;
+    if (avail > URING_SQ_ENTRIES) avail = URING_SQ_ENTRIES;  /* 用户写坏了 tail */
+    if (to_submit > avail) to_submit = avail;
+    asm volatile("" : : : "memory");    /* 先读 tail，再读 SQE 内容 */
+
+    uint32_t done = 0;
+    while (done < to_submit) {
+        if (sh->cq_tail - sh->cq_head >= URING_CQ_ENTRIES) break;
+
+        volatile struct uring_sqe* sqe = &sh->sqes[head & (URING_SQ_ENTRIES - 1)];
+        uint8_t opcode = sqe->opcode;
+        uint32_t addr = sqe->addr, len = sqe->len, off = sqe->off, addr2 = sqe->addr2;
+        uint32_t user_data = sqe->user_data;
+        head++;
+        sh->sq_head = head;             /* SQE 已拷贝，槽位可以还给用户 */
+
+        int32_t res = uring_exec(opcode, addr, len, off, addr2);
+
+        struct uring_cqe* cqe = &sh->cqes[sh->cq_tail & (URING_CQ_ENTRIES - 1)];
+        cqe->user_data = user_data;
+        cqe->res = res;
+        asm volatile("" : : : "memory");    /* 先写 CQE 内容，再发布 tail */
+        sh->cq_tail++;
+        done++;
+    }
+    return done;
+}
+
+/* === SQPOLL === */
+
+static void uring_sqpoll_thread(void* arg) {
+    struct uring* r = (struct uring*)arg;
+    struct uring_shared* sh = r->sh;
+    uint32_t idle = 0;
+
+    while (1) {
+        if (uring_submit(r, URING_SQ_ENTRIES)) {
+            idle = 0;
+            continue;
+        }
+        if (++idle < URING_SQPOLL_IDLE_SPINS) {
+            process_yield();
+            continue;
+        }
+
+        /* 空闲太久：告诉用户需要 SQ_WAKEUP，然后再检查一次 SQ 才睡眠。
+           用户先写 tail 再读 flags，这里先写 flags 再读 tail (两边都有 mfence)，
+           所以二者至少有一方能看到对方，提交不会被遗漏。 */
+        uint32_t flags = spin_lock_irqsave(&r->lock);
+        sh->flags |= URING_SQ_NEED_WAKEUP;
+        __sync_synchronize();
+        while (sh->sq_tail == sh->sq_head) {
+            process_block_current();
+            spin_unlock(&r->lock);
+            process_yield();
+            spin_lock(&r->lock);
+        }
+        sh->flags &= ~URING_SQ_NEED_WAKEUP;
+        spin_unlock_irqrestore(&r->lock, flags);
+        idle = 0;
+    }
+}
+
+/* === 系统调用 === */
+
+int32_t sys_uring_setup(const uint32_t* args) {
+    uint32_t setup_flags = args[0];
+    if (setup_flags & ~URING_SETUP_SQPOLL) return -EINVAL;
+
+    /* 占一个槽位 (owner 非空即已占用) */
+    process_t* cur = process_current();
+    int slot = -1;
+    uint32_t flags = spin_lock_irqsave(&rings_lock);
+    for (int i = 0; i < URING_MAX_RINGS; i++) {
+        if (!rings[i].owner) {
+            rings[i].owner = cur;
+            slot = i;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&rings_lock, flags);
+    if (slot < 0) return -EBUSY;
+
+    struct uring* r = &rings[slot];
+    uint32_t va = URING_USER_BASE + slot * PAGE_SIZE;
+    uint32_t phys = pmm_alloc_page();
+    if (!phys || vmm_map_page(va, phys, PAGE_RW | PAGE_USER) != 0) {
+        if (phys) pmm_free_page(phys);
+        r->owner = NULL;
+        return -ENOMEM;
+    }
+
+    uint32_t* p = (uint32_t*)va;
+    for (uint32_t i = 0; i < PAGE_SIZE / 4; i++) p[i] = 0;
+
+    r->sh = (struct uring_shared*)va;
+    r->setup_flags = setup_flags;
+    r->sqpoll = NULL;
+    spin_lock_init(&r->lock, "uring_sq");
+
+    if (setup_flags & URING_SETUP_SQPOLL) {
+        char name[] = "uring_sq/0";
+        name[9] = '0' + slot;
+        r->sqpoll = process_create_arg(uring_sqpoll_thread, r, name);
+    }
+    return (int32_t)va;
+}
+
+static struct uring* uring_lookup(uint32_t uaddr) {
+    if (uaddr < URING_USER_BASE) return NULL;
+    uint32_t slot = (uaddr - URING_USER_BASE) / PAGE_SIZE;
+    if (slot >= URING_MAX_RINGS || uaddr != URING_USER_BASE + slot * PAGE_SIZE) return NULL;
+    struct uring* r = &rings[slot];
+    if (r->owner != process_current() || !r->sh) return NULL;
+    return r;
+}
+
+int32_t sys_uring_enter(const uint32_t* args) {
+    struct uring* r = uring_lookup(args[0]);
+    uint32_t to_submit = args[1], min_complete = args[2], enter_flags = args[3];
+    if (!r) return -EINVAL;
+
+    int32_t submitted = 0;
+    if (r->setup_flags & URING_SETUP_SQPOLL) {
+        /* SQ 由轮询线程消费，这里只负责叫醒它 */
+        if (enter_flags & URING_ENTER_SQ_WAKEUP) {
+            uint32_t flags = spin_lock_irqsave(&r->lock);
+            process_wake(r->sqpoll);
+            spin_unlock_irqrestore(&r->lock, flags);
+        }
+    } else {
+        submitted = (int32_t)uring_submit(r, to_submit);
+    }
+
+    /* 同步模式下操作在返回前都已完成；SQPOLL 模式下让出 CPU 等待轮询线程 */
+    if (enter_flags & URING_ENTER_GETEVENTS) {
+        while (r->sh->cq_tail - r->sh->cq_head < min_complete) {
+            if (!(r->setup_flags & URING_SETUP_SQPOLL)) break;
+            process_yield();
+        }
+    }
+    return submitted;
+}
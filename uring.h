@@ -0,0 +1,126 @@
+/**
+ * uring.h - 共享内存的批量系统调用接口 (仿 io_uring)
+ *
+ * 每个系统调用都要付一次特权级切换的代价。对于大量很小的操作 (打印几个字节、
+ * 睡一小会儿)，切换本身比操作还贵。uring 把“提交请求”和“陷入内核”分开：
+ *
+ * - 提交队列 (SQ)：用户把请求 (SQE) 写进共享页，移动 sq_tail；
+ * - 完成队列 (CQ)：内核执行后把结果 (CQE) 写进共享页，移动 cq_tail；
+ * - 一次 uring_enter 系统调用处理 SQ 中积攒的整批请求；
+ * - SQPOLL 模式下由内核线程轮询 SQ，用户连 uring_enter 都不用调用。
+ *
+ * 每个环形队列只有一个生产者和一个消费者，head/tail 各由一方写入，不需要锁。
+ * 本文件同时包含用户态辅助函数 (static inline，可在 Ring 3 使用)。
+ *
+ * @see [uring.md](doc/uring.md)
+ */
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+#include "syscall.h"
+
+#define URING_SQ_ENTRIES   64       /* 必须是 2 的幂 */
+#define URING_CQ_ENTRIES   128      /* CQ 比 SQ 大，给尚未收割的结果留余量 */
+#define URING_MAX_RINGS    8
+#define URING_USER_BASE    0xE0000000   /* 共享页映射到的用户虚拟地址 (每个 ring 一页) */
+
+/* 操作码 */
+#define URING_OP_NOP     0
+#define URING_OP_WRITE   1      /* addr = 缓冲区, len = 字节数；res = 写出的字节数 */
+#define URING_OP_READ    2      /* addr = 缓冲区, len, off = 文件偏移, addr2 = initrd 文件名；res = 读到的字节数 */
+#define URING_OP_SLEEP   3      /* len = 毫秒 */
+#define URING_OP_YIELD   4
+
+/* uring_setup 的 flags */
+#define URING_SETUP_SQPOLL   0x1    /* 创建内核线程轮询 SQ */
+
+/* uring_enter 的 flags */
+#define URING_ENTER_GETEVENTS 0x1   /* 等待至少 min_complete 个完成事件 */
+#define URING_ENTER_SQ_WAKEUP 0x2   /* 唤醒已经睡眠的 SQPOLL 线程 */
+
+/* shared->flags (内核写，用户读) */
+#define URING_SQ_NEED_WAKEUP 0x1    /* SQPOLL 线程空闲太久已睡眠，提交后需要 SQ_WAKEUP */
+
+/* 提交队列项 */
+struct uring_sqe {
+    uint8_t  opcode;
+    uint8_t  flags;
+    uint16_t reserved;
+    uint32_t addr;
+    uint32_t len;
+    uint32_t off;
+    uint32_t addr2;
+    uint32_t user_data;     /* 原样带回 CQE，用来对应请求 */
+};
+
+/* 完成队列项 */
+struct uring_cqe {
+    uint32_t user_data;
+    int32_t  res;           /* 与同名系统调用的返回值相同，出错为负的错误码 */
+};
+
+/* 映射到用户空间的共享页 (一页之内) */
+struct uring_shared {
+    volatile uint32_t sq_head;      /* 内核写：已消费到的位置 */
+    volatile uint32_t sq_tail;      /* 用户写：已提交到的位置 */
+    volatile uint32_t cq_head;      /* 用户写：已收割到的位置 */
+    volatile uint32_t cq_tail;      /* 内核写：已完成到的位置 */
+    volatile uint32_t flags;        /* URING_SQ_NEED_WAKEUP */
+    uint32_t reserved[3];
+    struct uring_sqe sqes[URING_SQ_ENTRIES];
+    struct uring_cqe cqes[URING_CQ_ENTRIES];
+};
+
+/* === 内核接口 === */
+
+/* uring_setup(flags)：返回共享页的用户地址，失败返回负的错误码 */
+int32_t sys_uring_setup(const uint32_t* args);
+
+/* uring_enter(ring, to_submit, min_complete, flags)：返回本次处理的 SQE 数 */
+int32_t sys_uring_enter(const uint32_t* args);
+
+/* === 用户态辅助函数 (Ring 3) === */
+
+static inline struct uring_shared* uring_setup(uint32_t flags) {
+    int32_t r = (int32_t)user_syscall(SYS_URING_SETUP, flags, 0, 0, 0);
+    return r < 0 ? 0 : (struct uring_shared*)r;
+}
+
+static inline int32_t uring_enter(struct uring_shared* r, uint32_t to_submit,
+                                  uint32_t min_complete, uint32_t flags) {
+    return (int32_t)user_syscall(SYS_URING_ENTER, (uint32_t)r, to_submit, min_complete, flags);
+}
+
+/* 取一个空闲的 SQE (SQ 已满时返回 0)；填好后调用 uring_sq_advance 提交 */
+static inline struct uring_sqe* uring_get_sqe(struct uring_shared* r, uint32_t pending) {
+    uint32_t tail = r->sq_tail + pending;
+    if (tail - r->sq_head >= URING_SQ_ENTRIES) return 0;
+    return &r->sqes[tail & (URING_SQ_ENTRIES - 1)];
+}
+
+/* 发布 n 个已填好的 SQE：先写内容，再移动 tail */
+static inline void uring_sq_advance(struct uring_shared* r, uint32_t n) {
+    asm volatile("" : : : "memory");
+    r->sq_tail += n;
+}
+
+/* SQPOLL：发布后检查线程是否已睡眠 (mfence 保证先写 tail 再读 flags) */
+static inline int uring_sq_needs_wakeup(struct uring_shared* r) {
+    __sync_synchronize();
+    return r->flags & URING_SQ_NEED_WAKEUP;
+}
+
+/* 取下一个完成事件 (没有时返回 0)；处理完后调用 uring_cq_advance */
+static inline struct uring_cqe* uring_peek_cqe(struct uring_shared* r) {
+    if (r->cq_head == r->cq_tail) return 0;
+    asm volatile("" : : : "memory");
+    return &r->cqes[r->cq_head & (URING_CQ_ENTRIES - 1)];
+}
+
+static inline void uring_cq_advance(struct uring_shared* r, uint32_t n) {
+    asm volatile("" : : : "memory");
+    r->cq_head += n;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "vdso.h"
+#include "pmm.h"
+#include "vmm.h"
+#include "printk.h"
+#include "clocksource.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 分配时间页，映射两次：用户只读 (VDSO_USER_ADDR)、内核可写 (VDSO_KERNEL_ADDR)
+// - 填入时钟源的 TSC 换算参数 (启动时校准好，之后不再变化)
+// - 每个 tick 更新时间页 (seqcount 写端)：节拍数，没有 TSC 时还有对应的纳秒数
+//
+// 写者只有 BSP 的时钟中断，所以 seq 的两次自增不需要原子指令。
+// x86 的写操作不会相互重排，编译器屏障就足以保证“先改 seq，再写数据，再改 seq”。
+
+static struct vdso_data* vdso = NULL;
+
+void vdso_init(uint32_t hz) {
+    uint32_t phys = pmm_alloc_page();
+    if (!phys) return;
+    if (vmm_map_page(VDSO_USER_ADDR, phys, PAGE_USER) != 0) return;       /* 只读 */
+    if (vmm_map_page(VDSO_KERNEL_ADDR, phys, PAGE_RW) != 0) return;       /* 仅内核 */
+
+    struct vdso_data* vd = (struct vdso_data*)VDSO_KERNEL_ADDR;
+    uint8_t* p = (uint8_t*)vd;
+    for (uint32_t i = 0; i < PAGE_SIZE; i++) p[i] = 0;
+    vd->hz = hz;
+    vd->ns_per_tick = NSEC_PER_SEC / hz;
+
+    uint32_t mult, shift;
+    uint64_t base;
+    if (clocksource_tsc_params(&mult, &shift, &base)) {
+        vd->tsc_base = base;
+        vd->shift = shift;
+        vd->mult = mult;
+    }
+
+    vdso = vd;
+    printk(KERN_INFO, "vDSO time page mapped at 0xE0400000 (read-only)\n");
+}
+
+void vdso_update(uint32_t ticks) {
+    struct vdso_data* vd = vdso;
+    if (!vd) return;
+
+    vd->seq++;                              /* 奇数：读者会重试 */
+    asm volatile("" : : : "memory");
+    vd->ticks = ticks;
+    vd->ns_base = (uint64_t)ticks * vd->ns_per_tick;
+    asm volatile("" : : : "memory");
+    vd->seq++;                              /* 偶数：数据完整 */
+}
@@ -0,0 +1,74 @@
+/**
+ * vdso.h - 用户态可读的共享时间页 (vDSO 风格)
+ *
+ * 读取时间本身很便宜 (rdtsc 只要几十个周期)，但如果每次都要走系统调用，
+ * 开销就变成了一次完整的陷入。做法与 Linux 的 vDSO 相同：
+ * - 内核分配一页“时间数据”，以只读方式映射到用户地址 VDSO_USER_ADDR；
+ * - 时间页里放着与内核时钟源 (clocksource.h) 相同的 TSC 换算参数，用户态用 rdtsc
+ *   算出的时间与 clock_monotonic_ns() 完全一致，整个过程不陷入内核、不加锁；
+ * - 没有 TSC 时，BSP 的时钟中断每个 tick 更新一次节拍数与对应的纳秒数 (tick 精度)。
+ *
+ * 一致性靠顺序计数器 (seqcount)：写者更新前后各把 seq 加一 (写的过程中 seq 为奇数)，
+ * 读者读数据前后各读一次 seq，两次相同且为偶数才说明读到的是一份完整的数据。
+ *
+ * 本文件的 static inline 读函数可以在 Ring 3 直接调用。
+ *
+ * @see [vdso.md](doc/vdso.md)
+ */
+#ifndef VDSO_H
+#define VDSO_H
+
+#include <stdint.h>
+#include "cpu.h"
+#include "clocksource.h"
+
+#define VDSO_USER_ADDR   0xE0400000   /* 用户只读映射 */
+#define VDSO_KERNEL_ADDR 0xE0401000   /* 内核可写映射 (同一物理页，不带 PAGE_USER) */
+
+struct vdso_data {
+    volatile uint32_t seq;      /* 顺序计数器：奇数表示正在更新 */
+    uint32_t hz;                /* 时钟节拍频率 */
+    uint32_t ticks;             /* 当前节拍数 (pit_ticks) */
+    uint32_t ns_per_tick;
+    uint32_t mult;              /* TSC → 纳秒换算系数；0 表示没有 TSC，只有 tick 精度 */
+    uint32_t shift;             /* ns = ((tsc - tsc_base) * mult) >> shift */
+    uint64_t tsc_base;          /* 时钟源的零点 (TSC) */
+    uint64_t ns_base;           /* 没有 TSC 时：当前 tick 对应的纳秒数 */
+};
+
+/* 分配并映射时间页 (需在 vmm_init 之后调用) */
+void vdso_init(uint32_t hz);
+
+/* 由 BSP 的时钟中断在每个 tick 调用 (唯一的写者)，需在 clocksource_init 之后 */
+void vdso_update(uint32_t ticks);
+
+/* === 用户态读取 (Ring 3，无锁、不陷入内核) === */
+
+/* 开机以来的单调时间 (纳秒) */
+static inline uint64_t vdso_gettime_ns(void) {
+    const volatile struct vdso_data* vd = (const volatile struct vdso_data*)VDSO_USER_ADDR;
+    uint32_t seq, mult, shift;
+    uint64_t tsc_base, ns_base;
+    do {
+        seq = vd->seq;
+        asm volatile("" : : : "memory");
+        mult = vd->mult;
+        shift = vd->shift;
+        tsc_base = vd->tsc_base;
+        ns_base = vd->ns_base;
+        asm volatile("" : : : "memory");
+    } while ((seq & 1) || seq != vd->seq);
+
+    /* 与 clock_monotonic_ns() 同一个公式、同一组参数，用户与内核看到的时间一致 */
+    if (mult) return mul_u64_u32_shr(rdtsc() - tsc_base, mult, shift);
+    return ns_base;
+}
+
+static inline void vdso_clock_gettime(struct timespec* ts) {
+    uint64_t ns = vdso_gettime_ns();
+    uint64_t sec = div_u64(ns, NSEC_PER_SEC);
+    ts->tv_sec = (uint32_t)sec;
+    ts->tv_nsec = (uint32_t)(ns - sec * NSEC_PER_SEC);
+}
+
+#endif
@@ -1,10 +1,16 @@
 #include "vmm.h"
+#include "spinlock.h"
 #include "pmm.h"
-#include "terminal.h"
+#include "printk.h"
+#include "alternative.h"
 
 /* 页目录与页表是 4KB 对齐的数组，每个包含 1024 个 32位条目 */
 /* 我们不静态定义，而是通过 PMM 动态请求物理页 */
 
+/* 内核页目录 (物理地址，位于恒等映射区，开启分页后仍可直接访问) */
+static uint32_t* kernel_pd = 0;
+static spinlock_t vmm_lock = SPINLOCK_INIT("vmm");
+
 extern void load_cr3(uint32_t page_directory_phys);
 extern void enable_paging(void);
 
@@ -27,7 +33,7 @@ void vmm_init(void) {
     uint32_t pt_phys = pmm_alloc_page();
 
     if (pd_phys == 0 || pt_phys == 0) {
-        terminal_writestring("VMM Error: Failed to allocate PMM pages for PD/PT\n");
+        printk(KERN_ERR, "VMM Error: Failed to allocate PMM pages for PD/PT\n");
         return;
     }
 
@@ -73,12 +79,78 @@ void vmm_init(void) {
         }
     }
 
+    kernel_pd = pd;
+
     /* 5. 载入 CR3 并开启分页 */
-    terminal_writestring("Loading CR3...\n");
+    printk(KERN_DEBUG, "Loading CR3...\n");
     set_cr3(pd_phys);
 
-    terminal_writestring("Enabling Paging...\n");
+    printk(KERN_DEBUG, "Enabling Paging...\n");
     enable_paging_bit();
 
-    terminal_writestring("VMM initialized! Higher-half mapped at 0xC0000000.\n");
+    printk(KERN_INFO, "VMM initialized! Higher-half mapped at 0xC0000000.\n");
+}
+
+/* 刷新本 CPU 中 virt 所在页的 TLB 表项。
+   INVLPG 是 486 才有的指令：默认重新加载 CR3 (刷新整个 TLB)，启动时修补成 INVLPG */
+static inline void vmm_flush_page(uint32_t virt) {
+    asm volatile(ALTERNATIVE("mov %%cr3, %%eax\n\tmov %%eax, %%cr3", "invlpg (%0)", X86_FEATURE_INVLPG)
+                 : : "r"(virt) : "eax", "memory");
+}
+
+int vmm_map_page(uint32_t virt, uint32_t phys, uint32_t flags) {
+    if (!kernel_pd) return -1;
+    uint32_t pdi = virt >> 22;
+    uint32_t pti = (virt >> 12) & 0x3FF;
+
+    /* SMP：两个 CPU 同时为同一个 PDE 分配页表会泄漏其中一页并丢失映射 */
+    uint32_t lock_flags = spin_lock_irqsave(&vmm_lock);
+    if (!(kernel_pd[pdi] & PAGE_PRESENT)) {
+        uint32_t pt_phys = pmm_alloc_page();
+        if (pt_phys == 0) {
+            spin_unlock_irqrestore(&vmm_lock, lock_flags);
+            return -1;
+        }
+        uint32_t* new_pt = (uint32_t*)pt_phys;
+        for (int i = 0; i < 1024; i++) new_pt[i] = 0;
+        /* PDE 放宽权限，最终权限由 PTE 决定 */
+        kernel_pd[pdi] = pt_phys | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+    }
+
+    uint32_t* pt = (uint32_t*)(kernel_pd[pdi] & PAGE_FRAME);
+    pt[pti] = (phys & PAGE_FRAME) | (flags & 0xFFF) | PAGE_PRESENT;
+
+    /* 刷新该页的 TLB 表项。这里只会新增映射 (不存在的表项不会被 TLB 缓存)，
+       所以不需要通知其他 CPU 刷新 (TLB shootdown) */
+    vmm_flush_page(virt);
+    spin_unlock_irqrestore(&vmm_lock, lock_flags);
+    return 0;
+}
+
+int vmm_identity_map(uint32_t phys, uint32_t size, uint32_t flags) {
+    uint32_t start = phys & PAGE_FRAME;
+    uint32_t end = phys + size;
+    for (uint32_t addr = start; addr < end; addr += PAGE_SIZE) {
+        if (vmm_map_page(addr, addr, flags) != 0) return -1;
+        if (addr + PAGE_SIZE < addr) break; /* 防止地址回绕 */
+    }
+    return 0;
+}
+
+void vmm_identity_unmap(uint32_t phys, uint32_t size) {
+    if (!kernel_pd) return;
+    uint32_t start = phys & PAGE_FRAME;
+    uint32_t end = phys + size;
+    uint32_t lock_flags = spin_lock_irqsave(&vmm_lock);
+    for (uint32_t addr = start; addr < end; addr += PAGE_SIZE) {
+        uint32_t pde = kernel_pd[addr >> 22];
+        if (pde & PAGE_PRESENT) {
+            uint32_t* pt = (uint32_t*)(pde & PAGE_FRAME);
+            /* 页表本身不回收：同一 4MB 区间以后还会再映射 (ACPI、帧缓冲……) */
+            pt[(addr >> 12) & 0x3FF] = addr < VMM_IDENTITY_END ? (addr | PAGE_PRESENT | PAGE_RW | PAGE_USER) : 0;
+            vmm_flush_page(addr);
+        }
+        if (addr + PAGE_SIZE < addr) break;
+    }
+    spin_unlock_irqrestore(&vmm_lock, lock_flags);
 }
@@ -5,11 +5,32 @@
 #define PAGE_PRESENT    0x1
 #define PAGE_RW         0x2
 #define PAGE_USER       0x4
+#define PAGE_PWT        0x8         /* Write-Through */
+#define PAGE_PCD        0x10        /* Cache Disable：MMIO 寄存器必须禁用缓存 */
 #define PAGE_FRAME      0xFFFFF000
 
 /* 分页相关常量 */
 #define PAGE_SIZE       4096
 #define PAGING_FLAG     0x80000000 /* CR0 最高位 */
+#define VMM_IDENTITY_END 0x400000  /* 启动时建立的永久恒等映射 [0, 4MB) */
 
 /* 初始化 VMM，建立恒等映射与高半核映射 */
 void vmm_init(void);
+
+/*
+ * 在内核页目录中建立单页映射 virt -> phys (flags 会自动加上 PAGE_PRESENT)
+ * 需要新页表时从 PMM 申请；页表通过恒等映射访问，因此新页表的物理地址需在 4MB 以内。
+ * 返回 0 成功，-1 失败。
+ */
+int vmm_map_page(uint32_t virt, uint32_t phys, uint32_t flags);
+
+/* 恒等映射 [phys, phys+size) 所覆盖的所有页 (用于 ACPI 表、APIC 寄存器等) */
+int vmm_identity_map(uint32_t phys, uint32_t size, uint32_t flags);
+
+/*
+ * 撤销 vmm_identity_map 建立的映射 (把物理页还给 PMM 之前调用)。
+ * 低 4MB 是永久恒等映射 (内核按物理地址直接访问 PMM 分配的页)，只恢复启动时的权限。
+ * 只刷新本 CPU 的 TLB：没有 TLB shootdown，调用者要保证其他 CPU 没有访问过这段地址，
+ * 或者接受它们的旧表项在下次刷新前仍然有效。
+ */
+void vmm_identity_unmap(uint32_t phys, uint32_t size);
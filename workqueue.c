@@ -0,0 +1,132 @@
+#include "workqueue.h"
+#include "heap.h"
+#include "printk.h"
+#include <stddef.h>
+
+// 本文件负责：
+// - 工作队列的创建与 worker 线程池 (每个 worker 都是 process_create_arg 创建的内核线程)
+// - queue_work：关中断入队，并唤醒一个空闲 worker（可在中断上下文调用）
+// - worker_thread：取出 work 后开中断执行；队列为空时阻塞 (STATE_BLOCKED)
+// - flush_workqueue：等待队列排空且没有正在执行的 work
+//
+// 并发说明：队列由 wq->lock (关中断自旋锁) 保护。worker 在持锁状态下检查队列为空
+// 并把自己标记为阻塞，然后才释放锁、让出 CPU。queue_work 必须拿到同一把锁才能入队，
+// 所以它的唤醒只可能发生在“已标记阻塞”之后，不会丢失 (若 worker 还没来得及切走，
+// process_wake 只把状态改回 READY，schedule 会直接把它放回运行队列)。
+
+workqueue_t* system_wq = NULL;
+workqueue_t* system_ordered_wq = NULL;
+
+static work_t* wq_pop_locked(workqueue_t* wq) {
+    work_t* work = wq->head;
+    if (work) {
+        wq->head = work->next;
+        if (!wq->head) wq->tail = NULL;
+        work->next = NULL;
+        wq->nr_queued--;
+    }
+    return work;
+}
+
+// worker 线程主循环：arg 即所属的工作队列
+static void worker_thread(void* arg) {
+    workqueue_t* wq = (workqueue_t*)arg;
+    while (1) {
+        uint32_t flags = spin_lock_irqsave(&wq->lock);
+        while (!wq->head) {
+            /* 持锁标记阻塞，放锁后 (保持关中断) 让出 CPU；被 queue_work 唤醒后重新加锁检查 */
+            process_block_current();
+            spin_unlock(&wq->lock);
+            process_yield();
+            spin_lock(&wq->lock);
+        }
+        work_t* work = wq_pop_locked(wq);
+        /* 先清 pending 再执行：执行期间再次 queue_work 会重新入队，不会丢失事件 */
+        work->pending = 0;
+        wq->nr_running++;
+        spin_unlock_irqrestore(&wq->lock, flags);
+
+        work->func(work);
+
+        flags = spin_lock_irqsave(&wq->lock);
+        wq->nr_running--;
+        spin_unlock_irqrestore(&wq->lock, flags);
+    }
+}
+
+workqueue_t* workqueue_create(const char* name, uint32_t flags, uint32_t nr_workers) {
+    workqueue_t* wq = (workqueue_t*)kmalloc(sizeof(workqueue_t));
+    if (!wq) return NULL;
+
+    int i = 0;
+    for (; i < WQ_NAME_LEN - 1 && name[i]; i++) wq->name[i] = name[i];
+    wq->name[i] = 0;
+
+    /* 有序队列只能有一个 worker，否则无法保证 FIFO 执行顺序 */
+    if (flags & WQ_ORDERED) nr_workers = 1;
+    if (nr_workers == 0) nr_workers = 1;
+    if (nr_workers > WQ_MAX_WORKERS) nr_workers = WQ_MAX_WORKERS;
+
+    wq->flags = flags;
+    wq->nr_workers = nr_workers;
+    wq->head = NULL;
+    wq->tail = NULL;
+    wq->nr_queued = 0;
+    wq->nr_running = 0;
+    spin_lock_init(&wq->lock, "workqueue");
+
+    /* worker 线程名："<队列名>/<序号>" */
+    for (uint32_t w = 0; w < WQ_MAX_WORKERS; w++) wq->workers[w] = NULL;
+    for (uint32_t w = 0; w < nr_workers; w++) {
+        char tname[PROCESS_NAME_LEN];
+        int p = 0;
+        for (; p < WQ_NAME_LEN - 1 && wq->name[p]; p++) tname[p] = wq->name[p];
+        tname[p++] = '/';
+        tname[p++] = '0' + w;
+        tname[p] = 0;
+        wq->workers[w] = process_create_arg(worker_thread, wq, tname);
+    }
+    return wq;
+}
+
+int queue_work(workqueue_t* wq, work_t* work) {
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    if (work->pending) {
+        spin_unlock_irqrestore(&wq->lock, flags);
+        return 0;
+    }
+    work->pending = 1;
+    work->next = NULL;
+    if (wq->tail) wq->tail->next = work;
+    else wq->head = work;
+    wq->tail = work;
+    wq->nr_queued++;
+
+    /* 唤醒一个阻塞中的 worker；若全部在忙，它们执行完当前 work 后会自行取走 */
+    for (uint32_t w = 0; w < wq->nr_workers; w++) {
+        process_t* worker = wq->workers[w];
+        if (worker && worker->state == STATE_BLOCKED) {
+            process_wake(worker);
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+    return 1;
+}
+
+void flush_workqueue(workqueue_t* wq) {
+    while (1) {
+        uint32_t flags = spin_lock_irqsave(&wq->lock);
+        int idle = (wq->nr_queued == 0 && wq->nr_running == 0);
+        spin_unlock_irqrestore(&wq->lock, flags);
+        if (idle) break;
+        /* 让 worker 先跑；flush 不在热路径上，轮询让出即可 */
+        process_yield();
+    }
+}
+
+void workqueue_init(void) {
+    system_wq = workqueue_create("events", 0, 2);
+    system_ordered_wq = workqueue_create("events_ord", WQ_ORDERED, 1);
+    printk(KERN_INFO, "Workqueues initialized (events x2, events_ord x1).\n");
+}
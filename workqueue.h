@@ -0,0 +1,85 @@
+/**
+ * workqueue.h - 内核工作队列 (Work Queue)
+ *
+ * 中断处理函数应该尽快返回，把真正耗时的工作推迟 (Defer) 到可调度的上下文中执行。
+ * 工作队列就是这种“推迟执行”的通用设施：
+ * - 中断里调用 queue_work() 把一个 work 挂到队列上，立即返回；
+ * - 队列背后有一组内核线程 (Worker Thread Pool，基于 process_create_arg)，
+ *   它们在开中断、可被抢占的环境中依次执行这些 work。
+ *
+ * 两种队列：
+ * - 无序队列 (Unordered)：多个 worker 并发取活，吞吐更高，work 之间不保证先后顺序；
+ * - 有序队列 (WQ_ORDERED)：只有一个 worker，严格按入队顺序 (FIFO) 串行执行。
+ *
+ * @see [workqueue.md](doc/workqueue.md)
+ */
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <stdint.h>
+#include "process.h"
+#include "spinlock.h"
+
+#define WQ_ORDERED      0x01    /* 严格 FIFO，单 worker 串行执行 */
+#define WQ_MAX_WORKERS  4       /* 每个队列最多的 worker 线程数 */
+#define WQ_NAME_LEN     16
+
+typedef struct work_struct work_t;
+typedef void (*work_func_t)(work_t* work);
+
+/* 一个待执行的工作项，通常嵌入在驱动自己的数据结构中 */
+struct work_struct {
+    work_func_t func;           /* 要执行的函数 */
+    void* data;                 /* 私有数据 */
+    struct work_struct* next;   /* 队列链表指针 */
+    volatile uint32_t pending;  /* 1 表示已在队列中，避免重复入队 */
+};
+
+typedef struct workqueue {
+    char name[WQ_NAME_LEN];
+    uint32_t flags;
+    uint32_t nr_workers;
+    work_t* head;               /* 待执行 work 链表 (FIFO) */
+    work_t* tail;
+    volatile uint32_t nr_queued;  /* 队列中尚未开始执行的 work 数 */
+    volatile uint32_t nr_running; /* 正在被 worker 执行的 work 数 */
+    process_t* workers[WQ_MAX_WORKERS];
+    spinlock_t lock;            /* 保护链表与计数 (SMP 下 worker 可能分布在不同 CPU) */
+} workqueue_t;
+
+/* 初始化一个 work */
+static inline void INIT_WORK(work_t* work, work_func_t func, void* data) {
+    work->func = func;
+    work->data = data;
+    work->next = 0;
+    work->pending = 0;
+}
+
+/* 系统默认队列：system_wq (无序，多 worker) 与 system_ordered_wq (有序) */
+extern workqueue_t* system_wq;
+extern workqueue_t* system_ordered_wq;
+
+/* 创建系统默认队列 (需在 process_init 之后调用) */
+void workqueue_init(void);
+
+/*
+ * 创建工作队列
+ * @name:       队列名，同时用作 worker 线程名
+ * @flags:      WQ_ORDERED 或 0
+ * @nr_workers: worker 线程数 (1..WQ_MAX_WORKERS)，WQ_ORDERED 时强制为 1
+ */
+workqueue_t* workqueue_create(const char* name, uint32_t flags, uint32_t nr_workers);
+
+/*
+ * 提交 work (可在中断上下文调用)
+ * 返回 1 表示成功入队；返回 0 表示该 work 已经在队列中（尚未执行）。
+ */
+int queue_work(workqueue_t* wq, work_t* work);
+
+/*
+ * 等待队列中所有已提交的 work 执行完毕
+ * 只能在可调度的线程上下文调用，不能在中断中或 worker 自身中调用。
+ */
+void flush_workqueue(workqueue_t* wq);
+
+#endif